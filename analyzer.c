@@ -6,33 +6,126 @@
  * file to gather character, word, and line counts, as well as frequency data.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "analyzer.h"
+#include "sniff.h"
 
-// Define a maximum length for words to prevent buffer overflows.
-#define MAX_WORD_LEN 100
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-int analyze_file(AppStats *stats)
+// The number of bytes requested from the file per call to read().
+#define READ_BUFFER_SIZE 65536
+
+/**
+ * @brief Records a completed frequency word and notifies any hooks.
+ */
+static void emit_word(AppStats *stats, const char *word)
 {
-    FILE *file = fopen(stats->filename, "r");
-    if (file == NULL)
+    insert_word(stats->word_counts, word);
+    for (int i = 0; i < stats->hook_count; i++)
     {
-        // perror is used for system-level errors as it prints a more
-        // informative message (e.g., "Error opening file: No such file or directory").
-        perror("Error opening file");
-        return -1; // Signal failure to the caller.
+        if (stats->hooks[i].on_word != NULL)
+        {
+            stats->hooks[i].on_word(stats->hooks[i].ctx, word);
+        }
+    }
+}
+
+/**
+ * @brief Returns a mask with bit i set if p[i] is whitespace, for 64 bytes.
+ */
+static inline uint64_t whitespace_mask(const char *p)
+{
+    uint64_t mask = 0;
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i span = _mm_set1_epi8('\r' - '\t'); // '\t' '\n' '\v' '\f' '\r' are contiguous.
+    for (int k = 0; k < 4; k++)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * k));
+        __m128i off = _mm_sub_epi8(v, tab);
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(off, span), off); // off <= span, unsigned.
+        __m128i ws = _mm_or_si128(control, _mm_cmpeq_epi8(v, space));
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(ws) << (16 * k);
+    }
+#else
+    for (int i = 0; i < 64; i++)
+    {
+        unsigned char c = (unsigned char)p[i];
+        mask |= (uint64_t)(c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t') << i;
     }
+#endif
+    return mask;
+}
 
-    char word_buffer[MAX_WORD_LEN];
-    int word_buffer_index = 0;
-    int in_word = 0; // Flag for the basic whitespace-based word count.
+long long count_word_starts(const char *buf, size_t len, int *in_word)
+{
+    long long words = 0;
+    uint64_t prev_space = *in_word ? 0 : 1; // Whether the byte before is whitespace.
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64)
+    {
+        uint64_t ws = whitespace_mask(buf + i);
+        uint64_t starts = ~ws & ((ws << 1) | prev_space);
+        words += __builtin_popcountll(starts);
+        prev_space = ws >> 63;
+    }
+    for (; i < len; i++)
+    {
+        unsigned char c = (unsigned char)buf[i];
+        uint64_t space = c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+        words += (long long)(prev_space & ~space & 1);
+        prev_space = space;
+    }
+    *in_word = !prev_space;
+    return words;
+}
 
-    int c;
-    while ((c = fgetc(file)) != EOF)
+void scan_state_init(ScanState *state)
+{
+    state->word_buffer_index = 0;
+    state->in_word = 0;
+}
+
+void analyze_buffer(AppStats *stats, ScanState *state, const char *buf, size_t len)
+{
+    for (int h = 0; h < stats->hook_count; h++)
     {
+        if (stats->hooks[h].on_buffer != NULL)
+        {
+            stats->hooks[h].on_buffer(stats->hooks[h].ctx, buf, len);
+        }
+    }
+
+    // The whitespace word count is done by the block kernel. Line hooks may
+    // read word_count, so with such hooks it is brought up to date at
+    // every newline rather than once for the whole buffer.
+    int line_hooks = 0;
+    for (int h = 0; h < stats->hook_count; h++)
+    {
+        line_hooks |= stats->hooks[h].on_line != NULL;
+    }
+    size_t counted = 0; // Bytes whose words are already in word_count.
+    if (!line_hooks)
+    {
+        stats->word_count += (int)count_word_starts(buf, len, &state->in_word);
+        counted = len;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        int c = (unsigned char)buf[i];
         stats->char_count++;
 
         if (c == '\n')
@@ -44,50 +137,324 @@ int analyze_file(AppStats *stats)
         // is good practice to handle all possible values safely as array indices.
         stats->char_freq[(unsigned char)c]++;
 
-        // This is a simple word counter based on whitespace separation.
-        if (isspace(c))
+        // This is the more sophisticated word-building logic for frequency analysis.
+        // It considers only alphabetic characters to form words.
+        if (isalpha(c))
         {
-            in_word = 0;
+            if (state->word_buffer_index < MAX_WORD_LEN - 1)
+            {
+                // Convert to lowercase for case-insensitive counting.
+                state->word_buffer[state->word_buffer_index++] = tolower(c);
+            }
         }
         else
         {
-            if (in_word == 0)
+            // A non-alphabetic character signals the end of a word.
+            if (state->word_buffer_index > 0)
             {
-                stats->word_count++;
-                in_word = 1;
+                state->word_buffer[state->word_buffer_index] = '\0'; // Null-terminate the string.
+                emit_word(stats, state->word_buffer);
+                state->word_buffer_index = 0; // Reset buffer for the next word.
             }
         }
 
-        // This is the more sophisticated word-building logic for frequency analysis.
-        // It considers only alphabetic characters to form words.
-        if (isalpha(c))
+        // Line hooks run last so that the word ending on this line has
+        // already been reported when they are called.
+        if (c == '\n' && line_hooks)
         {
-            if (word_buffer_index < MAX_WORD_LEN - 1)
+            stats->word_count += (int)count_word_starts(buf + counted, i + 1 - counted,
+                                                        &state->in_word);
+            counted = i + 1;
+            for (int h = 0; h < stats->hook_count; h++)
             {
-                // Convert to lowercase for case-insensitive counting.
-                word_buffer[word_buffer_index++] = tolower(c);
+                if (stats->hooks[h].on_line != NULL)
+                {
+                    stats->hooks[h].on_line(stats->hooks[h].ctx);
+                }
             }
         }
-        else
+    }
+    if (counted < len)
+    {
+        stats->word_count += (int)count_word_starts(buf + counted, len - counted, &state->in_word);
+    }
+}
+
+void analyze_flush_word(AppStats *stats, ScanState *state)
+{
+    if (state->word_buffer_index > 0)
+    {
+        state->word_buffer[state->word_buffer_index] = '\0';
+        emit_word(stats, state->word_buffer);
+        state->word_buffer_index = 0;
+    }
+}
+
+void analyze_reset(AppStats *stats, ScanState *state)
+{
+    stats->char_count = 0;
+    stats->word_count = 0;
+    stats->line_count = 0;
+    memset(stats->char_freq, 0, 256 * sizeof(stats->char_freq[0]));
+    clear_hash_table(stats->word_counts);
+    scan_state_init(state);
+}
+
+void analyze_finish(AppStats *stats, ScanState *state)
+{
+    // After the last buffer, there might be a final word if the input did
+    // not end with a non-alphabetic character. This handles that edge case.
+    analyze_flush_word(stats, state);
+
+    for (int h = 0; h < stats->hook_count; h++)
+    {
+        if (stats->hooks[h].on_finish != NULL)
         {
-            // A non-alphabetic character signals the end of a word.
-            if (word_buffer_index > 0)
+            stats->hooks[h].on_finish(stats->hooks[h].ctx);
+        }
+    }
+}
+
+int analyze_file(AppStats *stats)
+{
+    // A filename of "-" reads standard input, which makes it possible to
+    // pipe live logs straight into the analyzer. read() is used rather than
+    // fread() so that a slow pipe is processed as soon as data arrives.
+    int use_stdin = strcmp(stats->filename, "-") == 0;
+    int fd = use_stdin ? STDIN_FILENO : open(stats->filename, O_RDONLY);
+    if (fd < 0)
+    {
+        // perror is used for system-level errors as it prints a more
+        // informative message (e.g., "Error opening file: No such file or directory").
+        perror("Error opening file");
+        return -1; // Signal failure to the caller.
+    }
+
+    char *buffer = malloc(READ_BUFFER_SIZE);
+    if (buffer == NULL)
+    {
+        if (!use_stdin)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    ScanState state;
+    scan_state_init(&state);
+
+    int status = 0;
+    int first = 1;
+    long long limit = -1; // Bytes left to analyze when sampling, or -1 for all.
+    for (;;)
+    {
+        ssize_t n = read(fd, buffer, READ_BUFFER_SIZE);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("Error reading file");
+            status = -1;
+            break;
+        }
+        if (n == 0)
+        {
+            break; // End of file.
+        }
+
+        if (first && stats->binary_policy != BINARY_SCAN)
+        {
+            n = read_sniff_block(fd, buffer, (size_t)n,
+                                 SNIFF_BYTES < READ_BUFFER_SIZE ? SNIFF_BYTES : READ_BUFFER_SIZE);
+            if (n < 0)
+            {
+                perror("Error reading file");
+                status = -1;
+                break;
+            }
+            SniffResult sniff;
+            sniff_content(buffer, (size_t)n, &sniff);
+            if (sniff.is_binary)
+            {
+                stats->binary_files++;
+                fprintf(stderr, "Note: %s looks binary (%zu NUL, %zu control, %zu invalid UTF-8 "
+                        "in the first %zu bytes); %s.\n", stats->filename, sniff.nul_bytes,
+                        sniff.control, sniff.invalid_utf8, sniff.bytes,
+                        stats->binary_policy == BINARY_SKIP ? "skipping it" : "sampling its start");
+                if (stats->binary_policy == BINARY_SKIP)
+                {
+                    break;
+                }
+                limit = BINARY_SAMPLE_BYTES;
+            }
+        }
+        first = 0;
+
+        if (limit >= 0 && n > limit)
+        {
+            n = (ssize_t)limit;
+        }
+        analyze_buffer(stats, &state, buffer, (size_t)n);
+        if (limit >= 0 && (limit -= n) == 0)
+        {
+            break; // The sample is complete.
+        }
+    }
+
+    analyze_finish(stats, &state);
+
+    free(buffer);
+    if (!use_stdin)
+    {
+        close(fd);
+    }
+    return status; // 0 signals success.
+}
+
+int partial_init(PartialResult *part, int table_size)
+{
+    memset(part, 0, sizeof(*part));
+    part->stats.char_freq = part->char_freq;
+    part->stats.word_counts = create_hash_table(table_size);
+    part->stats.binary_policy = BINARY_SCAN;
+    scan_state_init(&part->state);
+    part->head_open = 1;
+    return part->stats.word_counts != NULL ? 0 : -1;
+}
+
+/**
+ * @brief Appends letters to a word of `*len` letters, truncating as the
+ *        scan loop does.
+ */
+static void append_letters(char *word, int *len, const char *letters, int count)
+{
+    int room = MAX_WORD_LEN - 1 - *len;
+    int n = count < room ? count : room;
+    if (n > 0)
+    {
+        memcpy(word + *len, letters, (size_t)n);
+        *len += n;
+    }
+}
+
+void partial_scan(PartialResult *part, const char *buf, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    if (part->stats.char_count == 0)
+    {
+        unsigned char c = (unsigned char)buf[0];
+        part->starts_in_word = !(c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t');
+    }
+
+    // Leading letters go to the head rather than the scan state, since the
+    // word they belong to may have started in the preceding piece.
+    size_t i = 0;
+    if (part->head_open)
+    {
+        for (; i < len && isalpha((unsigned char)buf[i]); i++)
+        {
+            if (part->head_len < MAX_WORD_LEN - 1)
             {
-                word_buffer[word_buffer_index] = '\0'; // Null-terminate the string.
-                insert_word(stats->word_counts, word_buffer);
-                word_buffer_index = 0; // Reset buffer for the next word.
+                part->head[part->head_len++] = (char)tolower((unsigned char)buf[i]);
             }
+            part->char_freq[(unsigned char)buf[i]]++;
         }
+        part->stats.char_count += (long long)i;
+        part->stats.word_count += (int)count_word_starts(buf, i, &part->state.in_word);
+        part->head_open = i == len;
     }
+    if (i < len)
+    {
+        analyze_buffer(&part->stats, &part->state, buf + i, len - i);
+    }
+}
 
-    // After the loop, there might be a final word in the buffer if the file
-    // did not end with a non-alphabetic character. This handles that edge case.
-    if (word_buffer_index > 0)
+void partial_merge(PartialResult *left, PartialResult *right)
+{
+    if (right->stats.char_count == 0)
+    {
+        return;
+    }
+    if (left->stats.char_count == 0)
     {
-        word_buffer[word_buffer_index] = '\0';
-        insert_word(stats->word_counts, word_buffer);
+        PartialResult empty = *left;
+        *left = *right;
+        left->stats.char_freq = left->char_freq;
+        *right = empty;
+        right->stats.char_freq = right->char_freq;
+        return;
     }
 
-    fclose(file);
-    return 0; // Signal success.
-}
\ No newline at end of file
+    AppStats *l = &left->stats;
+    const AppStats *r = &right->stats;
+    l->char_count += r->char_count;
+    l->line_count += r->line_count;
+    l->word_count += r->word_count - (left->state.in_word && right->starts_in_word);
+    for (int c = 0; c < 256; c++)
+    {
+        left->char_freq[c] += right->char_freq[c];
+    }
+
+    if (left->head_open)
+    {
+        // All of `left` is letters: it is the start of right's head.
+        append_letters(left->head, &left->head_len, right->head, right->head_len);
+        if (!right->head_open)
+        {
+            HashTable *empty = l->word_counts;
+            l->word_counts = right->stats.word_counts;
+            right->stats.word_counts = empty;
+            left->state = right->state;
+            left->head_open = 0;
+        }
+        return;
+    }
+
+    // Right's head continues left's tail.
+    append_letters(left->state.word_buffer, &left->state.word_buffer_index, right->head,
+                   right->head_len);
+    if (right->head_open)
+    {
+        left->state.in_word = right->state.in_word;
+        return;
+    }
+    if (left->state.word_buffer_index > 0)
+    {
+        left->state.word_buffer[left->state.word_buffer_index] = '\0';
+        insert_word(l->word_counts, left->state.word_buffer);
+    }
+    merge_hash_table(l->word_counts, r->word_counts);
+    left->state = right->state;
+}
+
+void partial_finish(PartialResult *part, AppStats *stats)
+{
+    stats->char_count += part->stats.char_count;
+    stats->word_count += part->stats.word_count;
+    stats->line_count += part->stats.line_count;
+    for (int c = 0; c < 256; c++)
+    {
+        stats->char_freq[c] += part->char_freq[c];
+    }
+    if (part->head_len > 0)
+    {
+        part->head[part->head_len] = '\0';
+        insert_word(stats->word_counts, part->head);
+    }
+    if (!part->head_open)
+    {
+        merge_hash_table(stats->word_counts, part->stats.word_counts);
+        analyze_finish(stats, &part->state); // The tail.
+    }
+}
+
+void partial_free(PartialResult *part)
+{
+    free_hash_table(part->stats.word_counts);
+    part->stats.word_counts = NULL;
+}
@@ -9,8 +9,43 @@
 #ifndef ANALYZER_H
 #define ANALYZER_H
 
+#include <stddef.h>
 #include "hashtable.h"
 
+// Define a maximum length for words to prevent buffer overflows.
+#define MAX_WORD_LEN 100
+
+/**
+ * @struct ScanHook
+ * @brief A set of callbacks invoked by the scan loop as it encounters events.
+ *
+ * Hooks let optional features (windowed statistics, pattern counting, ...)
+ * observe the same single pass over the input instead of re-reading it.
+ * Any callback may be NULL.
+ */
+typedef struct
+{
+    void (*on_buffer)(void *ctx, const char *buf, size_t len); // A buffer is about to be scanned.
+    void (*on_word)(void *ctx, const char *word);              // A frequency word was completed.
+    void (*on_line)(void *ctx);                                // A newline character was read.
+    void (*on_finish)(void *ctx);                              // The current input file has ended.
+    void *ctx;                                                 // Passed back to every callback.
+} ScanHook;
+
+/**
+ * @enum BinaryPolicy
+ * @brief What analyze_file() does with an input whose first block looks binary.
+ */
+typedef enum
+{
+    BINARY_SKIP,   // Do not analyze it.
+    BINARY_SAMPLE, // Analyze only its first BINARY_SAMPLE_BYTES.
+    BINARY_SCAN    // Analyze it like any other input; no sniffing is done (the default).
+} BinaryPolicy;
+
+// How much of a binary input is analyzed under BINARY_SAMPLE.
+#define BINARY_SAMPLE_BYTES (1 << 20)
+
 /**
  * @struct AppStats
  * @brief A container for all statistics collected by the analyzer.
@@ -20,19 +55,104 @@
  */
 typedef struct
 {
-    const char *filename;   // The name of the file being analyzed.
+    const char *filename;   // The name of the file being analyzed ("-" for stdin).
     long long char_count;   // Total characters (using long long for large files).
     int word_count;         // Total words (based on whitespace).
     int line_count;         // Total lines (based on newline characters).
     int *char_freq;         // Pointer to an array (size 256) for char frequencies.
     HashTable *word_counts; // Pointer to the hash table for word frequencies.
+    ScanHook *hooks;        // Optional array of scan hooks (may be NULL).
+    int hook_count;         // Number of entries in `hooks`.
+    BinaryPolicy binary_policy; // Handling of inputs that look binary.
+    int binary_files;       // Number of inputs classified as binary.
 } AppStats;
 
+/**
+ * @struct ScanState
+ * @brief The state the scan loop carries from one buffer to the next.
+ *
+ * Keeping this outside of analyze_file() allows input to be fed in pieces
+ * (e.g. as it is appended to a log) while producing exactly the same
+ * statistics as a single pass over the whole file.
+ */
+typedef struct
+{
+    char word_buffer[MAX_WORD_LEN]; // The frequency word currently being built.
+    int word_buffer_index;          // Number of characters in `word_buffer`.
+    int in_word;                    // Flag for the basic whitespace-based word count.
+} ScanState;
+
+/**
+ * @brief Resets a ScanState to the "start of input" state.
+ * @param state A pointer to the ScanState to initialize.
+ */
+void scan_state_init(ScanState *state);
+
+/**
+ * @brief Feeds a buffer of input through the scan loop.
+ *
+ * Words that straddle two buffers are handled correctly as long as the same
+ * ScanState is passed for consecutive calls.
+ *
+ * @param stats A pointer to an initialized AppStats struct to update.
+ * @param state A pointer to the ScanState carried between calls.
+ * @param buf The bytes to analyze.
+ * @param len The number of bytes in `buf`.
+ */
+void analyze_buffer(AppStats *stats, ScanState *state, const char *buf, size_t len);
+
+/**
+ * @brief Counts whitespace-delimited words, i.e. whitespace to non-whitespace
+ *        transitions, without a branch per byte.
+ *
+ * Whitespace is the C locale's isspace() set. The input is processed 64
+ * bytes at a time: a 64-bit whitespace mask is built, the word starts are
+ * the non-whitespace bits whose predecessor bit is whitespace, and they are
+ * counted with a popcount. The last bit is carried into the next block.
+ *
+ * @param buf The bytes to scan.
+ * @param len The number of bytes in `buf`.
+ * @param in_word In: non-zero if the byte before `buf` was not whitespace.
+ *                Out: the same for the last byte of `buf`.
+ * @return The number of words that start in `buf`.
+ */
+long long count_word_starts(const char *buf, size_t len, int *in_word);
+
+/**
+ * @brief Counts the word left in the scan state, if any, without ending
+ *        the input: the hooks are not told that anything has finished.
+ * @param stats A pointer to the AppStats struct to update.
+ * @param state A pointer to the ScanState used for the input.
+ */
+void analyze_flush_word(AppStats *stats, ScanState *state);
+
+/**
+ * @brief Discards the core statistics and the scan state, as if no input
+ *        had been read yet.
+ *
+ * The counts, the character frequencies and the word table are cleared in
+ * place; the hooks and their state are left alone.
+ * @param stats A pointer to the AppStats struct to clear.
+ * @param state A pointer to the ScanState to reset.
+ */
+void analyze_reset(AppStats *stats, ScanState *state);
+
+/**
+ * @brief Flushes any word left in the scan state at the end of the input
+ *        and notifies the hooks that the input stream has ended.
+ * @param stats A pointer to the AppStats struct to update.
+ * @param state A pointer to the ScanState used for the input.
+ */
+void analyze_finish(AppStats *stats, ScanState *state);
+
 /**
  * @brief Performs the core analysis of a text file.
  *
- * This function opens the specified file, reads it character by character,
- * and populates the provided AppStats struct with all collected statistics.
+ * This function opens the specified file, reads it in blocks, and populates
+ * the provided AppStats struct with all collected statistics. Unless the
+ * binary policy is BINARY_SCAN, the first block is sniffed first, and a
+ * binary input is skipped or only sampled; either way the hooks still see
+ * the end of the file, and skipping is not a failure.
  *
  * @param stats A pointer to an AppStats struct. The `filename`, `char_freq`,
  *        and `word_counts` members must be pre-initialized. The function
@@ -41,4 +161,64 @@ typedef struct
  */
 int analyze_file(AppStats *stats);
 
-#endif // ANALYZER_H
\ No newline at end of file
+/**
+ * @struct PartialResult
+ * @brief The statistics of one contiguous piece of an input, in a form that
+ *        can be merged with the pieces next to it.
+ *
+ * A piece can be cut anywhere, even inside a word, so what happens at its
+ * edges is kept open: the letters before its first non-letter (the head)
+ * and after its last non-letter (the tail, in the scan state's word buffer)
+ * are not yet words, and whether its first and last bytes are whitespace
+ * decides whether a whitespace-delimited word continues across an edge.
+ * Merging two adjacent pieces closes the word at their junction.
+ *
+ * partial_merge() is associative, so an input split any way (threads,
+ * chunks, nodes) and merged in order, in any grouping, gives the same
+ * statistics, including the order of the word table, as a single scan.
+ */
+typedef struct
+{
+    AppStats stats;           // Totals, histogram and the complete words inside the piece.
+    int char_freq[256];       // Storage for stats.char_freq.
+    ScanState state;          // Continues the scan; its word buffer holds the tail.
+    char head[MAX_WORD_LEN];  // The leading letters, lower case, truncated as words are.
+    int head_len;
+    int head_open;            // Non-zero while the piece is letters only: the head is all of it.
+    int starts_in_word;       // Non-zero if the first byte is not whitespace.
+} PartialResult;
+
+/**
+ * @brief Initializes an empty piece, the identity of partial_merge().
+ * @param table_size The number of buckets of its word table. Pieces that
+ *        are merged must use the size of the table they end up in.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int partial_init(PartialResult *part, int table_size);
+
+/**
+ * @brief Appends bytes to a piece.
+ */
+void partial_scan(PartialResult *part, const char *buf, size_t len);
+
+/**
+ * @brief Appends the piece `right` to the piece `left` that precedes it.
+ *
+ * `right` is consumed: only partial_free() may be called on it afterwards.
+ */
+void partial_merge(PartialResult *left, PartialResult *right);
+
+/**
+ * @brief Adds a piece that is a whole input to an analysis, closing its
+ *        head and tail as words, as analyze_finish() would.
+ * @param part The piece; it is consumed, as by partial_merge().
+ * @param stats The statistics to add it to. They must not have hooks.
+ */
+void partial_finish(PartialResult *part, AppStats *stats);
+
+/**
+ * @brief Frees the word table of a piece.
+ */
+void partial_free(PartialResult *part);
+
+#endif // ANALYZER_H
@@ -0,0 +1,282 @@
+/**
+ * @file cache.c
+ * @brief Implementation of the per-file result cache.
+ *
+ * An entry is a single header line followed by the file's results in the
+ * format of results.c:
+ *
+ *     analyzer-cache 1 <size> <mtime s> <mtime ns> <policy> <binary> <hash|->
+ *
+ * Entries are named "<device>-<inode>.res" in hexadecimal, so a file that
+ * changes replaces its own entry instead of leaving stale ones behind.
+ * They are written to a temporary name and renamed into place, so
+ * concurrent runs sharing a cache never see a partial entry.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.h"
+#include "results.h"
+
+static const char CACHE_MAGIC[] = "analyzer-cache 1";
+
+// Bytes read at a time while hashing a file.
+#define HASH_BUFFER_SIZE (1 << 20)
+
+/**
+ * @struct CacheKey
+ * @brief What an entry must match to be used.
+ */
+typedef struct
+{
+    long long size;
+    long long mtime_sec;
+    long mtime_nsec;
+    int policy;
+} CacheKey;
+
+static void key_from_stat(CacheKey *key, const struct stat *st, BinaryPolicy policy)
+{
+    key->size = (long long)st->st_size;
+    key->mtime_sec = (long long)st->st_mtim.tv_sec;
+    key->mtime_nsec = st->st_mtim.tv_nsec;
+    key->policy = (int)policy;
+}
+
+static bool keys_equal(const CacheKey *a, const CacheKey *b)
+{
+    return a->size == b->size && a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec &&
+           a->policy == b->policy;
+}
+
+static uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * @brief Hashes the contents of a file, eight bytes at a time.
+ * @return 0 on success, -1 if the file cannot be read.
+ */
+static int hash_file(const char *filename, uint64_t *hash)
+{
+    FILE *file = fopen(filename, "rb");
+    unsigned char *buffer = malloc(HASH_BUFFER_SIZE);
+    if (file == NULL || buffer == NULL)
+    {
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+        free(buffer);
+        return -1;
+    }
+
+    uint64_t h = 0x9E3779B97F4A7C15ULL;
+    uint64_t length = 0;
+    size_t n;
+    // fread() only returns a short count at the end of the file, so every
+    // buffer but the last is a whole number of words.
+    while ((n = fread(buffer, 1, HASH_BUFFER_SIZE, file)) > 0)
+    {
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            uint64_t k;
+            memcpy(&k, buffer + i, 8);
+            h = rotl64(h ^ (k * 0x87C37B91114253D5ULL), 31) * 0x4CF5AD432745937FULL;
+        }
+        if (i < n)
+        {
+            uint64_t k = 0;
+            memcpy(&k, buffer + i, n - i);
+            h = rotl64(h ^ (k * 0x87C37B91114253D5ULL), 31) * 0x4CF5AD432745937FULL;
+        }
+        length += n;
+    }
+    int failed = ferror(file);
+    fclose(file);
+    free(buffer);
+    if (failed)
+    {
+        return -1;
+    }
+
+    h ^= length; // Final avalanche (MurmurHash3's fmix64).
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    *hash = h;
+    return 0;
+}
+
+/**
+ * @brief Adds the cached result at `path` to `stats` if it matches.
+ * @return 0 on a hit, -1 on a miss (including a missing or damaged entry).
+ */
+static int lookup(const char *path, const CacheKey *key, const char *content_hash,
+                  AppStats *stats)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    char line[256], hash[32];
+    size_t magic_len = strlen(CACHE_MAGIC);
+    CacheKey found;
+    int binary;
+    bool matched = fgets(line, sizeof(line), file) != NULL &&
+                   strncmp(line, CACHE_MAGIC, magic_len) == 0 && line[magic_len] == ' ' &&
+                   sscanf(line + magic_len, "%lld %lld %ld %d %d %31s", &found.size,
+                          &found.mtime_sec, &found.mtime_nsec, &found.policy, &binary, hash) == 6 &&
+                   keys_equal(&found, key) &&
+                   (content_hash == NULL || strcmp(hash, content_hash) == 0);
+
+    Results *results = matched ? read_results(file, false) : NULL;
+    fclose(file);
+    if (results == NULL)
+    {
+        return -1;
+    }
+    add_results(stats, results);
+    stats->binary_files += binary;
+    free_results(results);
+    return 0;
+}
+
+/**
+ * @brief Writes an entry for the results in `file_stats`.
+ * @return 0 on success, -1 on failure.
+ */
+static int store(const char *path, const CacheKey *key, const char *content_hash,
+                 const AppStats *file_stats)
+{
+    char temp[PATH_MAX];
+    if (snprintf(temp, sizeof(temp), "%s.tmp.%ld", path, (long)getpid()) >= (int)sizeof(temp))
+    {
+        return -1;
+    }
+    FILE *file = fopen(temp, "w");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    fprintf(file, "%s %lld %lld %ld %d %d %s\n", CACHE_MAGIC, key->size, key->mtime_sec,
+            key->mtime_nsec, key->policy, file_stats->binary_files,
+            content_hash != NULL ? content_hash : "-");
+    int status = write_results(file_stats, file, false);
+    if ((fclose(file) != 0) | (status != 0) || rename(temp, path) != 0)
+    {
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds the statistics of one file to those of the whole run, leaving
+ *        the run's table (of the same size) as if the file had been
+ *        scanned into it directly.
+ */
+static void add_stats(AppStats *stats, const AppStats *file_stats)
+{
+    stats->char_count += file_stats->char_count;
+    stats->word_count += file_stats->word_count;
+    stats->line_count += file_stats->line_count;
+    stats->binary_files += file_stats->binary_files;
+    for (int c = 0; c < 256; c++)
+    {
+        stats->char_freq[c] += file_stats->char_freq[c];
+    }
+    merge_hash_table(stats->word_counts, file_stats->word_counts);
+}
+
+/**
+ * @brief Reads and analyzes a file, through the chunk cache if there is one.
+ */
+static int read_file(AppStats *stats, ChunkCache *chunks)
+{
+    return chunks != NULL ? dedup_analyze_file(stats, chunks) : analyze_file(stats);
+}
+
+int cached_analyze_file(AppStats *stats, const char *dir, bool verify, ChunkCache *chunks,
+                        CacheStats *counts)
+{
+    struct stat st;
+    char path[PATH_MAX];
+    if (strcmp(stats->filename, "-") == 0 || stat(stats->filename, &st) != 0 ||
+        !S_ISREG(st.st_mode) ||
+        snprintf(path, sizeof(path), "%s/%jx-%jx.res", dir, (uintmax_t)st.st_dev,
+                 (uintmax_t)st.st_ino) >= (int)sizeof(path))
+    {
+        counts->bypassed++;
+        return read_file(stats, chunks); // Also reports a file that cannot be opened.
+    }
+
+    CacheKey key;
+    key_from_stat(&key, &st, stats->binary_policy);
+    char hash_text[17];
+    const char *content_hash = NULL;
+    if (verify)
+    {
+        uint64_t hash;
+        if (hash_file(stats->filename, &hash) != 0)
+        {
+            counts->bypassed++;
+            return read_file(stats, chunks);
+        }
+        snprintf(hash_text, sizeof(hash_text), "%016" PRIx64, hash);
+        content_hash = hash_text;
+    }
+
+    if (lookup(path, &key, content_hash, stats) == 0)
+    {
+        counts->hits++;
+        return 0;
+    }
+    counts->misses++;
+
+    int char_freq[256] = {0};
+    AppStats file_stats = {0};
+    file_stats.filename = stats->filename;
+    file_stats.char_freq = char_freq;
+    // The same size as the run's table, so the chains can be replayed.
+    file_stats.word_counts = create_hash_table(stats->word_counts->size);
+    file_stats.binary_policy = stats->binary_policy;
+    if (file_stats.word_counts == NULL)
+    {
+        fprintf(stderr, "Fatal: Could not create hash table.\n");
+        return -1;
+    }
+    int status = read_file(&file_stats, chunks);
+    if (status == 0)
+    {
+        // A file that changed while it was read is not stored: its result
+        // may not match the size and time it would be stored under.
+        struct stat after;
+        CacheKey now;
+        bool unchanged = stat(stats->filename, &after) == 0;
+        if (unchanged)
+        {
+            key_from_stat(&now, &after, stats->binary_policy);
+            unchanged = keys_equal(&now, &key);
+        }
+        if (unchanged && store(path, &key, content_hash, &file_stats) != 0)
+        {
+            fprintf(stderr, "Warning: Could not store %s in the cache %s.\n", stats->filename, dir);
+        }
+        add_stats(stats, &file_stats);
+    }
+    free_hash_table(file_stats.word_counts);
+    return status;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file cache.h
+ * @brief Public interface for the per-file result cache.
+ *
+ * Batch jobs tend to re-analyze the same, unchanged files. With a cache
+ * directory, the result of each input file is stored under the file's
+ * device and inode number, together with its size, modification time and
+ * the binary policy it was analyzed under. When all of those still match,
+ * the file is answered from the cache without being opened, so a run over
+ * a directory costs in proportion to what changed.
+ *
+ * Size and modification time miss a change that restores both, so an
+ * entry can also record a hash of the contents. With verification on, the
+ * file is hashed (which is much cheaper than analyzing it) and the entry
+ * is only used if the hash matches.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include "analyzer.h"
+#include "dedup.h"
+
+/**
+ * @struct CacheStats
+ * @brief How the inputs of a run were answered.
+ */
+typedef struct
+{
+    int hits;     // Inputs answered from the cache.
+    int misses;   // Inputs analyzed and stored in the cache.
+    int bypassed; // Inputs that cannot be cached (standard input, pipes, ...).
+} CacheStats;
+
+/**
+ * @brief Analyzes `stats->filename` into `stats`, through the cache.
+ *
+ * On a hit, the cached result is added to `stats`. On a miss, the file is
+ * analyzed on its own, the result is stored, and then added to `stats`. A
+ * failure to store an entry is reported but does not fail the analysis.
+ * Scan hooks must not be installed, since a hit never scans the file.
+ *
+ * @param stats The statistics to add the file to.
+ * @param dir The cache directory, which must exist.
+ * @param verify Whether entries must also match a hash of the contents.
+ * @param chunks If not NULL, files that are read are analyzed through this
+ *        chunk cache (see dedup.h).
+ * @param counts Updated with how the file was answered.
+ * @return 0 on success, -1 if the file could not be analyzed.
+ */
+int cached_analyze_file(AppStats *stats, const char *dir, bool verify, ChunkCache *chunks,
+                        CacheStats *counts);
+
+#endif // CACHE_H
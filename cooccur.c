@@ -0,0 +1,256 @@
+/**
+ * @file cooccur.c
+ * @brief Implementation of word co-occurrence counting.
+ *
+ * Pair keys are hashed with a single multiply (Fibonacci hashing), which
+ * spreads the packed IDs well because both halves already vary densely.
+ * The table grows at 70% load; once it reaches PRUNE_CAPACITY slots and a
+ * minimum count is set, it is rebuilt without the rare pairs instead.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cooccur.h"
+
+// Initial number of slots in the pair table.
+#define INITIAL_CAPACITY (1 << 14)
+
+// Table size (16 bytes per slot) at which pruning replaces growth.
+#define PRUNE_CAPACITY (1 << 22)
+
+static size_t pair_index(uint64_t key, size_t capacity)
+{
+    return (size_t)((key * 0x9e3779b97f4a7c15ULL) >> 20) & (capacity - 1);
+}
+
+CooccurStats *create_cooccur_stats(int window, uint32_t min_count, int top)
+{
+    if (window < 1 || window > MAX_COOC_WINDOW)
+    {
+        return NULL;
+    }
+    CooccurStats *cs = calloc(1, sizeof(CooccurStats));
+    if (cs == NULL)
+    {
+        return NULL;
+    }
+    cs->words = create_interner();
+    cs->slots = calloc(INITIAL_CAPACITY, sizeof(PairSlot));
+    if (cs->words == NULL || cs->slots == NULL)
+    {
+        free_cooccur_stats(cs);
+        return NULL;
+    }
+    cs->capacity = INITIAL_CAPACITY;
+    cs->window = window;
+    cs->min_count = min_count > 0 ? min_count : 1;
+    cs->top = top;
+    return cs;
+}
+
+/**
+ * @brief Rebuilds the table with `capacity` slots, keeping only pairs seen
+ *        at least `keep_min` times.
+ * @return 0 on success, -1 on allocation failure (the table is unchanged).
+ */
+static int rebuild_table(CooccurStats *cs, size_t capacity, uint32_t keep_min)
+{
+    PairSlot *slots = calloc(capacity, sizeof(PairSlot));
+    if (slots == NULL)
+    {
+        return -1;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < cs->capacity; i++)
+    {
+        const PairSlot *old = &cs->slots[i];
+        if (old->count == 0 || old->count < keep_min)
+        {
+            continue;
+        }
+        size_t j = pair_index(old->key, capacity);
+        while (slots[j].count != 0)
+        {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = *old;
+        kept++;
+    }
+    cs->pruned += (long long)(cs->pairs - kept);
+    free(cs->slots);
+    cs->slots = slots;
+    cs->capacity = capacity;
+    cs->pairs = kept;
+    return 0;
+}
+
+/**
+ * @brief Makes room for one more pair, by pruning or by growing.
+ * @return 0 if there was room, 1 if the table was rebuilt to make room,
+ *         -1 if the table is full.
+ */
+static int make_room(CooccurStats *cs)
+{
+    if ((cs->pairs + 1) * 10 <= cs->capacity * 7)
+    {
+        return 0;
+    }
+    if (cs->min_count > 1 && cs->capacity >= PRUNE_CAPACITY &&
+        rebuild_table(cs, cs->capacity, cs->min_count) == 0)
+    {
+        cs->prunes++;
+        if (cs->pairs * 2 <= cs->capacity)
+        {
+            return 1; // Pruning freed enough; otherwise grow as well.
+        }
+    }
+    if (rebuild_table(cs, cs->capacity * 2, 1) == 0)
+    {
+        return 1;
+    }
+    return (cs->pairs + 1 < cs->capacity) ? 0 : -1;
+}
+
+static void count_pair(CooccurStats *cs, uint32_t a, uint32_t b)
+{
+    uint64_t key = (a < b) ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+    size_t mask = cs->capacity - 1;
+    size_t i = pair_index(key, cs->capacity);
+    while (cs->slots[i].count != 0 && cs->slots[i].key != key)
+    {
+        i = (i + 1) & mask;
+    }
+    if (cs->slots[i].count == 0)
+    {
+        int room = make_room(cs);
+        if (room < 0)
+        {
+            return;
+        }
+        if (room > 0)
+        {
+            // The table was rebuilt; find the pair's new empty slot.
+            mask = cs->capacity - 1;
+            i = pair_index(key, cs->capacity);
+            while (cs->slots[i].count != 0)
+            {
+                i = (i + 1) & mask;
+            }
+        }
+        cs->slots[i].key = key;
+        cs->pairs++;
+    }
+    if (cs->slots[i].count < UINT32_MAX)
+    {
+        cs->slots[i].count++;
+    }
+    cs->observations++;
+}
+
+void add_cooccur_token(CooccurStats *cs, const char *word)
+{
+    uint32_t id = intern_word(cs->words, word);
+    if (id == INTERN_FAILED)
+    {
+        return;
+    }
+    for (int k = 0; k < cs->recent_len; k++)
+    {
+        if (cs->recent[k] != id)
+        {
+            count_pair(cs, cs->recent[k], id);
+        }
+    }
+    cs->recent[cs->recent_pos] = id;
+    cs->recent_pos = (cs->recent_pos + 1) % cs->window;
+    if (cs->recent_len < cs->window)
+    {
+        cs->recent_len++;
+    }
+}
+
+static void cooccur_on_word(void *ctx, const char *word)
+{
+    add_cooccur_token(ctx, word);
+}
+
+/**
+ * @brief Empties the token window, so that no pair spans two inputs.
+ */
+static void cooccur_on_finish(void *ctx)
+{
+    CooccurStats *cs = ctx;
+    cs->recent_len = 0;
+    cs->recent_pos = 0;
+}
+
+void cooccur_scan_hook(CooccurStats *cs, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_word = cooccur_on_word;
+    hook->on_finish = cooccur_on_finish;
+    hook->ctx = cs;
+}
+
+void print_cooccur_stats(const CooccurStats *cs, FILE *output_stream)
+{
+    fprintf(output_stream, "Window:\t\t\t%d tokens\n", cs->window);
+    fprintf(output_stream, "Distinct Words:\t\t%u\n", cs->words->count);
+    fprintf(output_stream, "Distinct Pairs:\t\t%zu\n", cs->pairs);
+    fprintf(output_stream, "Pair Observations:\t%lld\n", cs->observations);
+    if (cs->prunes > 0)
+    {
+        fprintf(output_stream, "Pruned Pairs:\t\t%lld (in %d passes, below %u occurrences)\n",
+                cs->pruned, cs->prunes, cs->min_count);
+    }
+    if (cs->top <= 0 || cs->pairs == 0)
+    {
+        return;
+    }
+
+    // Select the most frequent pairs with a small insertion-sorted list.
+    const PairSlot **top = calloc((size_t)cs->top, sizeof(PairSlot *));
+    if (top == NULL)
+    {
+        return;
+    }
+    int top_len = 0;
+    for (size_t s = 0; s < cs->capacity; s++)
+    {
+        const PairSlot *slot = &cs->slots[s];
+        if (slot->count == 0 || slot->count < cs->min_count ||
+            (top_len == cs->top && top[top_len - 1]->count >= slot->count))
+        {
+            continue;
+        }
+        int i = (top_len < cs->top) ? top_len++ : cs->top - 1;
+        while (i > 0 && top[i - 1]->count < slot->count)
+        {
+            top[i] = top[i - 1];
+            i--;
+        }
+        top[i] = slot;
+    }
+
+    fprintf(output_stream, "  %-20s %-20s %s\n", "Word", "Word", "Count");
+    fprintf(output_stream, "  %-20s %-20s %s\n", "--------------------", "--------------------",
+            "-----");
+    for (int i = 0; i < top_len; i++)
+    {
+        fprintf(output_stream, "  %-20s %-20s %u\n",
+                interned_word(cs->words, (uint32_t)(top[i]->key >> 32)),
+                interned_word(cs->words, (uint32_t)top[i]->key), top[i]->count);
+    }
+    free(top);
+}
+
+void free_cooccur_stats(CooccurStats *cs)
+{
+    if (cs == NULL)
+    {
+        return;
+    }
+    free_interner(cs->words);
+    free(cs->slots);
+    free(cs);
+}
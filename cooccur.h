@@ -0,0 +1,97 @@
+/**
+ * @file cooccur.h
+ * @brief Public interface for word co-occurrence counting.
+ *
+ * Two words co-occur when they appear within K tokens of each other. Each
+ * word from the tokenizer is interned to a 32-bit ID, the last K IDs are
+ * kept in a ring, and every (earlier, current) pair is counted in a sparse
+ * open-addressing table keyed on the two IDs packed into one 64-bit key.
+ * Pairs are unordered: "error disk" and "disk error" are the same pair.
+ *
+ * On large corpora most pairs occur once or twice. With a minimum count,
+ * the table drops pairs below that count whenever it would otherwise grow
+ * past its pruning threshold, trading exactness for those rare pairs for
+ * bounded memory.
+ */
+
+#ifndef COOCCUR_H
+#define COOCCUR_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "analyzer.h"
+#include "intern.h"
+
+// The largest supported window, in tokens.
+#define MAX_COOC_WINDOW 64
+
+/**
+ * @struct PairSlot
+ * @brief One word pair in the table. An empty slot has count 0.
+ */
+typedef struct
+{
+    uint64_t key;   // Smaller ID in the high half, larger ID in the low half.
+    uint32_t count; // Number of times the pair co-occurred.
+} PairSlot;
+
+/**
+ * @struct CooccurStats
+ * @brief The co-occurrence table and the tokenizer window.
+ */
+typedef struct
+{
+    Interner *words;          // Word <-> ID mapping.
+    PairSlot *slots;          // Open-addressing table; capacity is a power of two.
+    size_t capacity;
+    size_t pairs;             // Occupied slots.
+    long long observations;   // Pair occurrences counted in total.
+    long long pruned;         // Pairs dropped by pruning.
+    int prunes;               // Number of pruning passes.
+    uint32_t min_count;       // Pairs below this are pruned and not reported.
+    int top;                  // Number of pairs listed in the report.
+
+    int window;               // K: how many previous tokens pair with each token.
+    uint32_t recent[MAX_COOC_WINDOW]; // Ring of the last K token IDs.
+    int recent_len;
+    int recent_pos;
+} CooccurStats;
+
+/**
+ * @brief Creates an empty co-occurrence table.
+ * @param window The window size K (1 to MAX_COOC_WINDOW).
+ * @param min_count Minimum count of a pair to be kept when pruning and to be
+ *        reported; 1 disables pruning.
+ * @param top The number of most frequent pairs to list in the report.
+ * @return A pointer to the new CooccurStats, or NULL on failure.
+ */
+CooccurStats *create_cooccur_stats(int window, uint32_t min_count, int top);
+
+/**
+ * @brief Fills in a ScanHook that feeds every frequency word to the table.
+ * @param cs A pointer to the CooccurStats.
+ * @param hook The hook to fill in.
+ */
+void cooccur_scan_hook(CooccurStats *cs, ScanHook *hook);
+
+/**
+ * @brief Adds one token, counting its pairs with the previous K tokens.
+ * @param cs A pointer to the CooccurStats.
+ * @param word The NUL-terminated token.
+ */
+void add_cooccur_token(CooccurStats *cs, const char *word);
+
+/**
+ * @brief Prints the table summary and the most frequent pairs.
+ * @param cs A pointer to the CooccurStats.
+ * @param output_stream The stream to write to.
+ */
+void print_cooccur_stats(const CooccurStats *cs, FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with a CooccurStats object.
+ * @param cs A pointer to the CooccurStats to be freed.
+ */
+void free_cooccur_stats(CooccurStats *cs);
+
+#endif // COOCCUR_H
@@ -0,0 +1,516 @@
+/**
+ * @file dedup.c
+ * @brief Implementation of deduplicated analysis by content-defined chunks.
+ *
+ * Boundaries follow the gear scheme: a 64-bit hash is shifted one bit per
+ * byte and a random value for the byte is added, so the top bits depend on
+ * the last few dozen bytes only. Once a chunk is CHUNK_MIN bytes long, a
+ * position whose top 16 bits are zero (or CHUNK_MAX bytes) arms a cut, and
+ * the cut is made after the next whitespace byte. Chunks are identified by a
+ * 128-bit hash of their bytes and their length.
+ *
+ * A chunk's words are kept in table order (see results.c), so adding its
+ * result to the run's table rebuilds the chains a direct scan would have
+ * built, and the word table comes out in the same order.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "dedup.h"
+#include "sniff.h"
+
+// Smallest chunk before a content-defined cut is considered.
+#define CHUNK_MIN (16 * 1024)
+// Chunk size after which the next whitespace byte ends the chunk regardless.
+#define CHUNK_MAX (256 * 1024)
+// Chunk size at which a chunk without whitespace is cut anyway.
+#define CHUNK_HARD (1024 * 1024)
+// A cut is armed where the top 16 bits of the gear hash are zero (1 in 65536).
+#define GEAR_MASK 0xFFFF000000000000ULL
+// Bytes sniffed at the start of each input, as analyze_file() reads them.
+
+/**
+ * @struct ChunkResult
+ * @brief The statistics of one distinct chunk.
+ */
+typedef struct ChunkResult
+{
+    uint64_t hash[2];
+    size_t length;
+    long long chars;
+    int words;
+    int lines;
+    int char_freq[256];
+    size_t word_count;         // Distinct frequency words.
+    int *counts;               // Their counts, in table order.
+    char *text;                // Their text, NUL-separated, in the same order.
+    size_t size;               // Bytes used by the result.
+    struct ChunkResult *next;  // The next result in the same bucket.
+} ChunkResult;
+
+struct ChunkCache
+{
+    ChunkResult **buckets;
+    size_t bucket_count; // A power of two.
+    size_t entries;
+    size_t used;         // Bytes used by the cached results.
+    size_t mem_limit;
+    uint64_t gear[256];
+    DedupStats stats;
+};
+
+static uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+/**
+ * @brief Hashes a chunk with two independent 64-bit multiply-rotate lanes.
+ */
+static void hash_chunk(const char *buf, size_t len, uint64_t hash[2])
+{
+    uint64_t h1 = 0x9E3779B97F4A7C15ULL, h2 = 0xD6E8FEB86659FD93ULL;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t k;
+        memcpy(&k, buf + i, 8);
+        h1 = rotl64(h1 ^ (k * 0x87C37B91114253D5ULL), 31) * 0x4CF5AD432745937FULL;
+        h2 = rotl64(h2 ^ (k * 0x4CF5AD432745937FULL), 33) * 0x87C37B91114253D5ULL;
+    }
+    uint64_t k = 0;
+    memcpy(&k, buf + i, len - i);
+    h1 = rotl64(h1 ^ (k * 0x87C37B91114253D5ULL), 31) * 0x4CF5AD432745937FULL;
+    h2 = rotl64(h2 ^ (k * 0x4CF5AD432745937FULL), 33) * 0x87C37B91114253D5ULL;
+    hash[0] = fmix64(h1 ^ (uint64_t)len);
+    hash[1] = fmix64(h2 ^ rotl64((uint64_t)len, 32));
+}
+
+static int is_space(unsigned char c)
+{
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t'; // As the word count sees it.
+}
+
+ChunkCache *create_chunk_cache(size_t mem_limit)
+{
+    ChunkCache *cache = calloc(1, sizeof(ChunkCache));
+    if (cache == NULL)
+    {
+        return NULL;
+    }
+    cache->bucket_count = 1024;
+    cache->buckets = calloc(cache->bucket_count, sizeof(ChunkResult *));
+    if (cache->buckets == NULL)
+    {
+        free(cache);
+        return NULL;
+    }
+    cache->mem_limit = mem_limit;
+
+    uint64_t seed = 0x2545F4914F6CDD1DULL; // splitmix64, so boundaries are the same every run.
+    for (int i = 0; i < 256; i++)
+    {
+        seed += 0x9E3779B97F4A7C15ULL;
+        cache->gear[i] = fmix64(seed);
+    }
+    return cache;
+}
+
+/**
+ * @brief Returns the length of the chunk starting at `buf`.
+ * @param avail The bytes available; fewer than CHUNK_HARD only at the end of input.
+ * @param clean_end Set if the chunk ends just after whitespace.
+ */
+static size_t find_cut(const ChunkCache *cache, const char *buf, size_t avail, int *clean_end)
+{
+    uint64_t h = 0;
+    int armed = 0;
+    size_t limit = avail < CHUNK_HARD ? avail : CHUNK_HARD;
+    for (size_t i = 0; i < limit; i++)
+    {
+        unsigned char c = (unsigned char)buf[i];
+        h = (h << 1) + cache->gear[c];
+        if (i + 1 >= CHUNK_MIN && ((h & GEAR_MASK) == 0 || i + 1 >= CHUNK_MAX))
+        {
+            armed = 1;
+        }
+        if (armed && is_space(c))
+        {
+            *clean_end = 1;
+            return i + 1;
+        }
+    }
+    *clean_end = limit > 0 && is_space((unsigned char)buf[limit - 1]);
+    return limit;
+}
+
+static ChunkResult *find_result(const ChunkCache *cache, const uint64_t hash[2], size_t length)
+{
+    for (ChunkResult *r = cache->buckets[hash[0] & (cache->bucket_count - 1)]; r != NULL;
+         r = r->next)
+    {
+        if (r->hash[0] == hash[0] && r->hash[1] == hash[1] && r->length == length)
+        {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+static void free_result(ChunkResult *r)
+{
+    free(r->counts);
+    free(r->text);
+    free(r);
+}
+
+/**
+ * @brief Keeps a result in the cache if it fits in the budget.
+ * @return 1 if the cache now owns the result, 0 if the caller must free it.
+ */
+static int keep_result(ChunkCache *cache, ChunkResult *r)
+{
+    if (cache->used + r->size > cache->mem_limit)
+    {
+        return 0;
+    }
+    if (cache->entries >= cache->bucket_count)
+    {
+        size_t grown = cache->bucket_count * 2;
+        ChunkResult **buckets = calloc(grown, sizeof(ChunkResult *));
+        if (buckets != NULL)
+        {
+            for (size_t b = 0; b < cache->bucket_count; b++)
+            {
+                ChunkResult *next;
+                for (ChunkResult *e = cache->buckets[b]; e != NULL; e = next)
+                {
+                    next = e->next;
+                    e->next = buckets[e->hash[0] & (grown - 1)];
+                    buckets[e->hash[0] & (grown - 1)] = e;
+                }
+            }
+            free(cache->buckets);
+            cache->buckets = buckets;
+            cache->bucket_count = grown;
+        }
+    }
+    size_t b = r->hash[0] & (cache->bucket_count - 1);
+    r->next = cache->buckets[b];
+    cache->buckets[b] = r;
+    cache->entries++;
+    cache->used += r->size;
+    return 1;
+}
+
+/**
+ * @brief Analyzes a chunk on its own and captures the result.
+ * @param at_end Whether the chunk ends the input (its last word is flushed).
+ * @return The result, or NULL on allocation failure.
+ */
+static ChunkResult *analyze_chunk(const char *buf, size_t len, int at_end, int table_size)
+{
+    ChunkResult *r = calloc(1, sizeof(ChunkResult));
+    HashTable *words = create_hash_table(table_size);
+    if (r == NULL || words == NULL)
+    {
+        free(r);
+        free_hash_table(words);
+        return NULL;
+    }
+
+    AppStats chunk = {0};
+    chunk.char_freq = r->char_freq;
+    chunk.word_counts = words;
+    ScanState state;
+    scan_state_init(&state);
+    analyze_buffer(&chunk, &state, buf, len);
+    if (at_end)
+    {
+        analyze_finish(&chunk, &state);
+    }
+    r->chars = chunk.char_count;
+    r->words = chunk.word_count;
+    r->lines = chunk.line_count;
+
+    size_t count = 0, letters = 0, longest = 0;
+    for (int b = 0; b < words->size; b++)
+    {
+        size_t n = 0;
+        for (Node *node = words->table[b]; node != NULL; node = node->next)
+        {
+            letters += strlen(node->word) + 1;
+            n++;
+        }
+        count += n;
+        longest = n > longest ? n : longest;
+    }
+    r->counts = malloc((count > 0 ? count : 1) * sizeof(int));
+    r->text = malloc(letters > 0 ? letters : 1);
+    Node **chain = malloc((longest > 0 ? longest : 1) * sizeof(Node *));
+    if (r->counts == NULL || r->text == NULL || chain == NULL)
+    {
+        free(chain);
+        free_hash_table(words);
+        free_result(r);
+        return NULL;
+    }
+
+    // Oldest word of each chain first, so that adding the words back in
+    // this order pushes them onto the run's chains in scan order.
+    char *p = r->text;
+    for (int b = 0; b < words->size; b++)
+    {
+        size_t n = 0;
+        for (Node *node = words->table[b]; node != NULL; node = node->next)
+        {
+            chain[n++] = node;
+        }
+        while (n > 0)
+        {
+            n--;
+            size_t bytes = strlen(chain[n]->word) + 1;
+            memcpy(p, chain[n]->word, bytes);
+            p += bytes;
+            r->counts[r->word_count++] = chain[n]->count;
+        }
+    }
+    free(chain);
+    free_hash_table(words);
+    r->length = len;
+    r->size = sizeof(ChunkResult) + count * sizeof(int) + letters;
+    return r;
+}
+
+/**
+ * @brief Adds a chunk's result to the statistics of the run.
+ */
+static void add_result(AppStats *stats, const ChunkResult *r)
+{
+    stats->char_count += r->chars;
+    stats->word_count += r->words;
+    stats->line_count += r->lines;
+    for (int c = 0; c < 256; c++)
+    {
+        stats->char_freq[c] += r->char_freq[c];
+    }
+    const char *word = r->text;
+    for (size_t i = 0; i < r->word_count; i++)
+    {
+        add_word_count(stats->word_counts, word, r->counts[i]);
+        word += strlen(word) + 1;
+    }
+}
+
+/**
+ * @brief Classifies the start of an input as analyze_file() does, and
+ *        applies the binary policy to the bytes read so far.
+ * @param end The bytes read; cut back to what may be analyzed.
+ * @param limit Set to the bytes still to be read when sampling.
+ * @param eof Set if nothing more is to be read.
+ */
+static void sniff_start(AppStats *stats, const char *buffer, size_t *end, long long *limit,
+                        int *eof)
+{
+    SniffResult sniff;
+    sniff_content(buffer, *end < SNIFF_BYTES ? *end : SNIFF_BYTES, &sniff);
+    if (!sniff.is_binary)
+    {
+        return;
+    }
+    stats->binary_files++;
+    fprintf(stderr, "Note: %s looks binary (%zu NUL, %zu control, %zu invalid UTF-8 "
+            "in the first %zu bytes); %s.\n", stats->filename, sniff.nul_bytes,
+            sniff.control, sniff.invalid_utf8, sniff.bytes,
+            stats->binary_policy == BINARY_SKIP ? "skipping it" : "sampling its start");
+    if (stats->binary_policy == BINARY_SKIP)
+    {
+        *end = 0;
+        *eof = 1;
+    }
+    else if (*end >= BINARY_SAMPLE_BYTES)
+    {
+        *end = BINARY_SAMPLE_BYTES;
+        *eof = 1;
+    }
+    else
+    {
+        *limit = BINARY_SAMPLE_BYTES - (long long)*end;
+    }
+}
+
+/**
+ * @brief Accounts for one chunk: from the cache, analyzed and cached, or
+ *        (if it does not start and end cleanly) scanned in place.
+ */
+static void process_chunk(ChunkCache *cache, AppStats *stats, ScanState *live, const char *buf,
+                          size_t len, int clean_start, int clean_end, int at_end)
+{
+    cache->stats.chunks++;
+    cache->stats.bytes += (long long)len;
+    if (clean_start)
+    {
+        scan_state_init(live); // Just after whitespace, the scan state is the initial one.
+    }
+    if (!clean_start || !(clean_end || at_end))
+    {
+        analyze_buffer(stats, live, buf, len);
+        return;
+    }
+
+    uint64_t hash[2];
+    hash_chunk(buf, len, hash);
+    const ChunkResult *found = find_result(cache, hash, len);
+    if (found != NULL)
+    {
+        cache->stats.reused++;
+        cache->stats.reused_bytes += (long long)len;
+        add_result(stats, found);
+        return;
+    }
+
+    ChunkResult *r = analyze_chunk(buf, len, at_end, stats->word_counts->size);
+    if (r == NULL)
+    {
+        analyze_buffer(stats, live, buf, len); // Out of memory: scan it in place instead.
+        return;
+    }
+    r->hash[0] = hash[0];
+    r->hash[1] = hash[1];
+    add_result(stats, r);
+    if (!keep_result(cache, r))
+    {
+        free_result(r);
+    }
+}
+
+int dedup_analyze_file(AppStats *stats, ChunkCache *cache)
+{
+    int use_stdin = strcmp(stats->filename, "-") == 0;
+    int fd = use_stdin ? STDIN_FILENO : open(stats->filename, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Error opening file");
+        return -1;
+    }
+    size_t capacity = 2 * CHUNK_HARD;
+    char *buffer = malloc(capacity);
+    if (buffer == NULL)
+    {
+        if (!use_stdin)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+
+    ScanState live;
+    scan_state_init(&live);
+    size_t start = 0, end = 0;      // The unprocessed bytes are buffer[start, end).
+    long long limit = -1;           // Bytes left to read when sampling a binary input, or -1.
+    int eof = 0, first = 1, status = 0, clean_start = 1;
+    for (;;)
+    {
+        // Keep at least CHUNK_HARD bytes ahead of the cut search until the end.
+        if (!eof && end - start < CHUNK_HARD)
+        {
+            memmove(buffer, buffer + start, end - start);
+            end -= start;
+            start = 0;
+            while (!eof && end < capacity)
+            {
+                ssize_t n = read(fd, buffer + end, capacity - end);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n < 0)
+                {
+                    perror("Error reading file");
+                    status = -1;
+                    eof = 1;
+                    break;
+                }
+                if (n == 0)
+                {
+                    eof = 1;
+                    break;
+                }
+                if (limit >= 0 && n > limit)
+                {
+                    n = (ssize_t)limit;
+                }
+                end += (size_t)n;
+                if (limit >= 0 && (limit -= n) == 0)
+                {
+                    eof = 1;
+                }
+            }
+            if (first && end > 0 && stats->binary_policy != BINARY_SCAN)
+            {
+                sniff_start(stats, buffer, &end, &limit, &eof);
+            }
+            first = 0;
+        }
+        if (status != 0 || start == end)
+        {
+            break;
+        }
+
+        int clean_end;
+        size_t len = find_cut(cache, buffer + start, end - start, &clean_end);
+        int at_end = eof && start + len == end;
+        process_chunk(cache, stats, &live, buffer + start, len, clean_start, clean_end, at_end);
+        clean_start = clean_end;
+        start += len;
+    }
+    analyze_finish(stats, &live); // Flushes the last word if it was scanned in place.
+
+    free(buffer);
+    if (!use_stdin)
+    {
+        close(fd);
+    }
+    return status;
+}
+
+const DedupStats *chunk_cache_stats(const ChunkCache *cache)
+{
+    return &cache->stats;
+}
+
+void free_chunk_cache(ChunkCache *cache)
+{
+    if (cache == NULL)
+    {
+        return;
+    }
+    for (size_t b = 0; b < cache->bucket_count; b++)
+    {
+        ChunkResult *next;
+        for (ChunkResult *r = cache->buckets[b]; r != NULL; r = next)
+        {
+            next = r->next;
+            free_result(r);
+        }
+    }
+    free(cache->buckets);
+    free(cache);
+}
@@ -0,0 +1,73 @@
+/**
+ * @file dedup.h
+ * @brief Public interface for deduplicated analysis by content-defined chunks.
+ *
+ * Log collections often hold the same bytes many times over: replicated
+ * copies, rotated files that overlap, archives of archives. In dedup mode
+ * each input is cut into chunks at content-defined boundaries, found with a
+ * rolling (gear) hash, so an identical region produces identical chunks
+ * wherever it sits in whichever file. Each distinct chunk is analyzed once;
+ * its result (totals, character counts and words) is kept in a chunk cache
+ * keyed by a hash of its bytes and added again for every repeat.
+ *
+ * Words must not be split by a cut, so chunks only end just after a
+ * whitespace byte, where the scan is back in its initial state. A chunk that
+ * reaches the hard size limit without whitespace is cut anyway; it, and the
+ * chunk that follows it, are analyzed in place with the state carried over
+ * and are not cached.
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stddef.h>
+#include "analyzer.h"
+
+/**
+ * @struct ChunkCache
+ * @brief The results of the distinct chunks seen so far (opaque).
+ */
+typedef struct ChunkCache ChunkCache;
+
+/**
+ * @struct DedupStats
+ * @brief How much of the input was answered from the chunk cache.
+ */
+typedef struct
+{
+    long long chunks;       // Chunks cut.
+    long long reused;       // Chunks answered from the cache.
+    long long bytes;        // Bytes in all chunks.
+    long long reused_bytes; // Bytes in the reused chunks.
+} DedupStats;
+
+/**
+ * @brief Creates an empty chunk cache.
+ * @param mem_limit Bytes of chunk results to keep; once full, new chunks are
+ *        still analyzed but no longer cached.
+ * @return The cache, or NULL on allocation failure.
+ */
+ChunkCache *create_chunk_cache(size_t mem_limit);
+
+/**
+ * @brief Analyzes `stats->filename` into `stats` chunk by chunk, reusing the
+ *        results of chunks seen before.
+ *
+ * The statistics are the same as those of analyze_file(), including the
+ * order of the word table. Scan hooks must not be installed.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int dedup_analyze_file(AppStats *stats, ChunkCache *cache);
+
+/**
+ * @brief Returns the running totals of a chunk cache.
+ */
+const DedupStats *chunk_cache_stats(const ChunkCache *cache);
+
+/**
+ * @brief Frees a chunk cache and every result in it.
+ */
+void free_chunk_cache(ChunkCache *cache);
+
+#endif // DEDUP_H
@@ -0,0 +1,374 @@
+/**
+ * @file delim.c
+ * @brief Implementation of column-aware analysis of delimited files.
+ *
+ * The splitter is a small state machine that survives buffer boundaries.
+ * Inside unquoted fields it jumps straight to the next delimiter or newline
+ * (16 bytes at a time with SSE2 where available) and copies the run in one
+ * go; inside quoted fields it jumps to the next double quote with memchr().
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "delim.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The initial number of buckets in each column's distinct-value table,
+// which grows with the number of distinct values.
+#define DISTINCT_TABLE_SIZE 64
+
+// Splitter states.
+enum
+{
+    FIELD_START,    // At the first byte of a field.
+    UNQUOTED,       // Inside a field that did not start with a quote.
+    QUOTED,         // Inside a quoted field.
+    QUOTE_IN_QUOTED // Just saw a quote inside a quoted field ("" or the end).
+};
+
+DelimStats *create_delim_stats(char delimiter, int quoted, int has_header)
+{
+    DelimStats *ds = calloc(1, sizeof(DelimStats));
+    if (ds == NULL)
+    {
+        return NULL;
+    }
+    ds->delimiter = delimiter;
+    ds->quoted = quoted;
+    ds->has_header = has_header;
+    ds->header_pending = has_header;
+    ds->state = FIELD_START;
+    return ds;
+}
+
+/**
+ * @brief Appends bytes to the current field, growing its buffer as needed.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int append_field(DelimStats *ds, const char *bytes, size_t len)
+{
+    if (ds->field_len + len + 1 > ds->field_cap)
+    {
+        size_t cap = ds->field_cap ? ds->field_cap : 256;
+        while (cap < ds->field_len + len + 1)
+        {
+            cap *= 2;
+        }
+        char *grown = realloc(ds->field, cap);
+        if (grown == NULL)
+        {
+            return -1;
+        }
+        ds->field = grown;
+        ds->field_cap = cap;
+    }
+    memcpy(ds->field + ds->field_len, bytes, len);
+    ds->field_len += len;
+    return 0;
+}
+
+/**
+ * @brief Returns the column for the current field, creating it if needed.
+ */
+static ColumnStats *current_column(DelimStats *ds)
+{
+    if (ds->column >= ds->column_count)
+    {
+        ColumnStats *grown = realloc(ds->columns, (ds->column + 1) * sizeof(ColumnStats));
+        if (grown == NULL)
+        {
+            return NULL;
+        }
+        ds->columns = grown;
+        while (ds->column_count <= ds->column)
+        {
+            ColumnStats *col = &ds->columns[ds->column_count++];
+            memset(col, 0, sizeof(*col));
+            col->distinct = create_growing_hash_table(DISTINCT_TABLE_SIZE);
+        }
+    }
+    return &ds->columns[ds->column];
+}
+
+/**
+ * @brief Records the completed current field in its column.
+ */
+static void end_field(DelimStats *ds)
+{
+    if (append_field(ds, "", 0) == 0)
+    {
+        ds->field[ds->field_len] = '\0';
+    }
+
+    ColumnStats *col = current_column(ds);
+    if (col != NULL && ds->field != NULL)
+    {
+        if (ds->header_pending)
+        {
+            free(col->name);
+            col->name = strdup(ds->field);
+        }
+        else
+        {
+            col->values++;
+            col->chars += (long long)ds->field_len;
+            if (ds->field_len == 0)
+            {
+                col->empty++;
+            }
+            if ((long long)ds->field_len > col->max_len)
+            {
+                col->max_len = (long long)ds->field_len;
+            }
+
+            int in_word = 0;
+            for (size_t i = 0; i < ds->field_len; i++)
+            {
+                int space = isspace((unsigned char)ds->field[i]);
+                col->words += (!space && !in_word);
+                in_word = !space;
+            }
+
+            insert_word(col->distinct, ds->field);
+        }
+    }
+
+    ds->column++;
+    ds->field_len = 0;
+    ds->state = FIELD_START;
+}
+
+/**
+ * @brief Finishes the current row after its last field was recorded.
+ */
+static void end_row(DelimStats *ds)
+{
+    if (ds->header_pending)
+    {
+        ds->header_pending = 0;
+        ds->expected_fields = ds->column;
+    }
+    else
+    {
+        ds->rows++;
+        if (ds->expected_fields == 0)
+        {
+            ds->expected_fields = ds->column;
+        }
+        else if (ds->column != ds->expected_fields)
+        {
+            ds->ragged_rows++;
+        }
+    }
+    ds->column = 0;
+}
+
+/**
+ * @brief Returns the offset of the first delimiter or newline in `data`,
+ *        or `len` if there is none.
+ */
+static size_t find_separator(const char *data, size_t len, char delimiter)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i delim = _mm_set1_epi8(delimiter);
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, delim), _mm_cmpeq_epi8(v, newline));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+#endif
+    for (; i < len; i++)
+    {
+        if (data[i] == delimiter || data[i] == '\n')
+        {
+            return i;
+        }
+    }
+    return len;
+}
+
+void scan_delimited(DelimStats *ds, const char *buf, size_t len)
+{
+    size_t i = 0;
+    while (i < len)
+    {
+        if (ds->state == QUOTED)
+        {
+            const char *quote = memchr(buf + i, '"', len - i);
+            size_t end = (quote != NULL) ? (size_t)(quote - buf) : len;
+            append_field(ds, buf + i, end - i);
+            if (quote == NULL)
+            {
+                return; // The quoted field continues in the next buffer.
+            }
+            i = end + 1;
+            ds->state = QUOTE_IN_QUOTED;
+            continue;
+        }
+
+        if (ds->state == QUOTE_IN_QUOTED)
+        {
+            if (buf[i] == '"')
+            {
+                append_field(ds, "\"", 1); // An escaped ("") quote.
+                ds->state = QUOTED;
+                i++;
+                continue;
+            }
+            ds->state = UNQUOTED; // The closing quote; anything else is literal.
+        }
+        else if (ds->state == FIELD_START)
+        {
+            ds->state = UNQUOTED;
+            if (ds->quoted && buf[i] == '"')
+            {
+                ds->state = QUOTED;
+                i++;
+                continue;
+            }
+        }
+
+        size_t end = i + find_separator(buf + i, len - i, ds->delimiter);
+        append_field(ds, buf + i, end - i);
+        if (end == len)
+        {
+            return; // The field continues in the next buffer.
+        }
+        i = end + 1;
+
+        if (buf[end] == ds->delimiter)
+        {
+            end_field(ds);
+        }
+        else
+        {
+            // Newline: strip a "\r" left by CRLF line endings. A blank line
+            // (a single empty field) is not a row.
+            if (ds->field_len > 0 && ds->field[ds->field_len - 1] == '\r')
+            {
+                ds->field_len--;
+            }
+            if (ds->column == 0 && ds->field_len == 0)
+            {
+                ds->state = FIELD_START;
+                continue;
+            }
+            end_field(ds);
+            end_row(ds);
+        }
+    }
+}
+
+void finish_delimited(DelimStats *ds)
+{
+    if (ds->column > 0 || ds->field_len > 0 || ds->state != FIELD_START)
+    {
+        end_field(ds);
+        end_row(ds);
+    }
+    ds->header_pending = ds->has_header; // The next file starts with its own header.
+}
+
+static void delim_on_buffer(void *ctx, const char *buf, size_t len)
+{
+    scan_delimited(ctx, buf, len);
+}
+
+static void delim_on_finish(void *ctx)
+{
+    finish_delimited(ctx);
+}
+
+void delim_scan_hook(DelimStats *ds, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = delim_on_buffer;
+    hook->on_finish = delim_on_finish;
+    hook->ctx = ds;
+}
+
+void print_column_stats(const DelimStats *ds, FILE *output_stream)
+{
+    fprintf(output_stream, "Rows: %lld", ds->rows);
+    if (ds->ragged_rows > 0)
+    {
+        fprintf(output_stream, " (%lld with a different number of fields)", ds->ragged_rows);
+    }
+    fprintf(output_stream, "\n");
+    fprintf(output_stream, "  %-4s %-20s %-10s %-8s %-10s %-8s %-8s %-10s %s\n", "#", "Column",
+            "Values", "Empty", "Distinct", "AvgLen", "MaxLen", "Words", "Top Value");
+    fprintf(output_stream, "  %-4s %-20s %-10s %-8s %-10s %-8s %-8s %-10s %s\n", "----",
+            "--------------------", "------", "-----", "--------", "------", "------", "-----",
+            "---------");
+
+    for (int c = 0; c < ds->column_count; c++)
+    {
+        const ColumnStats *col = &ds->columns[c];
+        long long distinct = 0;
+        const Node *top = NULL;
+        for (int b = 0; col->distinct != NULL && b < col->distinct->size; b++)
+        {
+            for (const Node *n = col->distinct->table[b]; n != NULL; n = n->next)
+            {
+                distinct++;
+                // Ties go to the smaller value, so the bucket order does not matter.
+                if (top == NULL || n->count > top->count ||
+                    (n->count == top->count && strcmp(n->word, top->word) < 0))
+                {
+                    top = n;
+                }
+            }
+        }
+
+        char name[32];
+        if (col->name != NULL)
+        {
+            snprintf(name, sizeof(name), "%.20s", col->name);
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "column %d", c + 1);
+        }
+        double avg = col->values > 0 ? (double)col->chars / (double)col->values : 0.0;
+        fprintf(output_stream, "  %-4d %-20s %-10lld %-8lld %-10lld %-8.1f %-8lld %-10lld ", c + 1,
+                name, col->values, col->empty, distinct, avg, col->max_len, col->words);
+        if (top != NULL)
+        {
+            fprintf(output_stream, "%.30s (%d)\n", top->word[0] != '\0' ? top->word : "(empty)",
+                    top->count);
+        }
+        else
+        {
+            fprintf(output_stream, "-\n");
+        }
+    }
+}
+
+void free_delim_stats(DelimStats *ds)
+{
+    if (ds == NULL)
+    {
+        return;
+    }
+    for (int c = 0; c < ds->column_count; c++)
+    {
+        free(ds->columns[c].name);
+        free_hash_table(ds->columns[c].distinct);
+    }
+    free(ds->columns);
+    free(ds->field);
+    free(ds);
+}
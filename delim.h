@@ -0,0 +1,102 @@
+/**
+ * @file delim.h
+ * @brief Public interface for column-aware analysis of delimited files.
+ *
+ * In delimited mode every line is split into fields (TSV, CSV with RFC 4180
+ * quoting, or any single-character delimiter) and statistics are kept per
+ * column: number of values, empty values, characters, words, and distinct
+ * values. The splitting runs on the scan loop's buffers, so the per-field
+ * profiles come out of the same single pass as the regular report.
+ */
+
+#ifndef DELIM_H
+#define DELIM_H
+
+#include <stdio.h>
+#include "analyzer.h"
+
+/**
+ * @struct ColumnStats
+ * @brief The statistics collected for a single column.
+ */
+typedef struct
+{
+    char *name;          // Header name, or NULL without --header.
+    long long values;    // Number of fields seen in this column.
+    long long empty;     // Number of those fields that were empty.
+    long long chars;     // Total characters in all fields.
+    long long words;     // Total whitespace-separated words in all fields.
+    long long max_len;   // Length of the longest field.
+    HashTable *distinct; // Every distinct value and how often it occurred.
+} ColumnStats;
+
+/**
+ * @struct DelimStats
+ * @brief The per-column statistics and the field splitter's state.
+ */
+typedef struct
+{
+    char delimiter;        // The field separator.
+    int quoted;            // Non-zero for CSV-style double-quote handling.
+    int has_header;        // Non-zero if the first row names the columns.
+
+    ColumnStats *columns;  // Statistics per column.
+    int column_count;      // Number of columns seen so far.
+    long long rows;        // Data rows (excluding the header and blank lines).
+    long long ragged_rows; // Rows whose field count differs from the first row.
+    int expected_fields;   // Field count of the first row (0 until known).
+
+    // --- Splitter state carried between buffers ---
+    int state;             // Where in a field the splitter is.
+    int header_pending;    // Non-zero while reading the header row.
+    int column;            // Index of the current field within its row.
+    char *field;           // The current field's bytes (NUL-terminated when complete).
+    size_t field_len;
+    size_t field_cap;
+} DelimStats;
+
+/**
+ * @brief Creates an empty set of column statistics.
+ * @param delimiter The field separator character.
+ * @param quoted Non-zero to honour CSV double-quote rules.
+ * @param has_header Non-zero if the first row holds column names.
+ * @return A pointer to the new DelimStats, or NULL on failure.
+ */
+DelimStats *create_delim_stats(char delimiter, int quoted, int has_header);
+
+/**
+ * @brief Fills in a ScanHook that splits every scanned buffer into fields.
+ * @param ds A pointer to the DelimStats.
+ * @param hook The hook to fill in.
+ */
+void delim_scan_hook(DelimStats *ds, ScanHook *hook);
+
+/**
+ * @brief Splits a buffer into fields, updating the column statistics.
+ * @param ds A pointer to the DelimStats.
+ * @param buf The bytes to process.
+ * @param len The number of bytes in `buf`.
+ */
+void scan_delimited(DelimStats *ds, const char *buf, size_t len);
+
+/**
+ * @brief Completes a final row that was not terminated by a newline, at the
+ *        end of each input file.
+ * @param ds A pointer to the DelimStats.
+ */
+void finish_delimited(DelimStats *ds);
+
+/**
+ * @brief Prints the per-column statistics table to the given stream.
+ * @param ds A pointer to the DelimStats.
+ * @param output_stream The stream to write to.
+ */
+void print_column_stats(const DelimStats *ds, FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with a DelimStats object.
+ * @param ds A pointer to the DelimStats to be freed.
+ */
+void free_delim_stats(DelimStats *ds);
+
+#endif // DELIM_H
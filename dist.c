@@ -0,0 +1,676 @@
+/**
+ * @file dist.c
+ * @brief Implementation of the analysis by worker processes.
+ *
+ * Messages (integers are unsigned, little-endian; u8 is one byte, u64 eight):
+ *
+ *     range request:  u8 'R', u64 table size, u64 start, u64 end,
+ *                     u64 name length, name bytes
+ *     quit request:   u8 'Q'
+ *     reply:          u8 status (0 = ok, 1 = the range could not be read),
+ *                     then, if ok, the partial result:
+ *                     u64 characters, u64 words, u64 lines, 256 x u64
+ *                     character counts, u8 head length, head, u8 head open,
+ *                     u8 starts in word, u8 tail length, tail, u8 in word,
+ *                     u64 word count, then per word (in walk_hash_table()
+ *                     order): u8 length, letters, u64 count
+ *
+ * Sending the words in walk order lets the coordinator rebuild the worker's
+ * table exactly, so merging gives the word table order of a single scan.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "dist.h"
+#include "outbuf.h"
+#include "parallel.h"
+
+// Bytes requested per pread() call, and the size of a socket read buffer.
+#define READ_SIZE 65536
+
+// The smallest range worth handing to a worker of its own.
+#define MIN_RANGE_BYTES (8LL << 20)
+
+// The most worker processes.
+#define MAX_PROCS 64
+
+#define MSG_RANGE 'R'
+#define MSG_QUIT 'Q'
+
+/**
+ * @struct WireReader
+ * @brief Buffered reads of whole values from a socket.
+ */
+typedef struct
+{
+    int fd;
+    size_t pos; // Next unread byte in `buf`.
+    size_t len; // Bytes in `buf`.
+    char buf[READ_SIZE];
+} WireReader;
+
+static void put_u8(OutBuf *out, unsigned value)
+{
+    char c = (char)value;
+    out_bytes(out, &c, 1);
+}
+
+static size_t encode_u64(unsigned char *p, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+    return 8;
+}
+
+static void put_u64(OutBuf *out, uint64_t value)
+{
+    unsigned char bytes[8];
+    encode_u64(bytes, value);
+    out_bytes(out, (const char *)bytes, 8);
+}
+
+/**
+ * @return 0 on success, -1 at the end of the stream or on an error.
+ */
+static int get_bytes(WireReader *in, void *dst, size_t n)
+{
+    char *p = dst;
+    while (n > 0)
+    {
+        if (in->pos == in->len)
+        {
+            ssize_t got = read(in->fd, in->buf, sizeof(in->buf));
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got <= 0)
+            {
+                return -1;
+            }
+            in->pos = 0;
+            in->len = (size_t)got;
+        }
+        size_t take = in->len - in->pos < n ? in->len - in->pos : n;
+        memcpy(p, in->buf + in->pos, take);
+        in->pos += take;
+        p += take;
+        n -= take;
+    }
+    return 0;
+}
+
+static int get_u8(WireReader *in, unsigned *value)
+{
+    unsigned char c;
+    if (get_bytes(in, &c, 1) != 0)
+    {
+        return -1;
+    }
+    *value = c;
+    return 0;
+}
+
+static int get_u64(WireReader *in, uint64_t *value)
+{
+    unsigned char bytes[8];
+    if (get_bytes(in, bytes, 8) != 0)
+    {
+        return -1;
+    }
+    *value = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        *value = (*value << 8) | bytes[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief Scans the bytes [start, end) of a file into a piece.
+ * @return 0 on success, -1 if the file cannot be read.
+ */
+static int scan_file_range(const char *filename, long long start, long long end,
+                           PartialResult *part)
+{
+    int fd = open(filename, O_RDONLY);
+    char *buffer = malloc(READ_SIZE);
+    int status = fd >= 0 && buffer != NULL ? 0 : -1;
+    long long offset = start;
+    while (status == 0 && offset < end)
+    {
+        size_t want = end - offset < READ_SIZE ? (size_t)(end - offset) : READ_SIZE;
+        ssize_t n = pread(fd, buffer, want, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            status = -1; // An error, or the file shrank under us.
+            break;
+        }
+        partial_scan(part, buffer, (size_t)n);
+        offset += n;
+    }
+    free(buffer);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return status;
+}
+
+/**
+ * @brief walk_hash_table() visitor that writes one word of a reply.
+ */
+static void put_word(void *ctx, const Node *node)
+{
+    size_t len = strlen(node->word);
+    put_u8(ctx, (unsigned)len);
+    out_bytes(ctx, node->word, len);
+    put_u64(ctx, (uint64_t)node->count);
+}
+
+static void put_partial(OutBuf *out, const PartialResult *part)
+{
+    put_u64(out, (uint64_t)part->stats.char_count);
+    put_u64(out, (uint64_t)part->stats.word_count);
+    put_u64(out, (uint64_t)part->stats.line_count);
+    for (int c = 0; c < 256; c++)
+    {
+        put_u64(out, (uint64_t)part->char_freq[c]);
+    }
+    put_u8(out, (unsigned)part->head_len);
+    out_bytes(out, part->head, (size_t)part->head_len);
+    put_u8(out, (unsigned)part->head_open);
+    put_u8(out, (unsigned)part->starts_in_word);
+    put_u8(out, (unsigned)part->state.word_buffer_index);
+    out_bytes(out, part->state.word_buffer, (size_t)part->state.word_buffer_index);
+    put_u8(out, (unsigned)part->state.in_word);
+
+    const HashTable *ht = part->stats.word_counts;
+    uint64_t words = 0;
+    for (int b = 0; b < ht->size; b++)
+    {
+        for (const Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            words++;
+        }
+    }
+    put_u64(out, words);
+    walk_hash_table(ht, put_word, out);
+}
+
+/**
+ * @brief Reads a reply's partial result into a piece made with partial_init().
+ * @return 0 on success, -1 if the stream ends or the reply is malformed.
+ */
+static int get_partial(WireReader *in, PartialResult *part)
+{
+    uint64_t chars, words, lines, freq, count;
+    unsigned head_len, head_open, starts, tail_len, in_word;
+    if (get_u64(in, &chars) != 0 || get_u64(in, &words) != 0 || get_u64(in, &lines) != 0)
+    {
+        return -1;
+    }
+    part->stats.char_count = (long long)chars;
+    part->stats.word_count = (int)words;
+    part->stats.line_count = (int)lines;
+    for (int c = 0; c < 256; c++)
+    {
+        if (get_u64(in, &freq) != 0)
+        {
+            return -1;
+        }
+        part->char_freq[c] = (int)freq;
+    }
+    if (get_u8(in, &head_len) != 0 || head_len >= MAX_WORD_LEN ||
+        get_bytes(in, part->head, head_len) != 0 || get_u8(in, &head_open) != 0 ||
+        get_u8(in, &starts) != 0 || get_u8(in, &tail_len) != 0 || tail_len >= MAX_WORD_LEN ||
+        get_bytes(in, part->state.word_buffer, tail_len) != 0 || get_u8(in, &in_word) != 0 ||
+        get_u64(in, &count) != 0)
+    {
+        return -1;
+    }
+    part->head_len = (int)head_len;
+    part->head_open = head_open != 0;
+    part->starts_in_word = starts != 0;
+    part->state.word_buffer_index = (int)tail_len;
+    part->state.in_word = in_word != 0;
+
+    char word[MAX_WORD_LEN];
+    for (uint64_t i = 0; i < count; i++)
+    {
+        unsigned len;
+        uint64_t n;
+        if (get_u8(in, &len) != 0 || len == 0 || len >= MAX_WORD_LEN ||
+            get_bytes(in, word, len) != 0 || get_u64(in, &n) != 0)
+        {
+            return -1;
+        }
+        word[len] = '\0';
+        add_word_count(part->stats.word_counts, word, (int)n);
+    }
+    return 0;
+}
+
+/**
+ * @brief The worker: answers range requests on `fd` until told to quit.
+ * @return The exit status of the worker process.
+ */
+static int serve(int fd)
+{
+    WireReader *in = malloc(sizeof(WireReader));
+    if (in == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    in->fd = fd;
+    in->pos = in->len = 0;
+    OutBuf out;
+    outbuf_init(&out, fd);
+
+    char name[PATH_MAX];
+    unsigned type;
+    while (get_u8(in, &type) == 0 && type == MSG_RANGE)
+    {
+        uint64_t table_size, start, end, name_len;
+        if (get_u64(in, &table_size) != 0 || get_u64(in, &start) != 0 ||
+            get_u64(in, &end) != 0 || get_u64(in, &name_len) != 0 || name_len >= PATH_MAX ||
+            get_bytes(in, name, name_len) != 0 || table_size < 1 || table_size > INT_MAX)
+        {
+            break; // A broken request: hang up, and the coordinator scans the range itself.
+        }
+        name[name_len] = '\0';
+
+        PartialResult part;
+        int ok = partial_init(&part, (int)table_size) == 0 &&
+                 scan_file_range(name, (long long)start, (long long)end, &part) == 0;
+        put_u8(&out, ok ? 0 : 1);
+        if (ok)
+        {
+            put_partial(&out, &part);
+        }
+        partial_free(&part);
+        if (outbuf_flush(&out) != 0)
+        {
+            break;
+        }
+    }
+    outbuf_finish(&out);
+    free(in);
+    return EXIT_SUCCESS;
+}
+
+enum
+{
+    TASK_PENDING,
+    TASK_RUNNING,
+    TASK_DONE,
+    TASK_FAILED
+};
+
+/**
+ * @struct Task
+ * @brief One byte range of one input.
+ */
+typedef struct
+{
+    int file;           // Index of the input.
+    long long start;    // First byte of the range.
+    long long end;      // One past the last byte.
+    PartialResult part; // The result, once done.
+    int state;          // TASK_*.
+} Task;
+
+/**
+ * @struct Worker
+ * @brief The coordinator's end of a worker process.
+ */
+typedef struct
+{
+    int fd;         // The socket, or -1 once the worker is dropped.
+    pid_t pid;
+    int task;       // The task it is working on, or -1 if idle.
+    WireReader *in; // Its replies.
+} Worker;
+
+/**
+ * @struct Coordinator
+ * @brief The work of a run and the workers doing it.
+ */
+typedef struct
+{
+    const char **files;
+    int table_size;
+    Task *tasks;
+    int task_count;
+    Worker workers[MAX_PROCS];
+    int worker_count;
+} Coordinator;
+
+static void drop_worker(Coordinator *c, Worker *w)
+{
+    if (w->task >= 0)
+    {
+        c->tasks[w->task].state = TASK_PENDING; // Someone else will do it.
+        w->task = -1;
+    }
+    close(w->fd);
+    w->fd = -1;
+}
+
+/**
+ * @brief Sends an idle worker the next pending task, if there is one.
+ */
+static void assign(Coordinator *c, Worker *w)
+{
+    for (int t = 0; t < c->task_count && w->fd >= 0 && w->task < 0; t++)
+    {
+        Task *task = &c->tasks[t];
+        if (task->state != TASK_PENDING)
+        {
+            continue;
+        }
+        const char *name = c->files[task->file];
+        size_t name_len = strlen(name);
+        unsigned char request[1 + 4 * 8 + PATH_MAX];
+        if (name_len >= PATH_MAX)
+        {
+            return; // Left for the coordinator, which can open any name it was given.
+        }
+        size_t n = 0;
+        request[n++] = MSG_RANGE;
+        n += encode_u64(request + n, (uint64_t)c->table_size);
+        n += encode_u64(request + n, (uint64_t)task->start);
+        n += encode_u64(request + n, (uint64_t)task->end);
+        n += encode_u64(request + n, (uint64_t)name_len);
+        memcpy(request + n, name, name_len);
+        n += name_len;
+        // MSG_NOSIGNAL: a worker that has died must not take the coordinator with it.
+        if (send(w->fd, request, n, MSG_NOSIGNAL) != (ssize_t)n)
+        {
+            drop_worker(c, w);
+            return;
+        }
+        task->state = TASK_RUNNING;
+        w->task = t;
+    }
+}
+
+/**
+ * @brief Scans a task's range on the coordinator itself.
+ */
+static void run_locally(Coordinator *c, Task *task)
+{
+    int ok = partial_init(&task->part, c->table_size) == 0 &&
+             scan_file_range(c->files[task->file], task->start, task->end, &task->part) == 0;
+    task->state = ok ? TASK_DONE : TASK_FAILED;
+}
+
+/**
+ * @brief Reads a worker's reply to its task.
+ */
+static void receive(Coordinator *c, Worker *w)
+{
+    Task *task = &c->tasks[w->task];
+    unsigned status;
+    if (get_u8(w->in, &status) != 0 || status > 1)
+    {
+        drop_worker(c, w);
+        return;
+    }
+    if (status == 1)
+    {
+        task->state = TASK_FAILED;
+    }
+    else if (partial_init(&task->part, c->table_size) != 0 || get_partial(w->in, &task->part) != 0)
+    {
+        partial_free(&task->part);
+        memset(&task->part, 0, sizeof(task->part));
+        drop_worker(c, w);
+        return;
+    }
+    else
+    {
+        task->state = TASK_DONE;
+    }
+    w->task = -1;
+}
+
+/**
+ * @brief Makes progress: hands out pending tasks and waits for a reply, or
+ *        runs a task locally if no worker is left.
+ */
+static void pump(Coordinator *c)
+{
+    struct pollfd fds[MAX_PROCS];
+    int index[MAX_PROCS];
+    int busy = 0;
+    for (int k = 0; k < c->worker_count; k++)
+    {
+        Worker *w = &c->workers[k];
+        assign(c, w);
+        if (w->fd >= 0 && w->task >= 0)
+        {
+            fds[busy].fd = w->fd;
+            fds[busy].events = POLLIN;
+            index[busy++] = k;
+        }
+    }
+    if (busy == 0)
+    {
+        for (int t = 0; t < c->task_count; t++)
+        {
+            if (c->tasks[t].state == TASK_PENDING)
+            {
+                run_locally(c, &c->tasks[t]);
+                return;
+            }
+        }
+        return;
+    }
+    if (poll(fds, (nfds_t)busy, -1) < 0)
+    {
+        return; // EINTR: the caller simply pumps again.
+    }
+    for (int i = 0; i < busy; i++)
+    {
+        if (fds[i].revents != 0)
+        {
+            receive(c, &c->workers[index[i]]);
+        }
+    }
+}
+
+/**
+ * @brief Splits the regular inputs into tasks; the others are marked local.
+ * @return 0 on success, -1 if an input cannot be opened or read.
+ */
+static int plan(Coordinator *c, AppStats *stats, int file_count, int procs, int *first,
+                int *local)
+{
+    int capacity = 0;
+    for (int f = 0; f < file_count; f++)
+    {
+        first[f] = c->task_count;
+        stats->filename = c->files[f];
+        struct stat st;
+        int fd = strcmp(c->files[f], "-") == 0 ? -1 : open(c->files[f], O_RDONLY);
+        local[f] = fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode);
+        if (local[f])
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            continue; // analyze_file() will open it (and report any error) in turn.
+        }
+
+        long long size = binary_policy_size(stats, fd, (long long)st.st_size);
+        close(fd);
+        if (size < 0)
+        {
+            return -1;
+        }
+        long long wanted = (size + MIN_RANGE_BYTES - 1) / MIN_RANGE_BYTES;
+        int count = procs < wanted ? procs : (int)wanted;
+        if (c->task_count + count > capacity)
+        {
+            capacity = 2 * (c->task_count + count);
+            Task *grown = realloc(c->tasks, (size_t)capacity * sizeof(Task));
+            if (grown == NULL)
+            {
+                return -1;
+            }
+            c->tasks = grown;
+        }
+        for (int t = 0; t < count; t++)
+        {
+            Task *task = &c->tasks[c->task_count++];
+            memset(task, 0, sizeof(*task));
+            task->file = f;
+            task->start = size * t / count;
+            task->end = size * (t + 1) / count;
+            task->state = TASK_PENDING;
+        }
+    }
+    first[file_count] = c->task_count;
+    return 0;
+}
+
+/**
+ * @brief Starts up to `procs` worker processes.
+ */
+static void start_workers(Coordinator *c, int procs)
+{
+    fflush(NULL); // Nothing buffered may be written twice.
+    for (int k = 0; k < procs; k++)
+    {
+        int sv[2];
+        WireReader *in = malloc(sizeof(WireReader));
+        if (in == NULL || socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+        {
+            free(in);
+            break;
+        }
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            close(sv[0]);
+            close(sv[1]);
+            free(in);
+            break;
+        }
+        if (pid == 0)
+        {
+            close(sv[0]);
+            for (int j = 0; j < c->worker_count; j++)
+            {
+                close(c->workers[j].fd); // So that a worker sees EOF when the coordinator exits.
+            }
+            _exit(serve(sv[1]));
+        }
+        close(sv[1]);
+        in->fd = sv[0];
+        in->pos = in->len = 0;
+        c->workers[c->worker_count++] = (Worker){sv[0], pid, -1, in};
+    }
+}
+
+static void stop_workers(Coordinator *c)
+{
+    for (int k = 0; k < c->worker_count; k++)
+    {
+        Worker *w = &c->workers[k];
+        if (w->fd >= 0)
+        {
+            char quit = MSG_QUIT;
+            send(w->fd, &quit, 1, MSG_NOSIGNAL);
+            close(w->fd);
+        }
+        waitpid(w->pid, NULL, 0);
+        free(w->in);
+    }
+}
+
+int distributed_analyze(AppStats *stats, const char **files, int file_count, int procs)
+{
+    procs = procs > MAX_PROCS ? MAX_PROCS : (procs < 1 ? 1 : procs);
+    Coordinator c;
+    memset(&c, 0, sizeof(c));
+    c.files = files;
+    c.table_size = stats->word_counts->size;
+    int *first = malloc((size_t)(file_count + 1) * sizeof(int));
+    int *local = malloc((size_t)file_count * sizeof(int));
+    if (first == NULL || local == NULL || plan(&c, stats, file_count, procs, first, local) != 0)
+    {
+        free(first);
+        free(local);
+        free(c.tasks);
+        return -1;
+    }
+    start_workers(&c, procs);
+
+    // Inputs are added in order, so the word table comes out as in a single scan.
+    int status = 0;
+    for (int f = 0; f < file_count && status == 0; f++)
+    {
+        stats->filename = files[f];
+        if (local[f])
+        {
+            status = analyze_file(stats);
+            continue;
+        }
+        for (int t = first[f]; t < first[f + 1]; t++)
+        {
+            while (c.tasks[t].state == TASK_PENDING || c.tasks[t].state == TASK_RUNNING)
+            {
+                pump(&c);
+            }
+            if (c.tasks[t].state == TASK_FAILED)
+            {
+                fprintf(stderr, "Error reading file: %s\n", files[f]);
+                status = -1;
+                break;
+            }
+            if (t > first[f])
+            {
+                // Each piece is freed as soon as it is merged, so only the
+                // tables of the pieces not yet merged are held at once.
+                partial_merge(&c.tasks[first[f]].part, &c.tasks[t].part);
+                partial_free(&c.tasks[t].part);
+            }
+        }
+        if (status == 0 && first[f + 1] > first[f])
+        {
+            partial_finish(&c.tasks[first[f]].part, stats);
+            partial_free(&c.tasks[first[f]].part);
+        }
+    }
+
+    stop_workers(&c);
+    for (int t = 0; t < c.task_count; t++)
+    {
+        partial_free(&c.tasks[t].part); // Pieces left over after a failure.
+    }
+    free(c.tasks);
+    free(first);
+    free(local);
+    return status;
+}
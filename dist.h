@@ -0,0 +1,41 @@
+/**
+ * @file dist.h
+ * @brief Public interface for the analysis by worker processes.
+ *
+ * The coordinator (the analyzer process itself) starts worker processes,
+ * each connected to it by a Unix stream socket. It splits every regular
+ * input into byte ranges, hands the ranges out to idle workers, and merges
+ * the partial results (see PartialResult in analyzer.h) that come back, in
+ * input order. The result is the same as that of a single scan.
+ *
+ * The protocol is a stream of length-delimited messages with integers in
+ * little-endian byte order, so it does not depend on the transport: the
+ * workers are local processes today, but the same messages could be
+ * carried to another host. A range request names the file, the table size
+ * and the range; the reply is the serialized partial result of the range.
+ * A worker that dies or breaks the protocol is dropped and its range is
+ * handed to another worker or, if none is left, scanned by the
+ * coordinator.
+ */
+
+#ifndef DIST_H
+#define DIST_H
+
+#include "analyzer.h"
+
+/**
+ * @brief Analyzes a list of inputs into `stats` with `procs` worker processes.
+ *
+ * Standard input and other non-seekable inputs are scanned by the
+ * coordinator at their place in the list. Scan hooks must not be installed.
+ *
+ * @param stats The statistics to add the inputs to. On failure, `filename`
+ *        names the input that failed.
+ * @param files The inputs, in order.
+ * @param file_count The number of inputs.
+ * @param procs The number of worker processes (at least 1).
+ * @return 0 on success, -1 on failure.
+ */
+int distributed_analyze(AppStats *stats, const char **files, int file_count, int procs);
+
+#endif // DIST_H
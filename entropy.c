@@ -0,0 +1,252 @@
+/**
+ * @file entropy.c
+ * @brief Implementation of entropy and compressibility estimation.
+ *
+ * The compressibility estimate is the order-0 bound applied block by block:
+ * a block of n bytes with entropy H cannot be coded in fewer than n * H / 8
+ * bytes by a coder that looks at single bytes. Summing per block rather than
+ * using the whole-input entropy credits inputs whose byte mix changes along
+ * the way, as an adaptive coder would. Compressors that model context
+ * (gzip, zstd) usually beat this on text, so it is best read as "at most
+ * this much smaller"; on already-compressed data it correctly predicts
+ * almost no gain.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "entropy.h"
+
+// The most rows printed for the block profile; longer inputs are grouped.
+#define PROFILE_ROWS 32
+
+// Width of the profile bars for 8 bits per byte.
+#define BAR_WIDTH 40
+
+EntropyStats *create_entropy_stats(const AppStats *stats)
+{
+    EntropyStats *es = calloc(1, sizeof(EntropyStats));
+    if (es == NULL)
+    {
+        return NULL;
+    }
+    es->stats = stats;
+    for (int c = 0; c < 256; c++)
+    {
+        es->snapshot[c] = (unsigned)stats->char_freq[c];
+    }
+    es->block_start = stats->char_count;
+    es->file_start = stats->char_count;
+    es->file = 1;
+    return es;
+}
+
+double histogram_entropy(const unsigned counts[256], long long total)
+{
+    if (total <= 0)
+    {
+        return 0.0;
+    }
+    double h = 0.0;
+    for (int c = 0; c < 256; c++)
+    {
+        if (counts[c] > 0)
+        {
+            double p = (double)counts[c] / (double)total;
+            h -= p * log2(p);
+        }
+    }
+    return h;
+}
+
+/**
+ * @brief Records the block scanned since the last snapshot and starts a new one.
+ */
+static void close_block(EntropyStats *es)
+{
+    long long bytes = es->stats->char_count - es->block_start;
+    if (bytes <= 0)
+    {
+        return;
+    }
+
+    // The block's histogram is the growth of char_freq since the snapshot.
+    // Unsigned arithmetic keeps the difference right even if a counter wrapped.
+    unsigned counts[256];
+    for (int c = 0; c < 256; c++)
+    {
+        unsigned now = (unsigned)es->stats->char_freq[c];
+        counts[c] = now - es->snapshot[c];
+        es->snapshot[c] = now;
+    }
+
+    if (es->block_count == es->block_cap)
+    {
+        int cap = es->block_cap ? es->block_cap * 2 : 64;
+        EntropyBlock *blocks = realloc(es->blocks, (size_t)cap * sizeof(EntropyBlock));
+        if (blocks == NULL)
+        {
+            es->block_start = es->stats->char_count;
+            return;
+        }
+        es->blocks = blocks;
+        es->block_cap = cap;
+    }
+    EntropyBlock *block = &es->blocks[es->block_count++];
+    block->offset = es->block_start - es->file_start;
+    block->file = es->file;
+    block->bytes = bytes;
+    block->entropy = histogram_entropy(counts, bytes);
+    es->block_start = es->stats->char_count;
+}
+
+static void entropy_on_buffer(void *ctx, const char *buf, size_t len)
+{
+    (void)buf;
+    (void)len;
+    EntropyStats *es = ctx;
+    if (es->stats->char_count < es->block_start)
+    {
+        // The statistics were reset (a followed file was truncated): start
+        // the block, and the offsets, over from the empty histogram.
+        memset(es->snapshot, 0, sizeof(es->snapshot));
+        es->block_start = es->file_start = es->stats->char_count;
+    }
+    // Runs before the buffer is counted, so char_freq covers exactly the
+    // bytes up to here.
+    if (es->stats->char_count - es->block_start >= ENTROPY_BLOCK_SIZE)
+    {
+        close_block(es);
+    }
+}
+
+static void entropy_on_finish(void *ctx)
+{
+    EntropyStats *es = ctx;
+    close_block(es);
+    es->file_start = es->stats->char_count; // The next input's offsets start at 0.
+    es->file++;
+}
+
+void entropy_scan_hook(EntropyStats *es, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = entropy_on_buffer;
+    hook->on_finish = entropy_on_finish;
+    hook->ctx = es;
+}
+
+/**
+ * @brief Formats a byte count with a binary unit (B, KB, MB, GB).
+ */
+static void format_size(long long bytes, char *out, size_t size)
+{
+    const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = (double)bytes;
+    int u = 0;
+    while (value >= 1024.0 && u < 4)
+    {
+        value /= 1024.0;
+        u++;
+    }
+    snprintf(out, size, u == 0 ? "%.0f %s" : "%.1f %s", value, units[u]);
+}
+
+void print_entropy_stats(const EntropyStats *es, FILE *output_stream)
+{
+    unsigned counts[256];
+    for (int c = 0; c < 256; c++)
+    {
+        counts[c] = (unsigned)es->stats->char_freq[c];
+    }
+    long long total = es->stats->char_count;
+    double overall = histogram_entropy(counts, total);
+
+    double estimate = 0.0, min = 8.0, max = 0.0;
+    int high = 0;
+    for (int b = 0; b < es->block_count; b++)
+    {
+        const EntropyBlock *block = &es->blocks[b];
+        estimate += (double)block->bytes * block->entropy / 8.0;
+        min = block->entropy < min ? block->entropy : min;
+        max = block->entropy > max ? block->entropy : max;
+        high += block->entropy >= HIGH_ENTROPY_BITS;
+    }
+    if (es->block_count == 0)
+    {
+        estimate = (double)total * overall / 8.0;
+        min = max = overall;
+    }
+
+    char original[32], compressed[32];
+    format_size(total, original, sizeof(original));
+    format_size((long long)estimate, compressed, sizeof(compressed));
+    fprintf(output_stream, "Shannon Entropy:\t%.3f bits/byte\n", overall);
+    fprintf(output_stream, "Block Entropy:\t\tmin %.3f, max %.3f over %d block%s\n", min, max,
+            es->block_count, es->block_count == 1 ? "" : "s");
+    fprintf(output_stream, "Order-0 Estimate:\t%s -> %s (%.1f%%)\n", original, compressed,
+            total > 0 ? 100.0 * estimate / (double)total : 0.0);
+    if (overall >= HIGH_ENTROPY_BITS)
+    {
+        fprintf(output_stream, "Verdict:\t\tlikely compressed, encrypted or binary data\n");
+    }
+    else if (high > 0)
+    {
+        fprintf(output_stream, "Verdict:\t\t%d high-entropy block%s (>= %.1f bits/byte) in otherwise "
+                "compressible data\n", high, high == 1 ? "" : "s", HIGH_ENTROPY_BITS);
+    }
+    else
+    {
+        fprintf(output_stream, "Verdict:\t\tno high-entropy regions\n");
+    }
+
+    if (es->block_count < 2)
+    {
+        return;
+    }
+
+    // One row per block, or per group of blocks for long inputs; the bar
+    // shows the group average and '!' marks groups containing a flagged block.
+    int per_row = (es->block_count + PROFILE_ROWS - 1) / PROFILE_ROWS;
+    fprintf(output_stream, "\n  %-12s %-8s %s\n", "Offset", "Entropy", "Profile (0-8 bits)");
+    fprintf(output_stream, "  %-12s %-8s %s\n", "------------", "-------", "------------------");
+    for (int b = 0; b < es->block_count; b += per_row)
+    {
+        double sum = 0.0;
+        long long bytes = 0;
+        int flagged = 0;
+        for (int i = b; i < b + per_row && i < es->block_count; i++)
+        {
+            sum += es->blocks[i].entropy * (double)es->blocks[i].bytes;
+            bytes += es->blocks[i].bytes;
+            flagged |= es->blocks[i].entropy >= HIGH_ENTROPY_BITS;
+        }
+        double avg = bytes > 0 ? sum / (double)bytes : 0.0;
+        char offset[32], bar[BAR_WIDTH + 1];
+        char size[16];
+        format_size(es->blocks[b].offset, size, sizeof(size));
+        if (es->blocks[es->block_count - 1].file > 1)
+        {
+            // Several inputs: prefix the input number, as in "2:1.0 MB".
+            snprintf(offset, sizeof(offset), "%d:%s", es->blocks[b].file, size);
+        }
+        else
+        {
+            snprintf(offset, sizeof(offset), "%s", size);
+        }
+        int width = (int)(avg / 8.0 * BAR_WIDTH + 0.5);
+        memset(bar, '#', (size_t)width);
+        bar[width] = '\0';
+        fprintf(output_stream, "  %-12s %-8.3f %s%s\n", offset, avg, bar, flagged ? " !" : "");
+    }
+}
+
+void free_entropy_stats(EntropyStats *es)
+{
+    if (es == NULL)
+    {
+        return;
+    }
+    free(es->blocks);
+    free(es);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file entropy.h
+ * @brief Public interface for entropy and compressibility estimation.
+ *
+ * The scan loop already keeps a histogram of every byte value in
+ * `char_freq`. The Shannon entropy of that histogram (bits per byte) is a
+ * direct measure of how predictable the data is: plain text and logs sit
+ * around 4-5.5 bits, while compressed or encrypted data is close to 8.
+ *
+ * To find junk inside an otherwise normal file, the input is also cut into
+ * blocks of about 1 MB. No extra per-byte work is done for this: at each
+ * block boundary the block's histogram is the difference between the
+ * current `char_freq` and a snapshot taken at the start of the block.
+ */
+
+#ifndef ENTROPY_H
+#define ENTROPY_H
+
+#include <stdio.h>
+#include "analyzer.h"
+
+// Nominal size of a profile block; blocks end on the first buffer boundary after it.
+#define ENTROPY_BLOCK_SIZE (1 << 20)
+
+// Blocks at or above this entropy (bits per byte) are flagged.
+#define HIGH_ENTROPY_BITS 7.5
+
+/**
+ * @struct EntropyBlock
+ * @brief The entropy of one block of input.
+ */
+typedef struct
+{
+    long long offset; // Offset of the block within its input.
+    int file;         // The block's input, from 1.
+    long long bytes;  // Size of the block.
+    double entropy;   // Shannon entropy in bits per byte.
+} EntropyBlock;
+
+/**
+ * @struct EntropyStats
+ * @brief The per-block entropy profile.
+ */
+typedef struct
+{
+    const AppStats *stats;          // The scan's statistics (char_freq, char_count).
+    unsigned snapshot[256];         // char_freq at the start of the current block.
+    long long block_start;          // char_count at the start of the current block.
+    long long file_start;           // char_count at the start of the current input.
+    int file;                       // Number of the current input, from 1.
+    EntropyBlock *blocks;
+    int block_count;
+    int block_cap;
+} EntropyStats;
+
+/**
+ * @brief Creates an empty entropy profile.
+ * @param stats The AppStats struct the scan loop updates.
+ * @return A pointer to the new EntropyStats, or NULL on failure.
+ */
+EntropyStats *create_entropy_stats(const AppStats *stats);
+
+/**
+ * @brief Fills in a ScanHook that closes a block whenever ENTROPY_BLOCK_SIZE
+ *        bytes have been scanned, and at the end of each file.
+ * @param es A pointer to the EntropyStats.
+ * @param hook The hook to fill in.
+ */
+void entropy_scan_hook(EntropyStats *es, ScanHook *hook);
+
+/**
+ * @brief Computes the Shannon entropy of a byte histogram.
+ * @param counts Occurrences of each byte value.
+ * @param total The sum of `counts`.
+ * @return The entropy in bits per byte (0 for an empty histogram).
+ */
+double histogram_entropy(const unsigned counts[256], long long total);
+
+/**
+ * @brief Prints the overall entropy, the compressibility estimate and the
+ *        block profile.
+ * @param es A pointer to the EntropyStats.
+ * @param output_stream The stream to write to.
+ */
+void print_entropy_stats(const EntropyStats *es, FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with an EntropyStats object.
+ * @param es A pointer to the EntropyStats to be freed.
+ */
+void free_entropy_stats(EntropyStats *es);
+
+#endif // ENTROPY_H
@@ -0,0 +1,715 @@
+/**
+ * @file extsort.c
+ * @brief Implementation of exact distinct counts by external sorting.
+ *
+ * Items are stored in the batch arena as a 32-bit length followed by the
+ * bytes, so lines containing NUL bytes sort correctly. A run file is a
+ * sequence of records {uint32 length, int64 count, bytes} in ascending
+ * byte order with no repeated items. Run files are unlinked right after
+ * they are created, so they vanish even if the program is interrupted.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "extsort.h"
+
+// Size of each arena chunk (larger items get a chunk of their own).
+#define CHUNK_SIZE (1 << 20)
+
+// The most runs merged at once; more are first merged in groups.
+#define MAX_FAN_IN 64
+
+// Batches are never smaller than this, whatever the memory limit.
+#define MIN_BATCH_BYTES (4 << 20)
+
+/**
+ * @struct RunReader
+ * @brief Yields the (item, count) records of one run file or of the final,
+ *        in-memory batch.
+ */
+typedef struct
+{
+    FILE *file;             // The run file, or NULL for the in-memory batch.
+    const SortBatch *batch; // The sorted batch when file is NULL.
+    size_t next;            // Next item index in the batch.
+    const char *key;        // The current item.
+    uint32_t len;
+    long long count;
+    char *buf;              // Storage for items read from the file.
+    uint32_t buf_cap;
+} RunReader;
+
+typedef void (*EmitFn)(void *ctx, const char *key, uint32_t len, long long count);
+
+ExtSort *create_ext_sort(size_t mem_limit, const char *tmpdir)
+{
+    ExtSort *es = calloc(1, sizeof(ExtSort));
+    if (es == NULL)
+    {
+        return NULL;
+    }
+    es->tmpdir = tmpdir;
+    es->batch_limit = mem_limit / 2 > MIN_BATCH_BYTES ? mem_limit / 2 : MIN_BATCH_BYTES;
+    return es;
+}
+
+static uint32_t item_len(const char *item)
+{
+    uint32_t len;
+    memcpy(&len, item, sizeof(len));
+    return len;
+}
+
+static int compare_keys(const char *a, uint32_t alen, const char *b, uint32_t blen)
+{
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c != 0)
+    {
+        return c;
+    }
+    return (alen > blen) - (alen < blen);
+}
+
+static int compare_items(const void *a, const void *b)
+{
+    const char *x = *(char *const *)a;
+    const char *y = *(char *const *)b;
+    return compare_keys(x + 4, item_len(x), y + 4, item_len(y));
+}
+
+static void reset_batch(SortBatch *b)
+{
+    for (int i = 0; i < b->chunk_count; i++)
+    {
+        free(b->chunks[i]);
+    }
+    free(b->chunks);
+    b->chunks = NULL;
+    b->chunk_count = 0;
+    b->chunk_used = 0;
+    b->item_count = 0;
+    b->bytes = b->item_cap * sizeof(char *);
+}
+
+/**
+ * @brief Appends a length-prefixed item to a batch.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int batch_append(SortBatch *b, const char *item, size_t len)
+{
+    size_t need = sizeof(uint32_t) + len;
+    if (b->chunk_count == 0 || b->chunk_used + need > CHUNK_SIZE)
+    {
+        size_t size = need > CHUNK_SIZE ? need : CHUNK_SIZE;
+        char **chunks = realloc(b->chunks, (size_t)(b->chunk_count + 1) * sizeof(char *));
+        if (chunks == NULL)
+        {
+            return -1;
+        }
+        b->chunks = chunks;
+        b->chunks[b->chunk_count] = malloc(size);
+        if (b->chunks[b->chunk_count] == NULL)
+        {
+            return -1;
+        }
+        b->chunk_count++;
+        b->chunk_used = 0;
+        b->bytes += size;
+    }
+    if (b->item_count == b->item_cap)
+    {
+        size_t cap = b->item_cap ? b->item_cap * 2 : 4096;
+        char **items = realloc(b->items, cap * sizeof(char *));
+        if (items == NULL)
+        {
+            return -1;
+        }
+        b->items = items;
+        b->bytes += (cap - b->item_cap) * sizeof(char *);
+        b->item_cap = cap;
+    }
+
+    char *dst = b->chunks[b->chunk_count - 1] + b->chunk_used;
+    uint32_t len32 = (uint32_t)len;
+    memcpy(dst, &len32, sizeof(len32));
+    memcpy(dst + sizeof(len32), item, len);
+    b->chunk_used += need;
+    b->items[b->item_count++] = dst;
+    return 0;
+}
+
+/**
+ * @brief Creates an anonymous temporary file for a run.
+ * @return The open file, or NULL after printing an error.
+ */
+static FILE *create_run_file(const char *tmpdir)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/analyzer-run-XXXXXX", tmpdir);
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("Error creating a temporary run file");
+        return NULL;
+    }
+    unlink(path);
+    FILE *file = fdopen(fd, "w+b");
+    if (file == NULL)
+    {
+        perror("Error opening a temporary run file");
+        close(fd);
+    }
+    return file;
+}
+
+static int write_record(FILE *file, const char *key, uint32_t len, long long count)
+{
+    int64_t count64 = count;
+    if (fwrite(&len, sizeof(len), 1, file) != 1 || fwrite(&count64, sizeof(count64), 1, file) != 1 ||
+        (len > 0 && fwrite(key, len, 1, file) != 1))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int add_run(ExtSort *es, FILE *run)
+{
+    if (es->run_count == es->run_cap)
+    {
+        int cap = es->run_cap ? es->run_cap * 2 : 16;
+        FILE **runs = realloc(es->runs, (size_t)cap * sizeof(FILE *));
+        if (runs == NULL)
+        {
+            return -1;
+        }
+        es->runs = runs;
+        es->run_cap = cap;
+    }
+    es->runs[es->run_count++] = run;
+    return 0;
+}
+
+/**
+ * @brief Sorts a batch and writes it, duplicates collapsed, as a new run.
+ * @return 0 on success, -1 on failure.
+ */
+static int write_run(ExtSort *es, SortBatch *b)
+{
+    qsort(b->items, b->item_count, sizeof(char *), compare_items);
+
+    FILE *run = create_run_file(es->tmpdir);
+    if (run == NULL)
+    {
+        return -1;
+    }
+    int status = 0;
+    for (size_t i = 0; i < b->item_count && status == 0;)
+    {
+        size_t j = i + 1;
+        while (j < b->item_count && compare_items(&b->items[i], &b->items[j]) == 0)
+        {
+            j++;
+        }
+        status = write_record(run, b->items[i] + 4, item_len(b->items[i]), (long long)(j - i));
+        i = j;
+    }
+    if (status != 0 || fflush(run) != 0 || add_run(es, run) != 0)
+    {
+        perror("Error writing a temporary run file");
+        fclose(run);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Background thread body: writes the batch that is not being filled.
+ */
+static void *run_writer(void *arg)
+{
+    ExtSort *es = arg;
+    SortBatch *b = &es->batches[es->filling ^ 1];
+    es->writer_failed = (write_run(es, b) != 0);
+    reset_batch(b);
+    return NULL;
+}
+
+/**
+ * @brief Waits for the background writer, if one is running, and picks up
+ *        its outcome.
+ */
+static void wait_for_writer(ExtSort *es)
+{
+    if (es->worker_running)
+    {
+        pthread_join(es->worker, NULL);
+        es->worker_running = 0;
+    }
+    if (es->writer_failed)
+    {
+        es->failed = 1;
+    }
+}
+
+int ext_sort_add(ExtSort *es, const char *item, size_t len)
+{
+    if (es->failed)
+    {
+        return -1;
+    }
+
+    SortBatch *b = &es->batches[es->filling];
+    if (b->item_count > 0 && b->bytes + len + sizeof(uint32_t) + sizeof(char *) > es->batch_limit)
+    {
+        // Hand the full batch to the writer and continue in the other one.
+        wait_for_writer(es);
+        if (es->failed)
+        {
+            return -1;
+        }
+        es->filling ^= 1;
+        if (pthread_create(&es->worker, NULL, run_writer, es) == 0)
+        {
+            es->worker_running = 1;
+        }
+        else
+        {
+            run_writer(es); // No thread available: write it inline.
+            wait_for_writer(es);
+        }
+        b = &es->batches[es->filling];
+    }
+
+    if (batch_append(b, item, len) != 0)
+    {
+        fprintf(stderr, "Error: Out of memory while collecting items for exact counts.\n");
+        es->failed = 1;
+        return -1;
+    }
+    es->total++;
+    return 0;
+}
+
+/**
+ * @brief Advances a reader to its next record.
+ * @return 1 if a record was read, 0 at the end, -1 on a read error.
+ */
+static int reader_next(RunReader *r)
+{
+    if (r->file == NULL)
+    {
+        const SortBatch *b = r->batch;
+        if (r->next >= b->item_count)
+        {
+            return 0;
+        }
+        size_t i = r->next, j = i + 1;
+        while (j < b->item_count && compare_items(&b->items[i], &b->items[j]) == 0)
+        {
+            j++;
+        }
+        r->key = b->items[i] + 4;
+        r->len = item_len(b->items[i]);
+        r->count = (long long)(j - i);
+        r->next = j;
+        return 1;
+    }
+
+    uint32_t len;
+    int64_t count;
+    if (fread(&len, sizeof(len), 1, r->file) != 1)
+    {
+        return ferror(r->file) ? -1 : 0;
+    }
+    if (fread(&count, sizeof(count), 1, r->file) != 1)
+    {
+        return -1;
+    }
+    if (len > r->buf_cap)
+    {
+        char *grown = realloc(r->buf, len);
+        if (grown == NULL)
+        {
+            return -1;
+        }
+        r->buf = grown;
+        r->buf_cap = len;
+    }
+    if (len > 0 && fread(r->buf, len, 1, r->file) != 1)
+    {
+        return -1;
+    }
+    r->key = r->buf;
+    r->len = len;
+    r->count = count;
+    return 1;
+}
+
+static int reader_less(const RunReader *a, const RunReader *b)
+{
+    return compare_keys(a->key, a->len, b->key, b->len) < 0;
+}
+
+static void sift_down(RunReader **heap, int n, int i)
+{
+    for (;;)
+    {
+        int smallest = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && reader_less(heap[l], heap[smallest]))
+        {
+            smallest = l;
+        }
+        if (r < n && reader_less(heap[r], heap[smallest]))
+        {
+            smallest = r;
+        }
+        if (smallest == i)
+        {
+            return;
+        }
+        RunReader *t = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = t;
+        i = smallest;
+    }
+}
+
+/**
+ * @brief Merges sorted readers, summing the counts of equal items, and
+ *        passes every distinct item to `emit` in ascending order.
+ * @return 0 on success, -1 on a read or allocation error.
+ */
+static int merge_readers(RunReader *readers, int n, EmitFn emit, void *ctx)
+{
+    RunReader **heap = malloc((size_t)(n > 0 ? n : 1) * sizeof(RunReader *));
+    if (heap == NULL)
+    {
+        return -1;
+    }
+    int size = 0, status = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int got = reader_next(&readers[i]);
+        if (got < 0)
+        {
+            status = -1;
+        }
+        else if (got > 0)
+        {
+            heap[size++] = &readers[i];
+        }
+    }
+    for (int i = size / 2 - 1; i >= 0; i--)
+    {
+        sift_down(heap, size, i);
+    }
+
+    char *current = NULL;
+    uint32_t current_cap = 0;
+    while (size > 0 && status == 0)
+    {
+        // Copy the smallest item out, since advancing its reader overwrites it.
+        uint32_t len = heap[0]->len;
+        if (len > current_cap || current == NULL)
+        {
+            char *grown = realloc(current, len > 0 ? len : 1);
+            if (grown == NULL)
+            {
+                status = -1;
+                break;
+            }
+            current = grown;
+            current_cap = len;
+        }
+        memcpy(current, heap[0]->key, len);
+        long long count = 0;
+
+        while (size > 0 && compare_keys(heap[0]->key, heap[0]->len, current, len) == 0)
+        {
+            count += heap[0]->count;
+            int got = reader_next(heap[0]);
+            if (got < 0)
+            {
+                status = -1;
+                break;
+            }
+            if (got == 0)
+            {
+                heap[0] = heap[--size];
+            }
+            sift_down(heap, size, 0);
+        }
+        emit(ctx, current, len, count);
+    }
+
+    free(current);
+    free(heap);
+    return status;
+}
+
+static void emit_to_run(void *ctx, const char *key, uint32_t len, long long count)
+{
+    FILE **run = ctx;
+    if (*run != NULL && write_record(*run, key, len, count) != 0)
+    {
+        perror("Error writing a temporary run file");
+        fclose(*run);
+        *run = NULL;
+    }
+}
+
+static void emit_to_totals(void *ctx, const char *key, uint32_t len, long long count)
+{
+    ExtSort *es = ctx;
+    es->distinct++;
+    es->once += (count == 1);
+
+    if (es->top_len == EXTSORT_TOP && es->top[EXTSORT_TOP - 1].count >= count)
+    {
+        return;
+    }
+    char *text = malloc((size_t)len + 1);
+    if (text == NULL)
+    {
+        return;
+    }
+    memcpy(text, key, len);
+    text[len] = '\0';
+
+    int i;
+    if (es->top_len < EXTSORT_TOP)
+    {
+        i = es->top_len++;
+    }
+    else
+    {
+        i = EXTSORT_TOP - 1;
+        free(es->top[i].text); // The least frequent entry drops out.
+    }
+    while (i > 0 && es->top[i - 1].count < count)
+    {
+        es->top[i] = es->top[i - 1];
+        i--;
+    }
+    es->top[i].text = text;
+    es->top[i].len = len;
+    es->top[i].count = count;
+}
+
+/**
+ * @brief Merges groups of runs until at most MAX_FAN_IN remain, so the
+ *        final merge never holds too many files open.
+ * @return 0 on success, -1 on failure.
+ */
+static int reduce_runs(ExtSort *es)
+{
+    while (es->run_count > MAX_FAN_IN)
+    {
+        RunReader readers[MAX_FAN_IN];
+        memset(readers, 0, sizeof(readers));
+        for (int i = 0; i < MAX_FAN_IN; i++)
+        {
+            readers[i].file = es->runs[i];
+            rewind(readers[i].file);
+        }
+
+        FILE *merged = create_run_file(es->tmpdir);
+        int status = (merged != NULL) ? merge_readers(readers, MAX_FAN_IN, emit_to_run, &merged) : -1;
+        for (int i = 0; i < MAX_FAN_IN; i++)
+        {
+            free(readers[i].buf);
+            fclose(es->runs[i]);
+        }
+        memmove(es->runs, es->runs + MAX_FAN_IN,
+                (size_t)(es->run_count - MAX_FAN_IN) * sizeof(FILE *));
+        es->run_count -= MAX_FAN_IN;
+
+        if (status != 0 || merged == NULL || fflush(merged) != 0 || add_run(es, merged) != 0)
+        {
+            if (merged != NULL)
+            {
+                fclose(merged);
+            }
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int finish_ext_sort(ExtSort *es)
+{
+    es->finished = 1;
+    wait_for_writer(es);
+    if (es->failed)
+    {
+        return -1;
+    }
+
+    // The last batch is merged straight from memory instead of being written.
+    SortBatch *last = &es->batches[es->filling];
+    qsort(last->items, last->item_count, sizeof(char *), compare_items);
+    if (es->run_count + 1 > MAX_FAN_IN && reduce_runs(es) != 0)
+    {
+        es->failed = 1;
+        return -1;
+    }
+
+    int n = es->run_count + 1;
+    RunReader *readers = calloc((size_t)n, sizeof(RunReader));
+    if (readers == NULL)
+    {
+        es->failed = 1;
+        return -1;
+    }
+    for (int i = 0; i < es->run_count; i++)
+    {
+        readers[i].file = es->runs[i];
+        rewind(readers[i].file);
+    }
+    readers[n - 1].batch = last;
+
+    int status = merge_readers(readers, n, emit_to_totals, es);
+    for (int i = 0; i < n; i++)
+    {
+        free(readers[i].buf);
+    }
+    free(readers);
+    if (status != 0)
+    {
+        fprintf(stderr, "Error: Could not read back the temporary run files.\n");
+        es->failed = 1;
+    }
+    return status;
+}
+
+static void ext_sort_on_word(void *ctx, const char *word)
+{
+    ext_sort_add(ctx, word, strlen(word));
+}
+
+static void ext_sort_on_lines(void *ctx, const char *buf, size_t len)
+{
+    ExtSort *es = ctx;
+    const char *end = buf + len;
+    while (buf < end)
+    {
+        const char *newline = memchr(buf, '\n', (size_t)(end - buf));
+        size_t n = (newline != NULL) ? (size_t)(newline - buf) : (size_t)(end - buf);
+
+        if (newline != NULL && es->line_len == 0)
+        {
+            ext_sort_add(es, buf, n); // The whole line is in this buffer.
+        }
+        else
+        {
+            // Assemble a line that spans buffers.
+            if (es->line_len + n > es->line_cap)
+            {
+                size_t cap = es->line_cap ? es->line_cap : 4096;
+                while (cap < es->line_len + n)
+                {
+                    cap *= 2;
+                }
+                char *grown = realloc(es->line, cap);
+                if (grown == NULL)
+                {
+                    return;
+                }
+                es->line = grown;
+                es->line_cap = cap;
+            }
+            memcpy(es->line + es->line_len, buf, n);
+            es->line_len += n;
+            if (newline != NULL)
+            {
+                ext_sort_add(es, es->line, es->line_len);
+                es->line_len = 0;
+            }
+        }
+        buf += n + (newline != NULL);
+    }
+}
+
+static void ext_sort_on_line_end(void *ctx)
+{
+    ExtSort *es = ctx;
+    if (es->line_len > 0)
+    {
+        ext_sort_add(es, es->line, es->line_len); // A last line without a newline.
+        es->line_len = 0;
+    }
+}
+
+void ext_sort_word_hook(ExtSort *es, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_word = ext_sort_on_word;
+    hook->ctx = es;
+}
+
+void ext_sort_line_hook(ExtSort *es, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = ext_sort_on_lines;
+    hook->on_finish = ext_sort_on_line_end;
+    hook->ctx = es;
+}
+
+void print_ext_sort_stats(const ExtSort *es, const char *what, FILE *output_stream)
+{
+    if (es->failed)
+    {
+        fprintf(output_stream, "Exact counts unavailable (see errors above).\n");
+        return;
+    }
+    if (!es->finished)
+    {
+        fprintf(output_stream, "Exact counts are computed when the input ends (%lld %s so far).\n",
+                es->total, what);
+        return;
+    }
+    fprintf(output_stream, "Total %s:\t\t%lld\n", what, es->total);
+    fprintf(output_stream, "Distinct %s:\t\t%lld\n", what, es->distinct);
+    fprintf(output_stream, "Seen Once:\t\t%lld\n", es->once);
+    fprintf(output_stream, "Sorted Runs:\t\t%d\n", es->run_count);
+    if (es->top_len == 0)
+    {
+        return;
+    }
+    fprintf(output_stream, "  %-10s %s\n", "Count", "Item");
+    fprintf(output_stream, "  %-10s %s\n", "----------", "----");
+    for (int i = 0; i < es->top_len; i++)
+    {
+        fprintf(output_stream, "  %-10lld %.60s%s\n", es->top[i].count, es->top[i].text,
+                es->top[i].len > 60 ? "..." : "");
+    }
+}
+
+void free_ext_sort(ExtSort *es)
+{
+    if (es == NULL)
+    {
+        return;
+    }
+    wait_for_writer(es);
+    for (int i = 0; i < 2; i++)
+    {
+        reset_batch(&es->batches[i]);
+        free(es->batches[i].items);
+    }
+    for (int i = 0; i < es->run_count; i++)
+    {
+        fclose(es->runs[i]);
+    }
+    free(es->runs);
+    for (int i = 0; i < es->top_len; i++)
+    {
+        free(es->top[i].text);
+    }
+    free(es->line);
+    free(es);
+}
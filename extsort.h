@@ -0,0 +1,138 @@
+/**
+ * @file extsort.h
+ * @brief Public interface for exact distinct counts by external sorting.
+ *
+ * Items (words or lines) are appended to an in-memory batch. When the batch
+ * reaches its share of the memory limit, a background thread sorts it,
+ * collapses duplicates into (item, count) records and writes them to a
+ * temporary run file, while the scan goes on filling a second batch. At the
+ * end, all runs are combined with a k-way heap merge, which sees each
+ * distinct item exactly once in sorted order. Memory stays bounded by the
+ * limit no matter how large the vocabulary is, and all file I/O is
+ * sequential.
+ */
+
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "analyzer.h"
+
+// The number of most frequent items kept by the merge.
+#define EXTSORT_TOP 10
+
+/**
+ * @struct SortBatch
+ * @brief A batch of items collected in memory before it is sorted.
+ */
+typedef struct
+{
+    char **chunks;       // Arena chunks holding length-prefixed items.
+    int chunk_count;
+    size_t chunk_used;   // Bytes used in the last chunk.
+    char **items;        // Pointers into the arena, one per item.
+    size_t item_count;
+    size_t item_cap;
+    size_t bytes;        // Approximate memory held by the batch.
+} SortBatch;
+
+/**
+ * @struct TopItem
+ * @brief One of the most frequent items found by the merge.
+ */
+typedef struct
+{
+    char *text;
+    uint32_t len;
+    long long count;
+} TopItem;
+
+/**
+ * @struct ExtSort
+ * @brief An external sorter and the exact counts it produces.
+ */
+typedef struct
+{
+    const char *tmpdir;     // Where run files are created.
+    size_t batch_limit;     // Memory allowed per batch (two batches exist).
+    SortBatch batches[2];   // The batch being filled and the one being written.
+    int filling;            // Index of the batch being filled.
+
+    pthread_t worker;       // Sorts and writes the other batch.
+    int worker_running;
+    FILE **runs;            // Sorted run files (already unlinked).
+    int run_count;
+    int run_cap;
+    int writer_failed;      // Set by the writer; read only after joining it.
+    int failed;             // Non-zero if exact counts cannot be produced.
+
+    char *line;             // A line split across buffers (line mode only).
+    size_t line_len;
+    size_t line_cap;
+
+    // --- Results, valid after finish_ext_sort() ---
+    int finished;           // Non-zero once the runs have been merged.
+    long long total;        // Items added.
+    long long distinct;     // Distinct items.
+    long long once;         // Items that occurred exactly once.
+    TopItem top[EXTSORT_TOP];
+    int top_len;
+} ExtSort;
+
+/**
+ * @brief Creates an external sorter.
+ * @param mem_limit The memory budget in bytes for in-memory batches.
+ * @param tmpdir The directory for temporary run files.
+ * @return A pointer to the new ExtSort, or NULL on failure.
+ */
+ExtSort *create_ext_sort(size_t mem_limit, const char *tmpdir);
+
+/**
+ * @brief Adds one item. Blocks briefly if a full batch must be handed off
+ *        while the previous one is still being written.
+ * @param es A pointer to the ExtSort.
+ * @param item The item's bytes.
+ * @param len The number of bytes in `item`.
+ * @return 0 on success, -1 on failure.
+ */
+int ext_sort_add(ExtSort *es, const char *item, size_t len);
+
+/**
+ * @brief Fills in a ScanHook that adds every frequency word to the sorter.
+ * @param es A pointer to the ExtSort.
+ * @param hook The hook to fill in.
+ */
+void ext_sort_word_hook(ExtSort *es, ScanHook *hook);
+
+/**
+ * @brief Fills in a ScanHook that adds every line to the sorter.
+ * @param es A pointer to the ExtSort.
+ * @param hook The hook to fill in.
+ */
+void ext_sort_line_hook(ExtSort *es, ScanHook *hook);
+
+/**
+ * @brief Merges the last batch and all runs into the exact totals. Call once,
+ *        after every input file has been scanned; no items can be added after.
+ * @param es A pointer to the ExtSort.
+ * @return 0 on success, -1 on failure.
+ */
+int finish_ext_sort(ExtSort *es);
+
+/**
+ * @brief Prints the exact counts to the given stream.
+ * @param es A pointer to the ExtSort.
+ * @param what A plural noun for the items ("Words", "Lines").
+ * @param output_stream The stream to write to.
+ */
+void print_ext_sort_stats(const ExtSort *es, const char *what, FILE *output_stream);
+
+/**
+ * @brief Frees all memory and temporary files of an ExtSort.
+ * @param es A pointer to the ExtSort to be freed.
+ */
+void free_ext_sort(ExtSort *es);
+
+#endif // EXTSORT_H
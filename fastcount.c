@@ -0,0 +1,323 @@
+/**
+ * @file fastcount.c
+ * @brief Implementation of the parallel line and word counter.
+ *
+ * The newline kernel compares 16 bytes at a time (SSE2 where available)
+ * and subtracts each comparison mask from a vector of byte counters, so a
+ * match costs no branch and no popcount. The byte counters are folded into
+ * the total with a sum-of-absolute-differences every 255 chunks, before
+ * any of them can overflow.
+ *
+ * Words are counted by count_word_starts() from the scan loop. A thread
+ * reads the byte before its range first, so a word that straddles two
+ * ranges is counted once, by the range it starts in.
+ *
+ * Ranges are only split for files of several megabytes; below that the
+ * cost of starting threads outweighs the work they share.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fastcount.h"
+#include "sniff.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Bytes requested per pread()/read() call.
+#define CHUNK_SIZE (1 << 20)
+
+// The smallest range worth giving a thread of its own.
+#define MIN_RANGE_BYTES (8LL << 20)
+
+// The most threads used for one file.
+#define MAX_THREADS 64
+
+/**
+ * @struct CountRange
+ * @brief The part of a file counted by one thread, and its result.
+ */
+typedef struct
+{
+    int fd;
+    long long start;      // First byte of the range.
+    long long end;        // One past the last byte.
+    int words;            // Non-zero to count words as well.
+    long long lines;      // Newlines found.
+    long long word_count; // Words starting in the range.
+    int failed;           // Non-zero if a read failed.
+} CountRange;
+
+/**
+ * @brief Counts the newline bytes in a buffer.
+ */
+static long long count_newlines(const char *p, size_t len)
+{
+    long long lines = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= len)
+    {
+        size_t chunks = (len - i) / 16;
+        if (chunks > 255)
+        {
+            chunks = 255; // Each byte lane can count to 255.
+        }
+        __m128i acc = zero;
+        for (size_t c = 0; c < chunks; c++, i += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, newline)); // A match is -1.
+        }
+        __m128i sums = _mm_sad_epu8(acc, zero); // Two 64-bit lane sums.
+        lines += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+#endif
+    for (; i < len; i++)
+    {
+        lines += p[i] == '\n';
+    }
+    return lines;
+}
+
+static void *count_range(void *arg)
+{
+    CountRange *range = arg;
+    char *buffer = malloc(CHUNK_SIZE);
+    if (buffer == NULL)
+    {
+        range->failed = 1;
+        return NULL;
+    }
+    int in_word = 0;
+    if (range->words && range->start > 0)
+    {
+        char prev;
+        if (pread(range->fd, &prev, 1, (off_t)(range->start - 1)) != 1)
+        {
+            range->failed = 1;
+            free(buffer);
+            return NULL;
+        }
+        count_word_starts(&prev, 1, &in_word);
+    }
+    long long offset = range->start;
+    while (offset < range->end)
+    {
+        size_t want = range->end - offset < CHUNK_SIZE ? (size_t)(range->end - offset) : CHUNK_SIZE;
+        ssize_t n = pread(range->fd, buffer, want, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            range->failed = 1; // An error, or the file shrank under us.
+            break;
+        }
+        range->lines += count_newlines(buffer, (size_t)n);
+        if (range->words)
+        {
+            range->word_count += count_word_starts(buffer, (size_t)n, &in_word);
+        }
+        offset += n;
+    }
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Applies the binary policy to the first block of an input.
+ * @return The number of bytes to count, -1 for all of them.
+ */
+static long long binary_limit(const char *filename, const char *buf, size_t len,
+                              BinaryPolicy policy, FastCounts *counts)
+{
+    if (policy == BINARY_SCAN)
+    {
+        return -1;
+    }
+    SniffResult sniff;
+    sniff_content(buf, len, &sniff);
+    if (!sniff.is_binary)
+    {
+        return -1;
+    }
+    counts->binary_files++;
+    fprintf(stderr, "Note: %s looks binary (%zu NUL, %zu control, %zu invalid UTF-8 "
+            "in the first %zu bytes); %s.\n", filename, sniff.nul_bytes, sniff.control,
+            sniff.invalid_utf8, sniff.bytes,
+            policy == BINARY_SKIP ? "skipping it" : "sampling its start");
+    return policy == BINARY_SKIP ? 0 : BINARY_SAMPLE_BYTES;
+}
+
+/**
+ * @brief Counts a non-seekable input (a pipe or a terminal) on this thread.
+ */
+static int count_stream(const char *filename, int fd, BinaryPolicy policy, int words,
+                        FastCounts *counts)
+{
+    char *buffer = malloc(CHUNK_SIZE);
+    if (buffer == NULL)
+    {
+        return -1;
+    }
+    int status = 0;
+    int first = 1;
+    long long limit = -1;
+    int in_word = 0;
+    for (;;)
+    {
+        ssize_t n = read(fd, buffer, CHUNK_SIZE);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("Error reading file");
+            status = -1;
+            break;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        if (first && policy != BINARY_SCAN)
+        {
+            n = read_sniff_block(fd, buffer, (size_t)n, SNIFF_BYTES);
+            if (n < 0)
+            {
+                perror("Error reading file");
+                status = -1;
+                break;
+            }
+        }
+        if (first)
+        {
+            limit = binary_limit(filename, buffer, (size_t)n < SNIFF_BYTES ? (size_t)n : SNIFF_BYTES,
+                                 policy, counts);
+            first = 0;
+        }
+        if (limit >= 0 && n > limit)
+        {
+            n = (ssize_t)limit;
+        }
+        counts->bytes += n;
+        counts->lines += count_newlines(buffer, (size_t)n);
+        if (words)
+        {
+            counts->words += count_word_starts(buffer, (size_t)n, &in_word);
+        }
+        if (limit >= 0 && (limit -= n) == 0)
+        {
+            break;
+        }
+    }
+    free(buffer);
+    return status;
+}
+
+int fast_count_file(const char *filename, int threads, BinaryPolicy policy, int words,
+                    FastCounts *counts)
+{
+    int use_stdin = strcmp(filename, "-") == 0;
+    int fd = use_stdin ? STDIN_FILENO : open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Error opening file");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        int status = count_stream(filename, fd, policy, words, counts);
+        if (!use_stdin)
+        {
+            close(fd);
+        }
+        return status;
+    }
+
+    long long size = (long long)st.st_size;
+    char head[SNIFF_BYTES];
+    ssize_t got = pread(fd, head, SNIFF_BYTES, 0);
+    if (got < 0)
+    {
+        perror("Error reading file");
+        if (!use_stdin)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    long long limit = binary_limit(filename, head, (size_t)got, policy, counts);
+    if (limit >= 0 && limit < size)
+    {
+        size = limit;
+    }
+
+    // One range per thread, each at least MIN_RANGE_BYTES long.
+    long long wanted = (size + MIN_RANGE_BYTES - 1) / MIN_RANGE_BYTES;
+    int count = threads < wanted ? threads : (int)wanted;
+    count = count > MAX_THREADS ? MAX_THREADS : (count < 1 ? 1 : count);
+
+    CountRange ranges[MAX_THREADS];
+    pthread_t workers[MAX_THREADS];
+    int started = 0;
+    for (int t = 0; t < count; t++)
+    {
+        ranges[t] = (CountRange){fd, size * t / count, size * (t + 1) / count, words, 0, 0, 0};
+    }
+    // The calling thread takes the last range itself.
+    for (int t = 0; t < count - 1; t++)
+    {
+        if (pthread_create(&workers[t], NULL, count_range, &ranges[t]) != 0)
+        {
+            break;
+        }
+        started++;
+    }
+    for (int t = started; t < count; t++)
+    {
+        count_range(&ranges[t]); // Whatever could not be started runs here.
+    }
+
+    int status = 0;
+    for (int t = 0; t < count; t++)
+    {
+        if (t < started)
+        {
+            pthread_join(workers[t], NULL);
+        }
+        if (ranges[t].failed)
+        {
+            status = -1;
+        }
+        counts->lines += ranges[t].lines;
+        counts->words += ranges[t].word_count;
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Error reading file: %s\n", filename);
+    }
+    counts->bytes += size;
+
+    if (!use_stdin)
+    {
+        close(fd);
+    }
+    return status;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file fastcount.h
+ * @brief Public interface for the parallel line and word counter.
+ *
+ * When the only things asked for are totals (`-c`, `-w`, `-l`), there is no
+ * need for tokenization or frequency tables: the file is split into one
+ * byte range per thread, each thread reads its range with pread() and
+ * counts newline bytes 16 at a time and word starts 64 at a time, and the
+ * per-range counts are summed. Standard input and other non-seekable inputs
+ * are counted by a single thread with the same kernels.
+ */
+
+#ifndef FASTCOUNT_H
+#define FASTCOUNT_H
+
+#include "analyzer.h"
+
+/**
+ * @struct FastCounts
+ * @brief Totals produced by the parallel counter, accumulated over files.
+ */
+typedef struct
+{
+    long long bytes;  // Bytes counted.
+    long long words;  // Whitespace-delimited words counted.
+    long long lines;  // Newline characters counted.
+    int binary_files; // Inputs that looked binary.
+} FastCounts;
+
+/**
+ * @brief Counts the lines (and optionally words) of a file and adds them
+ *        to `counts`.
+ *
+ * The binary policy is applied exactly as analyze_file() applies it, so
+ * the totals agree with a full analysis of the same inputs.
+ *
+ * @param filename The file to count, or "-" for standard input.
+ * @param threads The number of threads to use for regular files (at least 1).
+ * @param policy What to do if the input looks binary.
+ * @param words Non-zero to count words as well.
+ * @param counts The totals to add to.
+ * @return 0 on success, -1 on failure.
+ */
+int fast_count_file(const char *filename, int threads, BinaryPolicy policy, int words,
+                    FastCounts *counts);
+
+#endif // FASTCOUNT_H
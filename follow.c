@@ -0,0 +1,265 @@
+/**
+ * @file follow.c
+ * @brief Implementation of follow mode (like `tail -f`).
+ *
+ * Every time the follower wakes up it performs the same checks: has the
+ * file been truncated, are there new bytes, and has the path been rotated
+ * to a different file. inotify (where available) only decides *when* to
+ * wake up, so a missed or coalesced event can never lose data.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "follow.h"
+
+// The number of bytes requested per call to read().
+#define FOLLOW_BUFFER_SIZE 65536
+
+// The longest time, in milliseconds, the follower sleeps between checks.
+#define FOLLOW_POLL_MS 1000
+
+/**
+ * @struct Follower
+ * @brief The state of the file currently being followed.
+ */
+typedef struct
+{
+    const char *path; // The path given by the user.
+    int fd;           // The open file, or -1 while the path does not exist.
+    off_t offset;     // Number of bytes of the open file analyzed so far.
+    dev_t dev;        // Identity of the open file, to detect rotation.
+    ino_t ino;
+    int notify_fd;    // inotify instance, or -1 when polling.
+    int file_watch;   // inotify watch on the open file, or -1.
+} Follower;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void handle_stop(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+/**
+ * @brief Opens the followed path and, if possible, watches it for changes.
+ * @return 0 on success, -1 if the path could not be opened.
+ */
+static int open_target(Follower *f)
+{
+    f->fd = open(f->path, O_RDONLY);
+    if (f->fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(f->fd, &st) == 0)
+    {
+        f->dev = st.st_dev;
+        f->ino = st.st_ino;
+    }
+    f->offset = 0;
+
+#ifdef __linux__
+    if (f->notify_fd >= 0)
+    {
+        if (f->file_watch >= 0)
+        {
+            inotify_rm_watch(f->notify_fd, f->file_watch);
+        }
+        f->file_watch = inotify_add_watch(f->notify_fd, f->path,
+                                          IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief Analyzes every byte appended to the open file since the last call.
+ */
+static void drain(Follower *f, AppStats *stats, ScanState *state, char *buffer)
+{
+    while (f->fd >= 0)
+    {
+        ssize_t n = read(f->fd, buffer, FOLLOW_BUFFER_SIZE);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return; // Caught up (or a read error, which the next check retries).
+        }
+        f->offset += n;
+        analyze_buffer(stats, state, buffer, (size_t)n);
+    }
+}
+
+/**
+ * @brief Brings the statistics up to date with the file on disk.
+ */
+static void catch_up(Follower *f, AppStats *stats, ScanState *state, char *buffer)
+{
+    struct stat st;
+
+    // Truncation: the file is now shorter than what was already read, so
+    // it has been restarted (e.g. `> app.log` or copytruncate rotation).
+    // The totals describe the file as it is now, so they start over.
+    if (f->fd >= 0 && fstat(f->fd, &st) == 0 && st.st_size < f->offset)
+    {
+        fprintf(stderr, "%s: file truncated\n", f->path);
+        analyze_reset(stats, state);
+        lseek(f->fd, 0, SEEK_SET);
+        f->offset = 0;
+    }
+
+    drain(f, stats, state, buffer);
+
+    // Rotation: the path now names a different file (or nothing). Whatever
+    // was appended to the old file before the switch has been drained above.
+    if (stat(f->path, &st) != 0 || f->fd < 0 || st.st_dev != f->dev || st.st_ino != f->ino)
+    {
+        if (f->fd >= 0)
+        {
+            fprintf(stderr, "%s: file rotated\n", f->path);
+            // The new file continues the same log: keep the totals, but a
+            // word cannot run on from one file into the next.
+            analyze_flush_word(stats, state);
+            scan_state_init(state);
+            close(f->fd);
+            f->fd = -1;
+        }
+        if (open_target(f) == 0)
+        {
+            drain(f, stats, state, buffer);
+        }
+    }
+}
+
+/**
+ * @brief Sleeps until the file may have changed or the timeout expires.
+ */
+static void wait_for_change(Follower *f, int timeout_ms)
+{
+    if (f->notify_fd < 0)
+    {
+        struct timespec ts = {timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L};
+        nanosleep(&ts, NULL);
+        return;
+    }
+
+    struct pollfd pfd = {f->notify_fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) > 0)
+    {
+        // The events themselves are not needed: catch_up() re-checks
+        // everything. Just empty the queue so the next poll() blocks.
+        char events[4096];
+        while (read(f->notify_fd, events, sizeof(events)) > 0)
+        {
+        }
+    }
+}
+
+int follow_file(AppStats *stats, int interval, FollowCallback callback, void *ctx)
+{
+    Follower f = {stats->filename, -1, 0, 0, 0, -1, -1};
+
+#ifdef __linux__
+    f.notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (f.notify_fd >= 0)
+    {
+        // Watch the directory too, so a rotated file that is recreated
+        // under the same name wakes us up immediately.
+        char *dir = strdup(f.path);
+        char *slash = dir != NULL ? strrchr(dir, '/') : NULL;
+        if (slash != NULL)
+        {
+            slash[slash == dir ? 1 : 0] = '\0';
+        }
+        inotify_add_watch(f.notify_fd, slash != NULL ? dir : ".", IN_CREATE | IN_MOVED_TO);
+        free(dir);
+    }
+#endif
+
+    if (open_target(&f) != 0)
+    {
+        perror("Error opening file");
+        if (f.notify_fd >= 0)
+        {
+            close(f.notify_fd);
+        }
+        return -1;
+    }
+
+    char *buffer = malloc(FOLLOW_BUFFER_SIZE);
+    if (buffer == NULL)
+    {
+        close(f.fd);
+        if (f.notify_fd >= 0)
+        {
+            close(f.notify_fd);
+        }
+        return -1;
+    }
+
+    // Install the handlers without SA_RESTART so that a pending poll() or
+    // nanosleep() is interrupted and the final report goes out promptly.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    ScanState state;
+    scan_state_init(&state);
+
+    time_t next_report = time(NULL) + interval;
+    while (!stop_requested)
+    {
+        catch_up(&f, stats, &state, buffer);
+
+        time_t now = time(NULL);
+        int report = now >= next_report;
+        if (report)
+        {
+            next_report = now + interval;
+        }
+        if (callback != NULL)
+        {
+            callback(ctx, now, report);
+        }
+
+        long remaining_ms = (long)(next_report - now) * 1000;
+        wait_for_change(&f, remaining_ms < FOLLOW_POLL_MS ? (int)remaining_ms : FOLLOW_POLL_MS);
+    }
+
+    // Pick up anything written just before the signal, then flush the
+    // last word so the final report is complete.
+    catch_up(&f, stats, &state, buffer);
+    analyze_finish(stats, &state);
+
+    free(buffer);
+    if (f.fd >= 0)
+    {
+        close(f.fd);
+    }
+    if (f.notify_fd >= 0)
+    {
+        close(f.notify_fd);
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file follow.h
+ * @brief Public interface for follow mode (like `tail -f`).
+ *
+ * Follow mode keeps a file open and analyzes only the bytes appended to it,
+ * feeding them through the same scan loop as analyze_file(). It copes with
+ * log rotation (the file is renamed or deleted and recreated) and with
+ * truncation (the file is cut back to a smaller size).
+ */
+
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+#include <time.h>
+#include "analyzer.h"
+
+/**
+ * @brief A callback invoked periodically while following a file.
+ * @param ctx The context pointer given to follow_file().
+ * @param now The current wall time.
+ * @param report Non-zero if a report interval has elapsed.
+ */
+typedef void (*FollowCallback)(void *ctx, time_t now, int report);
+
+/**
+ * @brief Follows a file until interrupted, updating the statistics as it grows.
+ *
+ * On Linux the wait for new data is driven by inotify; elsewhere the file
+ * is polled. The function returns when SIGINT or SIGTERM is received.
+ *
+ * @param stats A pointer to an initialized AppStats struct (as for analyze_file()).
+ * @param interval The number of seconds between reports (must be > 0).
+ * @param callback Called at least once per second and with `report` set
+ *        every `interval` seconds. May be NULL.
+ * @param ctx Passed back to `callback`.
+ * @return 0 on a clean shutdown, -1 if the file could not be opened initially.
+ */
+int follow_file(AppStats *stats, int interval, FollowCallback callback, void *ctx);
+
+#endif // FOLLOW_H
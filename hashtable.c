@@ -3,6 +3,11 @@
  * @brief Implementation of the chained hash table for word frequency counting.
  */
 
+// strdup() is POSIX rather than ISO C, so it must be requested explicitly
+// when compiling with -std=c11.
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,9 +56,57 @@ HashTable *create_hash_table(int size)
     }
 
     ht->size = size;
+    ht->count = 0;
+    ht->grow = 0;
+    return ht;
+}
+
+HashTable *create_growing_hash_table(int size)
+{
+    HashTable *ht = create_hash_table(size);
+    if (ht != NULL)
+    {
+        ht->grow = 1;
+    }
     return ht;
 }
 
+/**
+ * @brief Counts a new word and, for a growing table that now holds more
+ *        words than buckets, doubles the buckets.
+ * If the larger bucket array cannot be allocated the table keeps its size,
+ * which is slower but still correct.
+ */
+static void word_added(HashTable *ht)
+{
+    ht->count++;
+    if (!ht->grow || ht->count <= ht->size || ht->size > INT_MAX / 2)
+    {
+        return;
+    }
+    int size = ht->size * 2;
+    Node **table = calloc(size, sizeof(Node *));
+    if (table == NULL)
+    {
+        return;
+    }
+    for (int b = 0; b < ht->size; b++)
+    {
+        Node *node = ht->table[b];
+        while (node != NULL)
+        {
+            Node *next = node->next;
+            unsigned int index = hash(node->word) % size;
+            node->next = table[index];
+            table[index] = node;
+            node = next;
+        }
+    }
+    free(ht->table);
+    ht->table = table;
+    ht->size = size;
+}
+
 void insert_word(HashTable *ht, const char *word)
 {
     if (ht == NULL || word == NULL)
@@ -97,15 +150,132 @@ void insert_word(HashTable *ht, const char *word)
     new_node->count = 1;
     new_node->next = ht->table[index]; // Point the new node to the old head.
     ht->table[index] = new_node;       // The new node is now the head.
+    word_added(ht);
 }
 
-void free_hash_table(HashTable *ht)
+Node *find_word(const HashTable *ht, const char *word)
 {
-    if (ht == NULL)
+    if (ht == NULL || word == NULL)
+    {
+        return NULL;
+    }
+
+    Node *current = ht->table[hash(word) % ht->size];
+    while (current != NULL)
+    {
+        if (strcmp(current->word, word) == 0)
+        {
+            return current;
+        }
+        current = current->next;
+    }
+    return NULL;
+}
+
+void add_word_count(HashTable *ht, const char *word, int delta)
+{
+    if (ht == NULL || word == NULL || delta == 0)
+    {
+        return;
+    }
+
+    unsigned int index = hash(word) % ht->size;
+
+    // Keep a pointer to the link that points at `current` so that a node
+    // can be unlinked without a separate "previous" variable.
+    Node **link = &ht->table[index];
+    while (*link != NULL)
+    {
+        Node *current = *link;
+        if (strcmp(current->word, word) == 0)
+        {
+            current->count += delta;
+            if (current->count <= 0)
+            {
+                *link = current->next;
+                free(current->word);
+                free(current);
+                ht->count--;
+            }
+            return;
+        }
+        link = &current->next;
+    }
+
+    // Only positive amounts create a new entry.
+    if (delta < 0)
     {
         return;
     }
 
+    Node *new_node = malloc(sizeof(Node));
+    if (new_node == NULL)
+    {
+        return;
+    }
+    new_node->word = strdup(word);
+    if (new_node->word == NULL)
+    {
+        free(new_node);
+        return;
+    }
+
+    new_node->count = delta;
+    new_node->next = ht->table[index];
+    ht->table[index] = new_node;
+    word_added(ht);
+}
+
+void walk_hash_table(const HashTable *ht, void (*visit)(void *ctx, const Node *node), void *ctx)
+{
+    size_t longest = 0;
+    for (int b = 0; b < ht->size; b++)
+    {
+        size_t n = 0;
+        for (const Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            n++;
+        }
+        longest = n > longest ? n : longest;
+    }
+    const Node **chain = malloc((longest > 0 ? longest : 1) * sizeof(Node *));
+    for (int b = 0; b < ht->size; b++)
+    {
+        size_t n = 0;
+        for (const Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            if (chain == NULL)
+            {
+                // Without memory for the chain every word is still visited;
+                // only the order within the chain differs.
+                visit(ctx, node);
+                continue;
+            }
+            chain[n++] = node;
+        }
+        while (n > 0)
+        {
+            visit(ctx, chain[--n]);
+        }
+    }
+    free(chain);
+}
+
+/**
+ * @brief walk_hash_table() visitor that adds a word to the table `ctx`.
+ */
+static void add_node(void *ctx, const Node *node)
+{
+    add_word_count(ctx, node->word, node->count);
+}
+
+void merge_hash_table(HashTable *dst, const HashTable *src)
+{
+    walk_hash_table(src, add_node, dst);
+}
+
+void clear_hash_table(HashTable *ht)
+{
     // Iterate through every bucket in the hash table.
     for (int i = 0; i < ht->size; i++)
     {
@@ -118,8 +288,20 @@ void free_hash_table(HashTable *ht)
             free(temp->word);        // Free the dynamically allocated word string.
             free(temp);              // Free the node structure itself.
         }
+        ht->table[i] = NULL;
+    }
+    ht->count = 0;
+}
+
+void free_hash_table(HashTable *ht)
+{
+    if (ht == NULL)
+    {
+        return;
     }
 
+    clear_hash_table(ht);
+
     // Finally, free the array of buckets and the main table structure.
     free(ht->table);
     free(ht);
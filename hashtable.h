@@ -29,12 +29,17 @@ typedef struct Node
  * @brief The main hash table structure.
  *
  * The HashTable consists of an array of pointers to Nodes (the "buckets")
- * and the size of this array.
+ * and the size of this array. The word table keeps its size, since the
+ * report lists words in bucket order; a growing table (for sets whose size
+ * is not known in advance) doubles its buckets whenever it holds more words
+ * than buckets, so chains stay short.
  */
 typedef struct HashTable
 {
     int size;     // The number of buckets in the table.
     Node **table; // The Pointer to the array of Node Pointers.
+    int count;    // The number of words in the table.
+    int grow;     // Non-zero if the table doubles its buckets as it fills.
 } HashTable;
 
 /**
@@ -44,6 +49,15 @@ typedef struct HashTable
  */
 HashTable *create_hash_table(int size);
 
+/**
+ * @brief Creates a new, empty hash table that grows as words are added.
+ * The order of its buckets changes as it grows, so it suits sets that are
+ * only counted or ranked, not listed in table order.
+ * @param size The initial number of buckets.
+ * @return A pointer to the newly created HashTable, or NULL on failure.
+ */
+HashTable *create_growing_hash_table(int size);
+
 /**
  * @brief Inserts a word into the hash table.
  * If the word already exiits, its count is incremented. Otherwise, a new
@@ -53,6 +67,55 @@ HashTable *create_hash_table(int size);
  */
 void insert_word(HashTable *ht, const char *word);
 
+/**
+ * @brief Looks up a word in the hash table.
+ * @param ht A pointer to the HashTable.
+ * @param word The word to look for.
+ * @return A pointer to the word's Node, or NULL if the word is not present.
+ */
+Node *find_word(const HashTable *ht, const char *word);
+
+/**
+ * @brief Adds a (possibly negative) amount to a word's count.
+ * A word that is not yet present is created with a count of `delta`. A word
+ * whose count drops to zero or below is removed from the table.
+ * @param ht A pointer to the HashTable.
+ * @param word The word to update.
+ * @param delta The amount to add to the word's count.
+ */
+void add_word_count(HashTable *ht, const char *word, int delta);
+
+/**
+ * @brief Calls `visit` for every word of a table, each chain oldest word
+ *        first (the reverse of the chain order, since new words are pushed
+ *        at the head).
+ *
+ * Inserting the words into an empty table of the same size in this order
+ * rebuilds the table exactly.
+ * @param ht The table to walk.
+ * @param visit Called with `ctx` and each node.
+ * @param ctx Passed through to `visit`.
+ */
+void walk_hash_table(const HashTable *ht, void (*visit)(void *ctx, const Node *node), void *ctx);
+
+/**
+ * @brief Adds every word of one table, with its count, to another.
+ *
+ * The words are added in the order of walk_hash_table(), so when both
+ * tables have the same size, `dst` ends up exactly as if the words had
+ * been inserted into it directly, in the order they were first inserted
+ * into `src`.
+ * @param dst The table to add to.
+ * @param src The table to add; it is not modified.
+ */
+void merge_hash_table(HashTable *dst, const HashTable *src);
+
+/**
+ * @brief Removes every word from a hash table, keeping its buckets.
+ * @param ht The table to empty.
+ */
+void clear_hash_table(HashTable *ht);
+
 /**
  * @brief Frees all memory associated with a hash table.
  * This includes all nodes, all word strings within the nodes, the bucket
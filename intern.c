@@ -0,0 +1,198 @@
+/**
+ * @file intern.c
+ * @brief Implementation of the word interner.
+ *
+ * Strings are copied into large arena chunks so that interning millions of
+ * words costs a handful of allocations. The table stores only IDs; each
+ * word's hash is kept alongside it so growing the table never rehashes a
+ * string.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+// Initial number of table slots; the table doubles at 50% load.
+#define INITIAL_CAPACITY 4096
+
+// Size of each string arena chunk.
+#define CHUNK_SIZE (1 << 16)
+
+static uint64_t hash_word(const char *word)
+{
+    uint64_t h = 14695981039346656037ULL; // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)word; *p != '\0'; p++)
+    {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h ^ (h >> 29);
+}
+
+Interner *create_interner(void)
+{
+    Interner *in = calloc(1, sizeof(Interner));
+    if (in == NULL)
+    {
+        return NULL;
+    }
+    in->slots = calloc(INITIAL_CAPACITY, sizeof(uint32_t));
+    if (in->slots == NULL)
+    {
+        free(in);
+        return NULL;
+    }
+    in->capacity = INITIAL_CAPACITY;
+    return in;
+}
+
+/**
+ * @brief Returns the slot holding `word`, or the empty slot where it belongs.
+ */
+static size_t find_slot(const Interner *in, const char *word, uint64_t hash)
+{
+    size_t mask = in->capacity - 1;
+    size_t i = hash & mask;
+    while (in->slots[i] != 0)
+    {
+        uint32_t id = in->slots[i] - 1;
+        if (in->hashes[id] == hash && strcmp(in->words[id], word) == 0)
+        {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+uint32_t find_interned(const Interner *in, const char *word)
+{
+    size_t i = find_slot(in, word, hash_word(word));
+    return in->slots[i] != 0 ? in->slots[i] - 1 : INTERN_FAILED;
+}
+
+/**
+ * @brief Doubles the table, re-placing every ID by its stored hash.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int grow_table(Interner *in)
+{
+    size_t capacity = in->capacity * 2;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (slots == NULL)
+    {
+        return -1;
+    }
+    for (uint32_t id = 0; id < in->count; id++)
+    {
+        size_t i = in->hashes[id] & (capacity - 1);
+        while (slots[i] != 0)
+        {
+            i = (i + 1) & (capacity - 1);
+        }
+        slots[i] = id + 1;
+    }
+    free(in->slots);
+    in->slots = slots;
+    in->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Copies a string into the arena.
+ * @return The copy, or NULL on allocation failure.
+ */
+static char *arena_copy(Interner *in, const char *word, size_t len)
+{
+    if (in->chunk_count == 0 || in->chunk_used + len + 1 > CHUNK_SIZE)
+    {
+        size_t size = len + 1 > CHUNK_SIZE ? len + 1 : CHUNK_SIZE;
+        char **chunks = realloc(in->chunks, (size_t)(in->chunk_count + 1) * sizeof(char *));
+        if (chunks == NULL)
+        {
+            return NULL;
+        }
+        in->chunks = chunks;
+        in->chunks[in->chunk_count] = malloc(size);
+        if (in->chunks[in->chunk_count] == NULL)
+        {
+            return NULL;
+        }
+        in->chunk_count++;
+        in->chunk_used = 0;
+    }
+    char *copy = in->chunks[in->chunk_count - 1] + in->chunk_used;
+    memcpy(copy, word, len + 1);
+    in->chunk_used += len + 1;
+    return copy;
+}
+
+uint32_t intern_word(Interner *in, const char *word)
+{
+    uint64_t hash = hash_word(word);
+    size_t i = find_slot(in, word, hash);
+    if (in->slots[i] != 0)
+    {
+        return in->slots[i] - 1;
+    }
+    if (in->count == INTERN_FAILED - 1 || (size_t)in->count + 1 >= in->capacity)
+    {
+        return INTERN_FAILED;
+    }
+
+    if (in->count == in->words_cap)
+    {
+        uint32_t cap = in->words_cap ? in->words_cap * 2 : 1024;
+        char **words = realloc(in->words, cap * sizeof(char *));
+        if (words == NULL)
+        {
+            return INTERN_FAILED;
+        }
+        in->words = words;
+        uint64_t *hashes = realloc(in->hashes, cap * sizeof(uint64_t));
+        if (hashes == NULL)
+        {
+            return INTERN_FAILED;
+        }
+        in->hashes = hashes;
+        in->words_cap = cap;
+    }
+
+    char *copy = arena_copy(in, word, strlen(word));
+    if (copy == NULL)
+    {
+        return INTERN_FAILED;
+    }
+    uint32_t id = in->count++;
+    in->words[id] = copy;
+    in->hashes[id] = hash;
+    in->slots[i] = id + 1;
+
+    if ((size_t)in->count * 2 > in->capacity)
+    {
+        grow_table(in); // On failure the table just runs fuller.
+    }
+    return id;
+}
+
+const char *interned_word(const Interner *in, uint32_t id)
+{
+    return in->words[id];
+}
+
+void free_interner(Interner *in)
+{
+    if (in == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < in->chunk_count; i++)
+    {
+        free(in->chunks[i]);
+    }
+    free(in->chunks);
+    free(in->slots);
+    free(in->words);
+    free(in->hashes);
+    free(in);
+}
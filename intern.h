@@ -0,0 +1,73 @@
+/**
+ * @file intern.h
+ * @brief Public interface for the word interner.
+ *
+ * The interner maps each distinct word to a small dense integer ID (0, 1,
+ * 2, ...) and back. Modules that relate words to each other store these
+ * 32-bit IDs instead of strings, which keeps their tables compact and lets
+ * two IDs be packed into a single 64-bit key.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returned by intern_word() when the word could not be stored.
+#define INTERN_FAILED UINT32_MAX
+
+/**
+ * @struct Interner
+ * @brief An open-addressing table from words to IDs, plus the ID-to-word array.
+ */
+typedef struct
+{
+    uint32_t *slots;   // Table of ID + 1 (0 marks an empty slot).
+    size_t capacity;   // Number of slots; always a power of two.
+    char **words;      // words[id] is the interned string.
+    uint64_t *hashes;  // hashes[id] is the word's hash, kept for rehashing.
+    uint32_t count;    // Number of distinct words.
+    uint32_t words_cap;
+    char **chunks;     // Arena chunks holding the strings.
+    int chunk_count;
+    size_t chunk_used; // Bytes used in the last chunk.
+} Interner;
+
+/**
+ * @brief Creates an empty interner.
+ * @return A pointer to the new Interner, or NULL on failure.
+ */
+Interner *create_interner(void);
+
+/**
+ * @brief Returns the ID of a word, assigning the next free ID if it is new.
+ * @param in A pointer to the Interner.
+ * @param word The NUL-terminated word.
+ * @return The word's ID, or INTERN_FAILED on allocation failure.
+ */
+uint32_t intern_word(Interner *in, const char *word);
+
+/**
+ * @brief Looks up a word without adding it.
+ * @param in A pointer to the Interner.
+ * @param word The NUL-terminated word.
+ * @return The word's ID, or INTERN_FAILED if it was never interned.
+ */
+uint32_t find_interned(const Interner *in, const char *word);
+
+/**
+ * @brief Returns the word for an ID.
+ * @param in A pointer to the Interner.
+ * @param id An ID previously returned by intern_word().
+ * @return The interned string, owned by the interner.
+ */
+const char *interned_word(const Interner *in, uint32_t id);
+
+/**
+ * @brief Frees all memory associated with an Interner.
+ * @param in A pointer to the Interner to be freed.
+ */
+void free_interner(Interner *in);
+
+#endif // INTERN_H
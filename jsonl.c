@@ -0,0 +1,526 @@
+/**
+ * @file jsonl.c
+ * @brief Implementation of per-key statistics for JSON-lines input.
+ *
+ * The structural indexer follows the approach popularised by simdjson:
+ *   1. For each 64-byte block, build bitmasks of quotes, backslashes and
+ *      structural characters ({ } [ ] : ,).
+ *   2. Remove quotes that are escaped by an odd run of backslashes.
+ *   3. A prefix XOR over the remaining quotes marks the bytes inside
+ *      strings; structural characters inside strings are discarded.
+ * The walker then only visits the surviving positions, which for typical
+ * log lines is a few dozen per line regardless of how long the values are.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jsonl.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// The initial number of buckets in each key's value table, which grows
+// with the number of distinct values.
+#define VALUE_TABLE_SIZE 64
+
+// What the walker expects next inside the top-level object.
+enum
+{
+    EXPECT_KEY,
+    EXPECT_COLON,
+    EXPECT_VALUE,
+    AFTER_VALUE
+};
+
+JsonlStats *create_jsonl_stats(const char *const *keys, int count, int top)
+{
+    if (keys == NULL || count < 1 || count > MAX_JSON_KEYS)
+    {
+        return NULL;
+    }
+
+    JsonlStats *js = calloc(1, sizeof(JsonlStats));
+    if (js == NULL)
+    {
+        return NULL;
+    }
+    js->top = top;
+    for (int i = 0; i < count; i++)
+    {
+        JsonKeyStats *k = &js->keys[js->key_count++];
+        k->key = strdup(keys[i]);
+        k->key_len = k->key != NULL ? strlen(k->key) : 0;
+        k->values = create_growing_hash_table(VALUE_TABLE_SIZE);
+        if (k->key == NULL || k->values == NULL)
+        {
+            free_jsonl_stats(js);
+            return NULL;
+        }
+    }
+    return js;
+}
+
+/**
+ * @brief Builds the quote, backslash and structural bitmasks for 64 bytes.
+ */
+static void classify_block(const unsigned char *p, uint64_t *quotes, uint64_t *backslashes,
+                           uint64_t *structurals)
+{
+#if defined(__SSE2__)
+    uint64_t q = 0, b = 0, s = 0;
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');  // '[' | 0x20 == '{'
+    const __m128i close = _mm_set1_epi8('}'); // ']' | 0x20 == '}'
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i folded = _mm_or_si128(v, lower);
+        __m128i st = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        q |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << (16 * i);
+        b |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << (16 * i);
+        s |= (uint64_t)(unsigned)_mm_movemask_epi8(st) << (16 * i);
+    }
+    *quotes = q;
+    *backslashes = b;
+    *structurals = s;
+#else
+    uint64_t q = 0, b = 0, s = 0;
+    for (int i = 0; i < 64; i++)
+    {
+        unsigned char c = p[i];
+        q |= (uint64_t)(c == '"') << i;
+        b |= (uint64_t)(c == '\\') << i;
+        s |= (uint64_t)(c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') << i;
+    }
+    *quotes = q;
+    *backslashes = b;
+    *structurals = s;
+#endif
+}
+
+/**
+ * @brief Returns a mask with bit i set if an odd number of bits 0..i are set.
+ */
+static uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/**
+ * @brief Copies a JSON string body into the scratch buffer, resolving escapes.
+ * @return The unescaped, NUL-terminated value, or NULL on allocation failure.
+ */
+static const char *unescape(JsonlStats *js, const char *s, size_t len)
+{
+    if (len + 1 > js->value_cap)
+    {
+        char *grown = realloc(js->value, len + 1);
+        if (grown == NULL)
+        {
+            return NULL;
+        }
+        js->value = grown;
+        js->value_cap = len + 1;
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = s[i];
+        if (c == '\\' && i + 1 < len)
+        {
+            c = s[++i];
+            switch (c)
+            {
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'u':
+                // \uXXXX is kept verbatim; values are only compared, never
+                // displayed as decoded text.
+                js->value[out++] = '\\';
+                break;
+            default:
+                break; // \" \\ \/ map to the character itself.
+            }
+        }
+        js->value[out++] = c;
+    }
+    js->value[out] = '\0';
+    return js->value;
+}
+
+static int find_key(const JsonlStats *js, const char *s, size_t len)
+{
+    for (int i = 0; i < js->key_count; i++)
+    {
+        if (js->keys[i].key_len == len && memcmp(js->keys[i].key, s, len) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void record_value(JsonlStats *js, int key, unsigned *seen, const char *s, size_t len)
+{
+    const char *value = unescape(js, s, len);
+    if (value == NULL)
+    {
+        return;
+    }
+    insert_word(js->keys[key].values, value);
+    if (!(*seen & (1u << key)))
+    {
+        *seen |= 1u << key;
+        js->keys[key].present++;
+    }
+}
+
+/**
+ * @brief Returns non-zero if value `a` ranks above value `b`: more
+ *        frequent, or as frequent and alphabetically first.
+ */
+static int ranks_before(const Node *a, const Node *b)
+{
+    return a->count > b->count || (a->count == b->count && strcmp(a->word, b->word) < 0);
+}
+
+/**
+ * @brief Records a non-string value (number, true, false, null), which runs
+ *        from after the colon to the next comma or brace.
+ */
+static void record_scalar(JsonlStats *js, int key, unsigned *seen, const char *s, size_t len)
+{
+    while (len > 0 && (*s == ' ' || *s == '\t'))
+    {
+        s++;
+        len--;
+    }
+    while (len > 0 && (s[len - 1] == ' ' || s[len - 1] == '\t'))
+    {
+        len--;
+    }
+    if (len > 0)
+    {
+        record_value(js, key, seen, s, len);
+    }
+}
+
+void process_json_line(JsonlStats *js, const char *line, size_t len)
+{
+    // Skip surrounding whitespace (including a CR from CRLF endings); blank
+    // lines are not counted at all.
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t'))
+    {
+        len--;
+    }
+    if (len == 0)
+    {
+        return;
+    }
+    js->lines++;
+
+    int depth = 0, mode = EXPECT_KEY, in_string = 0, key = -1, done = 0, bad = 0;
+    size_t string_start = 0, value_start = 0;
+    unsigned seen = 0;
+    uint64_t escape_carry = 0, string_carry = 0;
+
+    for (size_t base = 0; base < len && !bad; base += 64)
+    {
+        // The final partial block is padded with spaces, which are never structural.
+        unsigned char block[64];
+        const unsigned char *p = (const unsigned char *)line + base;
+        if (len - base < 64)
+        {
+            memset(block, ' ', sizeof(block));
+            memcpy(block, p, len - base);
+            p = block;
+        }
+
+        uint64_t quotes, backslashes, structurals;
+        classify_block(p, &quotes, &backslashes, &structurals);
+
+        // A backslash escapes the next byte unless it is itself escaped.
+        uint64_t escaped = escape_carry;
+        escape_carry = 0;
+        while (backslashes != 0)
+        {
+            int i = __builtin_ctzll(backslashes);
+            backslashes &= backslashes - 1;
+            if ((escaped >> i) & 1)
+            {
+                continue;
+            }
+            if (i == 63)
+            {
+                escape_carry = 1;
+            }
+            else
+            {
+                escaped |= 1ULL << (i + 1);
+            }
+        }
+        quotes &= ~escaped;
+
+        uint64_t inside = prefix_xor(quotes) ^ string_carry;
+        string_carry = (uint64_t)0 - (inside >> 63); // All ones if the block ends in a string.
+        uint64_t events = (structurals & ~inside) | quotes;
+
+        while (events != 0 && !bad)
+        {
+            size_t pos = base + (size_t)__builtin_ctzll(events);
+            events &= events - 1;
+            char c = line[pos];
+
+            if (done)
+            {
+                bad = 1; // Anything after the closing brace.
+                break;
+            }
+            if (c == '"')
+            {
+                if (!in_string)
+                {
+                    in_string = 1;
+                    string_start = pos + 1;
+                    continue;
+                }
+                in_string = 0;
+                if (depth != 1)
+                {
+                    continue; // A string inside a nested value.
+                }
+                if (mode == EXPECT_KEY)
+                {
+                    key = find_key(js, line + string_start, pos - string_start);
+                    mode = EXPECT_COLON;
+                }
+                else if (mode == EXPECT_VALUE)
+                {
+                    if (key >= 0)
+                    {
+                        record_value(js, key, &seen, line + string_start, pos - string_start);
+                    }
+                    mode = AFTER_VALUE;
+                }
+                else
+                {
+                    bad = 1;
+                }
+                continue;
+            }
+
+            if (c == '{' || c == '[')
+            {
+                if (depth == 0 && c != '{')
+                {
+                    bad = 1;
+                }
+                else if (depth == 1 && mode != EXPECT_VALUE)
+                {
+                    bad = 1;
+                }
+                depth++;
+            }
+            else if (c == '}' || c == ']')
+            {
+                if (depth == 1)
+                {
+                    if (mode == EXPECT_VALUE && key >= 0)
+                    {
+                        record_scalar(js, key, &seen, line + value_start, pos - value_start);
+                    }
+                    done = 1;
+                }
+                else if (depth == 2)
+                {
+                    mode = AFTER_VALUE; // A nested object/array value just closed.
+                }
+                depth--;
+                if (depth < 0)
+                {
+                    bad = 1;
+                }
+            }
+            else if (depth == 1 && c == ':')
+            {
+                if (mode != EXPECT_COLON)
+                {
+                    bad = 1;
+                }
+                mode = EXPECT_VALUE;
+                value_start = pos + 1;
+            }
+            else if (depth == 1 && c == ',')
+            {
+                if (mode == EXPECT_VALUE && key >= 0)
+                {
+                    record_scalar(js, key, &seen, line + value_start, pos - value_start);
+                }
+                else if (mode != AFTER_VALUE && mode != EXPECT_VALUE)
+                {
+                    bad = 1;
+                }
+                mode = EXPECT_KEY;
+                key = -1;
+            }
+        }
+    }
+
+    if (bad || !done || in_string)
+    {
+        js->malformed++;
+    }
+}
+
+static void jsonl_on_buffer(void *ctx, const char *buf, size_t len)
+{
+    JsonlStats *js = ctx;
+    const char *end = buf + len;
+    while (buf < end)
+    {
+        const char *newline = memchr(buf, '\n', (size_t)(end - buf));
+        size_t n = (newline != NULL) ? (size_t)(newline - buf) : (size_t)(end - buf);
+
+        if (newline != NULL && js->line_len == 0)
+        {
+            process_json_line(js, buf, n); // The whole line is in this buffer.
+        }
+        else
+        {
+            // Assemble a line that spans buffers.
+            if (js->line_len + n > js->line_cap)
+            {
+                size_t cap = js->line_cap ? js->line_cap : 4096;
+                while (cap < js->line_len + n)
+                {
+                    cap *= 2;
+                }
+                char *grown = realloc(js->line, cap);
+                if (grown == NULL)
+                {
+                    return;
+                }
+                js->line = grown;
+                js->line_cap = cap;
+            }
+            memcpy(js->line + js->line_len, buf, n);
+            js->line_len += n;
+            if (newline != NULL)
+            {
+                process_json_line(js, js->line, js->line_len);
+                js->line_len = 0;
+            }
+        }
+        buf += n + (newline != NULL);
+    }
+}
+
+static void jsonl_on_finish(void *ctx)
+{
+    JsonlStats *js = ctx;
+    if (js->line_len > 0)
+    {
+        process_json_line(js, js->line, js->line_len);
+        js->line_len = 0;
+    }
+}
+
+void jsonl_scan_hook(JsonlStats *js, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = jsonl_on_buffer;
+    hook->on_finish = jsonl_on_finish;
+    hook->ctx = js;
+}
+
+void print_json_key_stats(const JsonlStats *js, FILE *output_stream)
+{
+    fprintf(output_stream, "Lines: %lld (%lld malformed)\n", js->lines, js->malformed);
+    for (int k = 0; k < js->key_count; k++)
+    {
+        const JsonKeyStats *ks = &js->keys[k];
+
+        // Select the most frequent values with a small insertion-sorted list.
+        const Node **top = calloc(js->top > 0 ? js->top : 1, sizeof(Node *));
+        int top_len = 0;
+        long long distinct = 0;
+        for (int b = 0; b < ks->values->size; b++)
+        {
+            for (const Node *n = ks->values->table[b]; n != NULL; n = n->next)
+            {
+                distinct++;
+                // Ties go to the smaller value, so the bucket order does not matter.
+                if (top == NULL || js->top <= 0 ||
+                    (top_len == js->top && !ranks_before(n, top[top_len - 1])))
+                {
+                    continue;
+                }
+                int i = (top_len < js->top) ? top_len++ : js->top - 1;
+                while (i > 0 && ranks_before(n, top[i - 1]))
+                {
+                    top[i] = top[i - 1];
+                    i--;
+                }
+                top[i] = n;
+            }
+        }
+
+        fprintf(output_stream, "\n  Key \"%s\": present in %lld lines, %lld distinct values\n",
+                ks->key, ks->present, distinct);
+        if (top_len > 0)
+        {
+            fprintf(output_stream, "    %-30s %s\n", "Value", "Count");
+            fprintf(output_stream, "    %-30s %s\n", "------------------------------", "-----");
+        }
+        for (int i = 0; i < top_len; i++)
+        {
+            fprintf(output_stream, "    %-30s %d\n", top[i]->word, top[i]->count);
+        }
+        free(top);
+    }
+}
+
+void free_jsonl_stats(JsonlStats *js)
+{
+    if (js == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < js->key_count; i++)
+    {
+        free(js->keys[i].key);
+        free_hash_table(js->keys[i].values);
+    }
+    free(js->line);
+    free(js->value);
+    free(js);
+}
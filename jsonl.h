@@ -0,0 +1,90 @@
+/**
+ * @file jsonl.h
+ * @brief Public interface for per-key statistics of JSON-lines input.
+ *
+ * Each input line is expected to hold one JSON object. Rather than building
+ * a document tree, every line is run through a structural indexer that finds
+ * the quotes, braces, colons and commas outside of strings 64 bytes at a
+ * time; a tiny state machine then walks those positions to pick out the
+ * values of the selected top-level keys. Each key gets its own table of
+ * value frequencies.
+ */
+
+#ifndef JSONL_H
+#define JSONL_H
+
+#include <stdio.h>
+#include "analyzer.h"
+
+// The maximum number of keys that can be selected.
+#define MAX_JSON_KEYS 16
+
+/**
+ * @struct JsonKeyStats
+ * @brief The values seen for one selected key.
+ */
+typedef struct
+{
+    char *key;         // The key name.
+    size_t key_len;    // Length of `key` in bytes.
+    long long present; // Number of lines where the key was found.
+    HashTable *values; // Every distinct value and how often it occurred.
+} JsonKeyStats;
+
+/**
+ * @struct JsonlStats
+ * @brief Per-key statistics and the line assembly state.
+ */
+typedef struct
+{
+    JsonKeyStats keys[MAX_JSON_KEYS];
+    int key_count;
+    long long lines;     // Non-blank lines seen.
+    long long malformed; // Lines that were not a well-formed JSON object.
+    int top;             // Number of values listed per key in the report.
+
+    char *line;          // A line split across two buffers, assembled here.
+    size_t line_len;
+    size_t line_cap;
+    char *value;         // Scratch space for unescaping a value.
+    size_t value_cap;
+} JsonlStats;
+
+/**
+ * @brief Creates per-key statistics for a set of top-level keys.
+ * @param keys The key names.
+ * @param count The number of keys (1 to MAX_JSON_KEYS).
+ * @param top The number of most frequent values to report per key.
+ * @return A pointer to the new JsonlStats, or NULL on failure.
+ */
+JsonlStats *create_jsonl_stats(const char *const *keys, int count, int top);
+
+/**
+ * @brief Fills in a ScanHook that extracts the keys from every scanned line.
+ * @param js A pointer to the JsonlStats.
+ * @param hook The hook to fill in.
+ */
+void jsonl_scan_hook(JsonlStats *js, ScanHook *hook);
+
+/**
+ * @brief Processes one complete line (without its newline).
+ * @param js A pointer to the JsonlStats.
+ * @param line The bytes of the line.
+ * @param len The number of bytes in `line`.
+ */
+void process_json_line(JsonlStats *js, const char *line, size_t len);
+
+/**
+ * @brief Prints the per-key value tables to the given stream.
+ * @param js A pointer to the JsonlStats.
+ * @param output_stream The stream to write to.
+ */
+void print_json_key_stats(const JsonlStats *js, FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with a JsonlStats object.
+ * @param js A pointer to the JsonlStats to be freed.
+ */
+void free_jsonl_stats(JsonlStats *js);
+
+#endif // JSONL_H
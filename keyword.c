@@ -0,0 +1,486 @@
+/**
+ * @file keyword.c
+ * @brief Implementation of multi-keyword counting (Aho-Corasick + prefilter).
+ *
+ * The automaton is stored as a complete transition table over byte classes:
+ * bytes that appear in no keyword share class 0, so the table only needs as
+ * many columns as there are distinct keyword bytes.
+ *
+ * The prefilter assigns every keyword to one of KEYWORD_BUCKETS buckets and
+ * records, per bucket, which bytes may appear first and second. A position
+ * is a candidate only if some bucket accepts both of its bytes. On x86 the
+ * per-byte lookups are done 16 at a time with PSHUFB on the two nibbles of
+ * each byte; elsewhere (or on CPUs without SSSE3) plain tables are used.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "keyword.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KEYWORD_HAVE_SSSE3 1
+#endif
+
+/**
+ * @brief Appends a new, empty state to the automaton.
+ * @return The new state's index, or -1 on allocation failure.
+ */
+static int add_state(KeywordSet *ks, int *cap)
+{
+    if (ks->state_count == *cap)
+    {
+        int new_cap = *cap ? *cap * 2 : 256;
+        int *delta = realloc(ks->delta, (size_t)new_cap * ks->class_count * sizeof(int));
+        if (delta == NULL)
+        {
+            return -1;
+        }
+        ks->delta = delta;
+        int *terminal = realloc(ks->terminal, new_cap * sizeof(int));
+        if (terminal == NULL)
+        {
+            return -1;
+        }
+        ks->terminal = terminal;
+        *cap = new_cap;
+    }
+    int s = ks->state_count++;
+    for (int c = 0; c < ks->class_count; c++)
+    {
+        ks->delta[(size_t)s * ks->class_count + c] = -1;
+    }
+    ks->terminal[s] = -1;
+    return s;
+}
+
+/**
+ * @brief Computes failure links and completes the transition table.
+ * After this every entry of `delta` is a valid state.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int build_links(KeywordSet *ks)
+{
+    int n = ks->state_count, nc = ks->class_count;
+    int *fail = malloc(n * sizeof(int));
+    int *queue = malloc(n * sizeof(int));
+    ks->output = malloc(n * sizeof(int));
+    ks->next_output = malloc(n * sizeof(int));
+    if (fail == NULL || queue == NULL || ks->output == NULL || ks->next_output == NULL)
+    {
+        free(fail);
+        free(queue);
+        return -1;
+    }
+
+    // Breadth-first order guarantees that a state's failure target (which
+    // is shallower) is complete before the state itself is processed.
+    int head = 0, tail = 0;
+    fail[0] = 0;
+    ks->output[0] = -1;
+    ks->next_output[0] = -1;
+    queue[tail++] = 0;
+    while (head < tail)
+    {
+        int u = queue[head++];
+        for (int c = 0; c < nc; c++)
+        {
+            int *edge = &ks->delta[(size_t)u * nc + c];
+            int fallback = (u == 0) ? 0 : ks->delta[(size_t)fail[u] * nc + c];
+            if (*edge < 0)
+            {
+                *edge = fallback;
+                continue;
+            }
+            int v = *edge;
+            fail[v] = fallback;
+            ks->output[v] = (ks->terminal[v] >= 0) ? v : ks->output[fail[v]];
+            ks->next_output[v] = ks->output[fail[v]];
+            queue[tail++] = v;
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+/**
+ * @brief Records a keyword in the prefilter's bucket masks.
+ */
+static void add_fingerprint(KeywordSet *ks, const unsigned char *kw, int len, int bucket)
+{
+    uint8_t bit = (uint8_t)(1u << bucket);
+    ks->first_mask[kw[0]] |= bit;
+    ks->nibble_masks[0][kw[0] & 15] |= bit;
+    ks->nibble_masks[1][kw[0] >> 4] |= bit;
+    if (len >= 2)
+    {
+        ks->second_mask[kw[1]] |= bit;
+        ks->nibble_masks[2][kw[1] & 15] |= bit;
+        ks->nibble_masks[3][kw[1] >> 4] |= bit;
+    }
+    else
+    {
+        // A one-byte keyword accepts any following byte.
+        for (int c = 0; c < 256; c++)
+        {
+            ks->second_mask[c] |= bit;
+        }
+        for (int n = 0; n < 16; n++)
+        {
+            ks->nibble_masks[2][n] |= bit;
+            ks->nibble_masks[3][n] |= bit;
+        }
+    }
+}
+
+KeywordSet *create_keyword_set(const char *const *keywords, int count)
+{
+    if (keywords == NULL || count < 1)
+    {
+        return NULL;
+    }
+
+    KeywordSet *ks = calloc(1, sizeof(KeywordSet));
+    if (ks == NULL)
+    {
+        return NULL;
+    }
+    ks->keywords = calloc(count, sizeof(char *));
+    ks->lengths = calloc(count, sizeof(int));
+    ks->matches = calloc(count, sizeof(long long));
+    ks->first_offset = calloc(count, sizeof(long long));
+    ks->first_file = calloc(count, sizeof(int));
+    ks->file = 1;
+    if (ks->keywords == NULL || ks->lengths == NULL || ks->matches == NULL ||
+        ks->first_offset == NULL || ks->first_file == NULL)
+    {
+        free_keyword_set(ks);
+        return NULL;
+    }
+
+    // Bytes used by any keyword get their own class; all others share class 0.
+    ks->class_count = 1;
+    for (int i = 0; i < count; i++)
+    {
+        for (const unsigned char *p = (const unsigned char *)keywords[i]; *p != '\0'; p++)
+        {
+            if (ks->classes[*p] == 0)
+            {
+                ks->classes[*p] = (uint8_t)ks->class_count++;
+            }
+        }
+    }
+
+    int cap = 0;
+    if (add_state(ks, &cap) < 0)
+    {
+        free_keyword_set(ks);
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const unsigned char *kw = (const unsigned char *)keywords[i];
+        int len = (int)strlen(keywords[i]);
+        if (len == 0)
+        {
+            continue;
+        }
+
+        int s = 0;
+        for (int j = 0; j < len; j++)
+        {
+            int *edge = &ks->delta[(size_t)s * ks->class_count + ks->classes[kw[j]]];
+            if (*edge < 0)
+            {
+                int t = add_state(ks, &cap);
+                if (t < 0)
+                {
+                    free_keyword_set(ks);
+                    return NULL;
+                }
+                // add_state() may have moved the table; look the edge up again.
+                edge = &ks->delta[(size_t)s * ks->class_count + ks->classes[kw[j]]];
+                *edge = t;
+            }
+            s = *edge;
+        }
+        if (ks->terminal[s] >= 0)
+        {
+            continue; // Duplicate keyword.
+        }
+
+        int id = ks->count++;
+        ks->keywords[id] = strdup(keywords[i]);
+        if (ks->keywords[id] == NULL)
+        {
+            free_keyword_set(ks);
+            return NULL;
+        }
+        ks->lengths[id] = len;
+        ks->first_offset[id] = -1;
+        ks->terminal[s] = id;
+        add_fingerprint(ks, kw, len, kw[0] % KEYWORD_BUCKETS);
+    }
+
+    if (ks->count == 0 || build_links(ks) != 0)
+    {
+        free_keyword_set(ks);
+        return NULL;
+    }
+
+#ifdef KEYWORD_HAVE_SSSE3
+    ks->use_simd = __builtin_cpu_supports("ssse3");
+#endif
+    return ks;
+}
+
+int add_keyword(char ***keywords, int *count, const char *word)
+{
+    char **grown = realloc(*keywords, (*count + 1) * sizeof(char *));
+    if (grown == NULL)
+    {
+        return -1;
+    }
+    *keywords = grown;
+
+    char *copy = strdup(word);
+    if (copy == NULL)
+    {
+        return -1;
+    }
+    (*keywords)[(*count)++] = copy;
+    return 0;
+}
+
+int load_keywords(const char *path, char ***keywords, int *count)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror("Error opening keyword file");
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    int status = 0;
+    while (status == 0 && (len = getline(&line, &line_cap, file)) >= 0)
+    {
+        // Strip the line ending, including a Windows-style "\r\n".
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        {
+            line[--len] = '\0';
+        }
+        if (len > 0)
+        {
+            status = add_keyword(keywords, count, line);
+        }
+    }
+
+    free(line);
+    fclose(file);
+    return status;
+}
+
+void free_keywords(char **keywords, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        free(keywords[i]);
+    }
+    free(keywords);
+}
+
+/**
+ * @brief Returns the first position at or after `i` that may start a keyword,
+ *        using the scalar tables.
+ */
+static size_t next_candidate_scalar(const KeywordSet *ks, const unsigned char *data, size_t i,
+                                    size_t len)
+{
+    for (; i + 1 < len; i++)
+    {
+        if (ks->first_mask[data[i]] & ks->second_mask[data[i + 1]])
+        {
+            return i;
+        }
+    }
+    // The last byte's successor is in the next buffer; only its first byte
+    // can be checked, which errs on the side of a candidate.
+    if (i < len && ks->first_mask[data[i]] == 0)
+    {
+        i++;
+    }
+    return i;
+}
+
+#ifdef KEYWORD_HAVE_SSSE3
+/**
+ * @brief SSSE3 version of next_candidate_scalar(): classifies 16 positions
+ *        per iteration with four nibble table lookups.
+ */
+__attribute__((target("ssse3"))) static size_t next_candidate_ssse3(const KeywordSet *ks,
+                                                                     const unsigned char *data,
+                                                                     size_t i, size_t len)
+{
+    const __m128i lo1 = _mm_loadu_si128((const __m128i *)ks->nibble_masks[0]);
+    const __m128i hi1 = _mm_loadu_si128((const __m128i *)ks->nibble_masks[1]);
+    const __m128i lo2 = _mm_loadu_si128((const __m128i *)ks->nibble_masks[2]);
+    const __m128i hi2 = _mm_loadu_si128((const __m128i *)ks->nibble_masks[3]);
+    const __m128i low_nibble = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+
+    // Each iteration reads 17 bytes: 16 positions plus the byte after the last.
+    for (; i + 17 <= len; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(data + i + 1));
+        __m128i m = _mm_and_si128(_mm_shuffle_epi8(lo1, _mm_and_si128(a, low_nibble)),
+                                  _mm_shuffle_epi8(hi1, _mm_and_si128(_mm_srli_epi16(a, 4), low_nibble)));
+        m = _mm_and_si128(m, _mm_shuffle_epi8(lo2, _mm_and_si128(b, low_nibble)));
+        m = _mm_and_si128(m, _mm_shuffle_epi8(hi2, _mm_and_si128(_mm_srli_epi16(b, 4), low_nibble)));
+        unsigned hits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) ^ 0xffffu;
+        if (hits != 0)
+        {
+            return i + (size_t)__builtin_ctz(hits);
+        }
+    }
+    return next_candidate_scalar(ks, data, i, len);
+}
+#endif
+
+/**
+ * @brief Counts every keyword that ends in automaton state `s`.
+ */
+static void record_matches(KeywordSet *ks, int s, long long end_offset)
+{
+    for (int t = ks->output[s]; t >= 0; t = ks->next_output[t])
+    {
+        int id = ks->terminal[t];
+        if (ks->matches[id]++ == 0)
+        {
+            ks->first_offset[id] = end_offset - ks->lengths[id] + 1;
+            ks->first_file[id] = ks->file;
+        }
+    }
+}
+
+void scan_keywords(KeywordSet *ks, const char *buf, size_t len)
+{
+    const unsigned char *data = (const unsigned char *)buf;
+    const int *delta = ks->delta;
+    const int *output = ks->output;
+    const int nc = ks->class_count;
+    int s = ks->state;
+    size_t i = 0;
+
+    while (i < len)
+    {
+        if (s == 0)
+        {
+            // At the root nothing is in progress, so skip straight to the
+            // next position where a keyword could start.
+#ifdef KEYWORD_HAVE_SSSE3
+            i = ks->use_simd ? next_candidate_ssse3(ks, data, i, len)
+                             : next_candidate_scalar(ks, data, i, len);
+#else
+            i = next_candidate_scalar(ks, data, i, len);
+#endif
+            if (i >= len)
+            {
+                break;
+            }
+        }
+
+        s = delta[(size_t)s * nc + ks->classes[data[i]]];
+        if (output[s] >= 0)
+        {
+            record_matches(ks, s, ks->offset + (long long)i);
+        }
+        i++;
+    }
+
+    ks->state = s;
+    ks->offset += (long long)len;
+}
+
+static void keyword_on_buffer(void *ctx, const char *buf, size_t len)
+{
+    scan_keywords(ctx, buf, len);
+}
+
+/**
+ * @brief Restarts the automaton and the offsets for the next input.
+ */
+static void keyword_on_finish(void *ctx)
+{
+    KeywordSet *ks = ctx;
+    ks->state = 0;
+    ks->offset = 0;
+    ks->file++;
+}
+
+void keyword_scan_hook(KeywordSet *ks, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = keyword_on_buffer;
+    hook->on_finish = keyword_on_finish;
+    hook->ctx = ks;
+}
+
+void print_keyword_counts(const KeywordSet *ks, FILE *output_stream)
+{
+    fprintf(output_stream, "  %-20s %-10s %s\n", "Keyword", "Count", "First Offset");
+    fprintf(output_stream, "  %-20s %-10s %s\n", "--------------------", "-----", "------------");
+    // Every input has been finished by now, so `file` is one past the last.
+    bool several = ks->file > 2;
+    for (int i = 0; i < ks->count; i++)
+    {
+        if (ks->first_offset[i] >= 0 && several)
+        {
+            fprintf(output_stream, "  %-20s %-10lld %lld (input %d)\n", ks->keywords[i],
+                    ks->matches[i], ks->first_offset[i], ks->first_file[i]);
+        }
+        else if (ks->first_offset[i] >= 0)
+        {
+            fprintf(output_stream, "  %-20s %-10lld %lld\n", ks->keywords[i], ks->matches[i],
+                    ks->first_offset[i]);
+        }
+        else
+        {
+            fprintf(output_stream, "  %-20s %-10lld -\n", ks->keywords[i], ks->matches[i]);
+        }
+    }
+}
+
+void free_keyword_set(KeywordSet *ks)
+{
+    if (ks == NULL)
+    {
+        return;
+    }
+    if (ks->keywords != NULL)
+    {
+        for (int i = 0; i < ks->count; i++)
+        {
+            free(ks->keywords[i]);
+        }
+    }
+    free(ks->keywords);
+    free(ks->lengths);
+    free(ks->matches);
+    free(ks->first_offset);
+    free(ks->first_file);
+    free(ks->delta);
+    free(ks->terminal);
+    free(ks->output);
+    free(ks->next_output);
+    free(ks);
+}
@@ -0,0 +1,117 @@
+/**
+ * @file keyword.h
+ * @brief Public interface for counting occurrences of fixed keywords.
+ *
+ * Keywords are matched as exact, case-sensitive byte strings with an
+ * Aho-Corasick automaton, so thousands of keywords are found in one pass.
+ * Whenever the automaton is back at its root, a SIMD prefilter (in the
+ * style of the "Teddy" algorithm) skips ahead to the next position whose
+ * first two bytes could begin any keyword; on typical logs most of the
+ * input is skipped this way without touching the automaton.
+ */
+
+#ifndef KEYWORD_H
+#define KEYWORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "analyzer.h"
+
+// The number of fingerprint buckets used by the prefilter.
+#define KEYWORD_BUCKETS 8
+
+/**
+ * @struct KeywordSet
+ * @brief A compiled keyword automaton and the running match state.
+ */
+typedef struct
+{
+    int count;               // Number of distinct keywords.
+    char **keywords;         // The keywords, in the order given.
+    int *lengths;            // Length of each keyword in bytes.
+    long long *matches;      // Number of occurrences of each keyword.
+    long long *first_offset; // Byte offset of the first occurrence in its input, or -1.
+    int *first_file;         // Input (from 1) of the first occurrence.
+
+    int class_count;         // Number of byte classes (class 0 = not in any keyword).
+    uint8_t classes[256];    // Maps every byte to its class.
+    int state_count;         // Number of automaton states (0 is the root).
+    int *delta;              // state_count x class_count transition table.
+    int *terminal;           // Per state: the keyword ending here, or -1.
+    int *output;             // Per state: first state on the suffix chain with a keyword, or -1.
+    int *next_output;        // Per keyword state: the next such state on its suffix chain.
+
+    uint8_t first_mask[256];  // Prefilter: buckets whose keywords can start with a byte.
+    uint8_t second_mask[256]; // Prefilter: buckets whose keywords can have it second.
+    uint8_t nibble_masks[4][16]; // The same masks split by nibble, for the SIMD path.
+    int use_simd;             // Whether the SIMD prefilter is available on this CPU.
+
+    int state;               // Current automaton state.
+    long long offset;        // Number of bytes of the current input scanned so far.
+    int file;                // Number of the current input, from 1.
+} KeywordSet;
+
+/**
+ * @brief Builds a keyword automaton.
+ * Empty and duplicate keywords are ignored.
+ * @param keywords An array of keyword strings.
+ * @param count The number of keywords.
+ * @return A pointer to the new KeywordSet, or NULL on failure.
+ */
+KeywordSet *create_keyword_set(const char *const *keywords, int count);
+
+/**
+ * @brief Appends a copy of a keyword to a growable array.
+ * @param keywords A pointer to the array (may point to NULL initially).
+ * @param count A pointer to the number of entries in `*keywords`.
+ * @param word The keyword to append.
+ * @return 0 on success, -1 on allocation failure.
+ */
+int add_keyword(char ***keywords, int *count, const char *word);
+
+/**
+ * @brief Reads keywords from a file, one per line.
+ * @param path The file to read.
+ * @param keywords A pointer to the array the keywords are appended to.
+ * @param count A pointer to the number of entries in `*keywords`.
+ * @return 0 on success, -1 on failure.
+ */
+int load_keywords(const char *path, char ***keywords, int *count);
+
+/**
+ * @brief Frees an array built by add_keyword() or load_keywords().
+ * @param keywords The array.
+ * @param count The number of entries in the array.
+ */
+void free_keywords(char **keywords, int count);
+
+/**
+ * @brief Fills in a ScanHook that runs the automaton over every scanned buffer.
+ * Matches do not span inputs: the automaton restarts at each new input.
+ * @param ks A pointer to the KeywordSet.
+ * @param hook The hook to fill in.
+ */
+void keyword_scan_hook(KeywordSet *ks, ScanHook *hook);
+
+/**
+ * @brief Scans a buffer for keywords, updating counts and first offsets.
+ * @param ks A pointer to the KeywordSet.
+ * @param buf The bytes to scan.
+ * @param len The number of bytes in `buf`.
+ */
+void scan_keywords(KeywordSet *ks, const char *buf, size_t len);
+
+/**
+ * @brief Prints the keyword count table to the given stream.
+ * @param ks A pointer to the KeywordSet.
+ * @param output_stream The stream to write to.
+ */
+void print_keyword_counts(const KeywordSet *ks, FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with a KeywordSet.
+ * @param ks A pointer to the KeywordSet to be freed.
+ */
+void free_keyword_set(KeywordSet *ks);
+
+#endif // KEYWORD_H
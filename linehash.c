@@ -0,0 +1,370 @@
+/**
+ * @file linehash.c
+ * @brief Implementation of unique/repeated line statistics.
+ *
+ * The line hash is two 64-bit multiply-rotate lanes fed eight bytes at a
+ * time, finished with the MurmurHash3 avalanche step. Bytes that do not
+ * fill a whole word are parked in a small tail so a line can be hashed
+ * piecewise across read buffers. With 128 bits, the chance of two distinct
+ * lines colliding is negligible even for billions of lines.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "linehash.h"
+
+// Initial number of slots in the set; it doubles at 70% load.
+#define INITIAL_CAPACITY 4096
+
+// Number of bytes of each repeated line shown in the report.
+#define DISPLAY_LEN 60
+
+#define C1 0x87c37b91114253d5ULL
+#define C2 0x4cf5ad432745937fULL
+
+static uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static void hasher_reset(LineHasher *h)
+{
+    h->h1 = 0x9e3779b97f4a7c15ULL;
+    h->h2 = 0x632be59bd9b4e019ULL;
+    h->tail_len = 0;
+}
+
+static void hasher_word(LineHasher *h, uint64_t k)
+{
+    h->h1 = rotl64(h->h1 ^ (k * C1), 31) * C2 + h->h2;
+    h->h2 = rotl64(h->h2 ^ (k * C2), 33) * C1 + h->h1;
+}
+
+static void hasher_update(LineHasher *h, const unsigned char *p, size_t len)
+{
+    if (h->tail_len > 0)
+    {
+        while (len > 0 && h->tail_len < 8)
+        {
+            h->tail[h->tail_len++] = *p++;
+            len--;
+        }
+        if (h->tail_len < 8)
+        {
+            return;
+        }
+        uint64_t k;
+        memcpy(&k, h->tail, 8);
+        hasher_word(h, k);
+        h->tail_len = 0;
+    }
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t k;
+        memcpy(&k, p, 8);
+        hasher_word(h, k);
+    }
+    memcpy(h->tail, p, len);
+    h->tail_len = (int)len;
+}
+
+static void hasher_final(LineHasher *h, long long length, uint64_t *lo, uint64_t *hi)
+{
+    uint64_t k = 0;
+    memcpy(&k, h->tail, (size_t)h->tail_len);
+    hasher_word(h, k ^ ((uint64_t)h->tail_len << 56));
+    uint64_t a = fmix64(h->h1 ^ (uint64_t)length);
+    uint64_t b = fmix64(h->h2 ^ rotl64((uint64_t)length, 32));
+    *lo = a + b;
+    *hi = b + *lo;
+}
+
+LineHashStats *create_line_hash_stats(int top)
+{
+    LineHashStats *lh = calloc(1, sizeof(LineHashStats));
+    if (lh == NULL)
+    {
+        return NULL;
+    }
+    lh->slots = calloc(INITIAL_CAPACITY, sizeof(LineSlot));
+    if (lh->slots == NULL)
+    {
+        free(lh);
+        return NULL;
+    }
+    lh->capacity = INITIAL_CAPACITY;
+    lh->top = top;
+    hasher_reset(&lh->hasher);
+    return lh;
+}
+
+/**
+ * @brief Doubles the table and re-inserts every occupied slot.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int grow_table(LineHashStats *lh)
+{
+    size_t capacity = lh->capacity * 2;
+    LineSlot *slots = calloc(capacity, sizeof(LineSlot));
+    if (slots == NULL)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < lh->capacity; i++)
+    {
+        const LineSlot *old = &lh->slots[i];
+        if (old->count == 0)
+        {
+            continue;
+        }
+        size_t j = old->lo & (capacity - 1);
+        while (slots[j].count != 0)
+        {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = *old;
+    }
+    free(lh->slots);
+    lh->slots = slots;
+    lh->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Counts the line that just ended and starts hashing the next one.
+ */
+static void end_line(LineHashStats *lh)
+{
+    long long length = lh->position - lh->line_start;
+    uint64_t lo, hi;
+    hasher_final(&lh->hasher, length, &lo, &hi);
+    hasher_reset(&lh->hasher);
+    lh->lines++;
+
+    if ((lh->distinct + 1) * 10 > lh->capacity * 7 && grow_table(lh) != 0)
+    {
+        // Out of memory: the line still counts towards the total, and the
+        // table keeps working until it is completely full.
+        if (lh->distinct + 1 >= lh->capacity)
+        {
+            return;
+        }
+    }
+
+    size_t mask = lh->capacity - 1;
+    size_t i = lo & mask;
+    while (lh->slots[i].count != 0 && (lh->slots[i].lo != lo || lh->slots[i].hi != hi))
+    {
+        i = (i + 1) & mask;
+    }
+    LineSlot *slot = &lh->slots[i];
+    if (slot->count == 0)
+    {
+        slot->lo = lo;
+        slot->hi = hi;
+        slot->offset = lh->line_start;
+        slot->length = length;
+        slot->file = lh->file;
+        lh->distinct++;
+    }
+    slot->count++;
+}
+
+void scan_line_hashes(LineHashStats *lh, const char *buf, size_t len)
+{
+    const char *end = buf + len;
+    while (buf < end)
+    {
+        const char *newline = memchr(buf, '\n', (size_t)(end - buf));
+        size_t n = (newline != NULL) ? (size_t)(newline - buf) : (size_t)(end - buf);
+        hasher_update(&lh->hasher, (const unsigned char *)buf, n);
+        lh->position += (long long)n;
+        buf += n;
+        if (newline != NULL)
+        {
+            end_line(lh);
+            buf++;
+            lh->position++;
+            lh->line_start = lh->position;
+        }
+    }
+}
+
+void finish_line_hashes(LineHashStats *lh)
+{
+    if (lh->position > lh->line_start)
+    {
+        end_line(lh);
+    }
+    lh->file++;
+    lh->position = 0;
+    lh->line_start = 0;
+}
+
+static void line_hash_on_buffer(void *ctx, const char *buf, size_t len)
+{
+    scan_line_hashes(ctx, buf, len);
+}
+
+static void line_hash_on_finish(void *ctx)
+{
+    finish_line_hashes(ctx);
+}
+
+void line_hash_scan_hook(LineHashStats *lh, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = line_hash_on_buffer;
+    hook->on_finish = line_hash_on_finish;
+    hook->ctx = lh;
+}
+
+/**
+ * @brief Reads a line back from its input file and checks it against its hash.
+ * @param fd The line's input file, or -1 if it cannot be read back.
+ * @param slot The line to read.
+ * @param text Receives the first DISPLAY_LEN bytes of the line, NUL-terminated.
+ * @return 0 if the bytes at the recorded offset still hash to the slot, -1 otherwise.
+ */
+static int read_back_line(int fd, const LineSlot *slot, char *text)
+{
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    LineHasher h;
+    hasher_reset(&h);
+    unsigned char chunk[65536];
+    long long done = 0;
+    while (done < slot->length)
+    {
+        size_t want = sizeof(chunk);
+        if ((long long)want > slot->length - done)
+        {
+            want = (size_t)(slot->length - done);
+        }
+        ssize_t got = pread(fd, chunk, want, (off_t)(slot->offset + done));
+        if (got <= 0)
+        {
+            return -1;
+        }
+        if (done < DISPLAY_LEN)
+        {
+            size_t keep = (size_t)(DISPLAY_LEN - done) < (size_t)got ? (size_t)(DISPLAY_LEN - done)
+                                                                     : (size_t)got;
+            memcpy(text + done, chunk, keep);
+        }
+        hasher_update(&h, chunk, (size_t)got);
+        done += got;
+    }
+    text[done < DISPLAY_LEN ? done : DISPLAY_LEN] = '\0';
+
+    uint64_t lo, hi;
+    hasher_final(&h, slot->length, &lo, &hi);
+    return (lo == slot->lo && hi == slot->hi) ? 0 : -1;
+}
+
+void print_line_hash_stats(const LineHashStats *lh, const char *const *filenames, int file_count,
+                           FILE *output_stream)
+{
+    long long once = 0, repeated = 0;
+    for (size_t i = 0; i < lh->capacity; i++)
+    {
+        once += (lh->slots[i].count == 1);
+        repeated += (lh->slots[i].count > 1);
+    }
+
+    fprintf(output_stream, "Total Lines:\t\t%lld\n", lh->lines);
+    fprintf(output_stream, "Distinct Lines:\t\t%zu\n", lh->distinct);
+    fprintf(output_stream, "Lines Seen Once:\t%lld\n", once);
+    fprintf(output_stream, "Repeated Lines:\t\t%lld (%lld duplicate occurrences)\n", repeated,
+            lh->lines - (long long)lh->distinct);
+    fprintf(output_stream, "Set Memory:\t\t%zu KB\n", lh->capacity * sizeof(LineSlot) / 1024);
+
+    if (repeated == 0 || lh->top <= 0)
+    {
+        return;
+    }
+
+    // Select the most repeated lines with a small insertion-sorted list.
+    const LineSlot **top = calloc((size_t)lh->top, sizeof(LineSlot *));
+    if (top == NULL)
+    {
+        return;
+    }
+    int top_len = 0;
+    for (size_t s = 0; s < lh->capacity; s++)
+    {
+        const LineSlot *slot = &lh->slots[s];
+        if (slot->count < 2 || (top_len == lh->top && top[top_len - 1]->count >= slot->count))
+        {
+            continue;
+        }
+        int i = (top_len < lh->top) ? top_len++ : lh->top - 1;
+        while (i > 0 && top[i - 1]->count < slot->count)
+        {
+            top[i] = top[i - 1];
+            i--;
+        }
+        top[i] = slot;
+    }
+
+    fprintf(output_stream, "\nMost Repeated Lines:\n");
+    fprintf(output_stream, "  %-10s %s\n", "Count", "Line");
+    fprintf(output_stream, "  %-10s %s\n", "----------", "----");
+    for (int i = 0; i < top_len; i++)
+    {
+        char text[DISPLAY_LEN + 1];
+        fprintf(output_stream, "  %-10lld ", top[i]->count);
+        const char *filename = top[i]->file < file_count ? filenames[top[i]->file] : "-";
+        int fd = (strcmp(filename, "-") != 0) ? open(filename, O_RDONLY) : -1;
+        int status = read_back_line(fd, top[i], text);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        if (status != 0)
+        {
+            fprintf(output_stream, "<line %016llx%016llx at offset %lld>\n",
+                    (unsigned long long)top[i]->hi, (unsigned long long)top[i]->lo,
+                    top[i]->offset);
+            continue;
+        }
+        for (char *c = text; *c != '\0'; c++)
+        {
+            if (!isprint((unsigned char)*c))
+            {
+                *c = '.';
+            }
+        }
+        fprintf(output_stream, "%s%s\n", text, top[i]->length > DISPLAY_LEN ? "..." : "");
+    }
+
+    free(top);
+}
+
+void free_line_hash_stats(LineHashStats *lh)
+{
+    if (lh == NULL)
+    {
+        return;
+    }
+    free(lh->slots);
+    free(lh);
+}
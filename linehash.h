@@ -0,0 +1,112 @@
+/**
+ * @file linehash.h
+ * @brief Public interface for unique/repeated line statistics.
+ *
+ * Every line is reduced to a 128-bit hash while it streams past, and the
+ * hashes go into an open-addressing set together with a count, the line's
+ * length and the byte offset of its first occurrence. No line text is kept,
+ * so memory grows with the number of distinct lines rather than with the
+ * size of the input; the text of the most repeated lines is read back from
+ * the file at report time.
+ */
+
+#ifndef LINEHASH_H
+#define LINEHASH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "analyzer.h"
+
+/**
+ * @struct LineSlot
+ * @brief One distinct line in the set. An empty slot has count 0.
+ */
+typedef struct
+{
+    uint64_t lo, hi;    // The 128-bit line hash.
+    long long count;    // Number of times the line occurred.
+    long long offset;   // Byte offset of the first occurrence in its file.
+    long long length;   // Length of the line in bytes (without the newline).
+    int file;           // Index of the input file holding the first occurrence.
+} LineSlot;
+
+/**
+ * @struct LineHasher
+ * @brief Streaming state of the 128-bit hash of one line.
+ */
+typedef struct
+{
+    uint64_t h1, h2;       // The two hash lanes.
+    unsigned char tail[8]; // Bytes not yet folded into the lanes.
+    int tail_len;
+} LineHasher;
+
+/**
+ * @struct LineHashStats
+ * @brief The line-hash set and the streaming hash state of the current line.
+ */
+typedef struct
+{
+    LineSlot *slots;     // Open-addressing table; capacity is a power of two.
+    size_t capacity;
+    size_t distinct;     // Occupied slots.
+    long long lines;     // Lines seen in total.
+    int top;             // Number of repeated lines listed in the report.
+
+    // --- Streaming hash state carried between buffers ---
+    int file;             // Index of the input file being scanned.
+    long long position;   // Byte offset of the next byte to be scanned.
+    long long line_start; // Byte offset where the current line began.
+    LineHasher hasher;    // Hash of the current line so far.
+} LineHashStats;
+
+/**
+ * @brief Creates an empty line-hash set.
+ * @param top The number of most repeated lines to list in the report.
+ * @return A pointer to the new LineHashStats, or NULL on failure.
+ */
+LineHashStats *create_line_hash_stats(int top);
+
+/**
+ * @brief Fills in a ScanHook that hashes every scanned line.
+ * @param lh A pointer to the LineHashStats.
+ * @param hook The hook to fill in.
+ */
+void line_hash_scan_hook(LineHashStats *lh, ScanHook *hook);
+
+/**
+ * @brief Hashes the lines in a buffer, continuing the line left open by the
+ *        previous buffer.
+ * @param lh A pointer to the LineHashStats.
+ * @param buf The bytes to process.
+ * @param len The number of bytes in `buf`.
+ */
+void scan_line_hashes(LineHashStats *lh, const char *buf, size_t len);
+
+/**
+ * @brief Records a final line that was not terminated by a newline and moves
+ *        on to the next input file.
+ * @param lh A pointer to the LineHashStats.
+ */
+void finish_line_hashes(LineHashStats *lh);
+
+/**
+ * @brief Prints the unique/repeated line summary and the most repeated lines.
+ * The text of each listed line is read back from the file it first occurred
+ * in; lines that cannot be read back (standard input, or a file that has
+ * since changed) are shown by their hash instead.
+ * @param lh A pointer to the LineHashStats.
+ * @param filenames The analyzed files in order ("-" for standard input).
+ * @param file_count The number of entries in `filenames`.
+ * @param output_stream The stream to write to.
+ */
+void print_line_hash_stats(const LineHashStats *lh, const char *const *filenames, int file_count,
+                           FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with a LineHashStats object.
+ * @param lh A pointer to the LineHashStats to be freed.
+ */
+void free_line_hash_stats(LineHashStats *lh);
+
+#endif // LINEHASH_H
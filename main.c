@@ -15,11 +15,51 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <unistd.h>
 #include "analyzer.h"
+#include "window.h"
+#include "follow.h"
+#include "pattern.h"
+#include "keyword.h"
+#include "delim.h"
+#include "jsonl.h"
+#include "linehash.h"
+#include "extsort.h"
+#include "cooccur.h"
+#include "tfidf.h"
+#include "entropy.h"
+#include "sample.h"
+#include "fastcount.h"
+#include "outbuf.h"
+#include "wordtable.h"
+#include "vocab.h"
+#include "results.h"
+#include "cache.h"
+#include "dedup.h"
+#include "parallel.h"
+#include "dist.h"
 
 // The default size of the hash table.
 #define HASH_TABLE_SIZE 4096
 
+// The number of most frequent values listed per JSON key.
+#define JSON_TOP_VALUES 10
+
+// The number of most repeated lines listed by --unique-lines.
+#define REPEATED_LINES_TOP 10
+
+// The default memory budget for exact counting, in megabytes.
+#define DEFAULT_MEM_LIMIT_MB 256
+
+// The number of most frequent word pairs listed by --cooc.
+#define COOC_TOP 20
+
+// The number of top terms listed per file (and overall) by --tfidf.
+#define TFIDF_TOP 10
+
+// The maximum number of optional modules observing the scan loop at once.
+#define MAX_SCAN_HOOKS 16
+
 /**
  * @struct AnalysisOptions
  * @brief A container for command-line options to control program behavior.
@@ -30,12 +70,110 @@ typedef struct
     bool show_char_freq;
     bool show_word_freq;
     char *output_filename;
+    WindowMode window_mode;  // How windows are measured (when window_size > 0).
+    long long window_size;   // Lines or seconds per window; 0 disables windows.
+    int window_span;         // Number of windows in the sliding aggregate.
+    int window_top;          // Number of new/gone words listed per window.
+    bool follow;             // Keep reading the file as it grows (like `tail -f`).
+    int follow_interval;     // Seconds between reports in follow mode.
+    const char *patterns[MAX_PATTERNS]; // Regular expressions to count (--pattern).
+    int pattern_count;
+    char **keywords;         // Fixed strings to count (--keyword, --keywords).
+    int keyword_count;
+    char delimiter;          // Field separator for delimited mode; '\0' disables it.
+    bool csv_quoting;        // Honour CSV double-quote rules in delimited mode.
+    bool has_header;         // The first row of delimited input names the columns.
+    const char *json_keys[MAX_JSON_KEYS]; // Top-level keys to profile in JSON-lines input.
+    int json_key_count;
+    bool unique_lines;       // Count distinct and repeated lines.
+    bool exact_words;        // Exact distinct-word counts by external sort.
+    bool exact_lines;        // Exact distinct-line counts by external sort.
+    long long mem_limit_mb;  // Memory budget for exact counting.
+    const char *tmpdir;      // Directory for external-sort run files.
+    int cooc_window;         // Co-occurrence window in tokens; 0 disables it.
+    long long cooc_min;      // Minimum pair count kept when pruning the pair table.
+    bool tfidf;              // Document frequency and per-file TF-IDF terms.
+    bool entropy;            // Byte entropy, block profile and compressibility.
+    BinaryPolicy binary_policy; // What to do with inputs that look binary.
+    double sample_fraction;  // Share of each file to read with --sample; 0 reads everything.
+    bool count_chars;        // Totals selected by --totals (-c, -w and -l select all three).
+    bool count_words;
+    bool count_lines;
+    int threads;             // Threads for counting and formatting; 0 uses every online CPU.
+    TableFormat format;      // TABLE_CSV writes only the word table, as CSV.
+    WordFilter word_filter;  // Which words the word table lists.
+    const char *save_vocab;  // Where to save the vocabulary trie, or NULL.
+    const char *query_prefix; // Query a saved vocabulary for words with this prefix.
+    const char *query_fuzzy; // Query a saved vocabulary for words close to this one.
+    int query_distance;      // Edit distance allowed by the fuzzy query.
+    const char *save_results; // Where to save the results for --diff, or NULL.
+    bool diff;               // Compare two saved results instead of analyzing.
+    bool diff_relative;      // Rank the --diff changes by relative size.
+    const char *cache_dir;   // Per-file result cache directory, or NULL.
+    bool cache_verify;       // Also match cache entries against a hash of the contents.
+    bool dedup;              // Analyze repeated content-defined chunks only once.
+    int procs;               // Worker processes for --procs; 0 analyzes in this process.
+    const char **input_files; // The files to analyze, in order.
+    int input_count;
 } AnalysisOptions;
 
+/**
+ * @struct AnalysisModules
+ * @brief The optional analysis modules enabled by the command line.
+ *
+ * Every member is NULL unless the corresponding option was given. Modules
+ * observe the scan loop through the hooks array.
+ */
+typedef struct
+{
+    WindowStats *windows;
+    PatternSet *patterns;
+    KeywordSet *keywords;
+    DelimStats *columns;
+    JsonlStats *json;
+    LineHashStats *lines;
+    ExtSort *exact_words;
+    ExtSort *exact_lines;
+    CooccurStats *cooccur;
+    TfidfStats *tfidf;
+    EntropyStats *entropy;
+    SampleEstimate *sample;
+    ScanHook hooks[MAX_SCAN_HOOKS];
+} AnalysisModules;
+
+/**
+ * @struct FollowContext
+ * @brief Everything the follow-mode callback needs to emit periodic reports.
+ */
+typedef struct
+{
+    const AppStats *stats;
+    const AnalysisOptions *options;
+    const AnalysisModules *modules;
+    FILE **output_stream;
+    bool show_report;
+    int status; // -1 once a report could not be written.
+} FollowContext;
+
 // --- Function Prototypes ---
-void print_report(const AppStats *stats, const AnalysisOptions *options, FILE *output_stream);
-void print_char_frequency(int counts[], FILE *output_stream);
+int print_report(const AppStats *stats, const AnalysisOptions *options,
+                 const AnalysisModules *modules, FILE *output_stream);
+void print_char_frequency(int counts[], OutBuf *out);
 static void print_usage(const char *prog_name);
+static void print_report_title(const char *filename, const AnalysisOptions *options,
+                               OutBuf *out);
+static bool totals_only(const AnalysisOptions *options, const AppStats *stats,
+                        const AnalysisModules *modules);
+static int count_totals_fast(AppStats *stats, const AnalysisOptions *options, FILE *output_stream);
+static int thread_count(const AnalysisOptions *options);
+static int query_vocabulary(const AnalysisOptions *options);
+static int save_vocabulary(const AppStats *stats, const char *path);
+static int diff_results(const AnalysisOptions *options);
+static bool parse_count(const char *option, const char *text, long long *value);
+static void on_follow_tick(void *ctx, time_t now, int report);
+static bool setup_modules(AnalysisModules *modules, const AnalysisOptions *options,
+                          AppStats *stats, FILE *output_stream);
+static void free_modules(AnalysisModules *modules);
 
 int main(int argc, char *argv[])
 {
@@ -46,9 +184,21 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    AnalysisOptions options = {false, false, false, NULL};
+    // Members not named here start out as zero, false or NULL: off.
+    AnalysisOptions options = {
+        .window_mode = WINDOW_BY_LINES,
+        .window_span = 10,
+        .window_top = 5,
+        .follow_interval = 10,
+        .mem_limit_mb = DEFAULT_MEM_LIMIT_MB,
+        .cooc_min = 1,
+        .binary_policy = BINARY_SCAN,
+        .format = TABLE_TEXT,
+        .query_distance = 1,
+    };
     bool any_option_set = false;
-    char *input_filename = NULL;
+    const char *input_files[argc]; // Every non-option argument is an input file.
+    options.input_files = input_files;
 
     for (int i = 1; i < argc; i++)
     {
@@ -56,6 +206,22 @@ int main(int argc, char *argv[])
 
         if (strcmp(arg, "-c") == 0 || strcmp(arg, "-w") == 0 || strcmp(arg, "-l") == 0)
         {
+            // Any of the three shows all three totals, as it always has.
+            options.count_chars = options.count_words = options.count_lines = true;
+            options.show_overall_stats = true;
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--totals") == 0)
+        {
+            const char *which = (i + 1 < argc) ? argv[++i] : "";
+            options.count_chars = strchr(which, 'c') != NULL;
+            options.count_words = strchr(which, 'w') != NULL;
+            options.count_lines = strchr(which, 'l') != NULL;
+            if (*which == '\0' || strspn(which, "cwl") != strlen(which))
+            {
+                fprintf(stderr, "Error: --totals expects some of the letters 'c', 'w' and 'l'.\n");
+                return EXIT_FAILURE;
+            }
             options.show_overall_stats = true;
             any_option_set = true;
         }
@@ -78,7 +244,367 @@ int main(int argc, char *argv[])
                 return EXIT_FAILURE;
             }
         }
-        else if (arg[0] == '-')
+        else if (strcmp(arg, "--pattern") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: --pattern option requires a regular expression.\n");
+                return EXIT_FAILURE;
+            }
+            if (options.pattern_count == MAX_PATTERNS)
+            {
+                fprintf(stderr, "Error: At most %d patterns are supported.\n", MAX_PATTERNS);
+                return EXIT_FAILURE;
+            }
+            options.patterns[options.pattern_count++] = argv[++i];
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--keyword") == 0 || strcmp(arg, "--keywords") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: %s option requires an argument.\n", arg);
+                return EXIT_FAILURE;
+            }
+            i++; // Consume the keyword or file name.
+            int rc = (arg[9] == 's') ? load_keywords(argv[i], &options.keywords, &options.keyword_count)
+                                     : add_keyword(&options.keywords, &options.keyword_count, argv[i]);
+            if (rc != 0)
+            {
+                fprintf(stderr, "Error: Could not read keywords.\n");
+                return EXIT_FAILURE;
+            }
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--delim") == 0)
+        {
+            const char *kind = (i + 1 < argc) ? argv[++i] : "";
+            if (strcmp(kind, "tsv") == 0)
+            {
+                options.delimiter = '\t';
+            }
+            else if (strcmp(kind, "csv") == 0)
+            {
+                options.delimiter = ',';
+                options.csv_quoting = true;
+            }
+            else if (strlen(kind) == 1)
+            {
+                options.delimiter = kind[0];
+            }
+            else
+            {
+                fprintf(stderr, "Error: --delim expects 'tsv', 'csv' or a single character.\n");
+                return EXIT_FAILURE;
+            }
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--header") == 0)
+        {
+            options.has_header = true;
+        }
+        else if (strcmp(arg, "--json-key") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: --json-key option requires a key name.\n");
+                return EXIT_FAILURE;
+            }
+            if (options.json_key_count == MAX_JSON_KEYS)
+            {
+                fprintf(stderr, "Error: At most %d JSON keys are supported.\n", MAX_JSON_KEYS);
+                return EXIT_FAILURE;
+            }
+            options.json_keys[options.json_key_count++] = argv[++i];
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--unique-lines") == 0)
+        {
+            options.unique_lines = true;
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--exact") == 0)
+        {
+            const char *kind = (i + 1 < argc) ? argv[++i] : "";
+            if (strcmp(kind, "words") == 0 || strcmp(kind, "all") == 0)
+            {
+                options.exact_words = true;
+            }
+            if (strcmp(kind, "lines") == 0 || strcmp(kind, "all") == 0)
+            {
+                options.exact_lines = true;
+            }
+            if (!options.exact_words && !options.exact_lines)
+            {
+                fprintf(stderr, "Error: --exact expects 'words', 'lines' or 'all'.\n");
+                return EXIT_FAILURE;
+            }
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--mem-limit") == 0)
+        {
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &options.mem_limit_mb))
+            {
+                return EXIT_FAILURE;
+            }
+            i++; // Consume the option's value.
+        }
+        else if (strcmp(arg, "--tmpdir") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: --tmpdir option requires a directory.\n");
+                return EXIT_FAILURE;
+            }
+            options.tmpdir = argv[++i];
+        }
+        else if (strcmp(arg, "--cooc") == 0)
+        {
+            long long value;
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &value))
+            {
+                return EXIT_FAILURE;
+            }
+            if (value > MAX_COOC_WINDOW)
+            {
+                fprintf(stderr, "Error: --cooc window is limited to %d tokens.\n", MAX_COOC_WINDOW);
+                return EXIT_FAILURE;
+            }
+            options.cooc_window = (int)value;
+            any_option_set = true;
+            i++; // Consume the option's value.
+        }
+        else if (strcmp(arg, "--cooc-min") == 0)
+        {
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &options.cooc_min))
+            {
+                return EXIT_FAILURE;
+            }
+            i++; // Consume the option's value.
+        }
+        else if (strcmp(arg, "--tfidf") == 0)
+        {
+            options.tfidf = true;
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--entropy") == 0)
+        {
+            options.entropy = true;
+            any_option_set = true;
+        }
+        else if (strcmp(arg, "--binary") == 0)
+        {
+            const char *policy = (i + 1 < argc) ? argv[++i] : "";
+            if (strcmp(policy, "skip") == 0)
+            {
+                options.binary_policy = BINARY_SKIP;
+            }
+            else if (strcmp(policy, "sample") == 0)
+            {
+                options.binary_policy = BINARY_SAMPLE;
+            }
+            else if (strcmp(policy, "scan") == 0)
+            {
+                options.binary_policy = BINARY_SCAN;
+            }
+            else
+            {
+                fprintf(stderr, "Error: --binary expects 'skip', 'sample' or 'scan'.\n");
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(arg, "--sample") == 0)
+        {
+            char *end;
+            const char *text = (i + 1 < argc) ? argv[++i] : "";
+            double percent = strtod(text, &end);
+            if (*text == '\0' || *end != '\0' || !(percent > 0.0 && percent < 100.0))
+            {
+                fprintf(stderr, "Error: --sample expects a percentage between 0 and 100.\n");
+                return EXIT_FAILURE;
+            }
+            options.sample_fraction = percent / 100.0;
+        }
+        else if (strcmp(arg, "--threads") == 0)
+        {
+            long long value;
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &value))
+            {
+                return EXIT_FAILURE;
+            }
+            options.threads = (int)value;
+            i++; // Consume the option's value.
+        }
+        else if (strcmp(arg, "--procs") == 0)
+        {
+            long long value;
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &value))
+            {
+                return EXIT_FAILURE;
+            }
+            options.procs = (int)value;
+            i++; // Consume the option's value.
+        }
+        else if (strcmp(arg, "--format") == 0)
+        {
+            const char *format = (i + 1 < argc) ? argv[++i] : "";
+            if (strcmp(format, "csv") == 0)
+            {
+                options.format = TABLE_CSV;
+                options.show_word_freq = true;
+                any_option_set = true;
+            }
+            else if (strcmp(format, "text") != 0)
+            {
+                fprintf(stderr, "Error: --format expects 'text' or 'csv'.\n");
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(arg, "--min-count") == 0 || strcmp(arg, "--min-len") == 0 ||
+                 strcmp(arg, "--max-len") == 0 || strcmp(arg, "--top") == 0)
+        {
+            long long value;
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &value))
+            {
+                return EXIT_FAILURE;
+            }
+            i++; // Consume the option's value.
+
+            WordFilter *filter = &options.word_filter;
+            int *field = strcmp(arg, "--min-count") == 0 ? &filter->min_count
+                         : strcmp(arg, "--min-len") == 0 ? &filter->min_len
+                         : strcmp(arg, "--max-len") == 0 ? &filter->max_len
+                                                         : &filter->top;
+            *field = (int)value;
+        }
+        else if (strcmp(arg, "--prefix") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: --prefix option requires a prefix.\n");
+                return EXIT_FAILURE;
+            }
+            char *prefix = argv[++i];
+            for (char *p = prefix; *p != '\0'; p++)
+            {
+                *p = (char)tolower((unsigned char)*p); // Frequency words are lower case.
+            }
+            options.word_filter.prefix = prefix;
+        }
+        else if (strcmp(arg, "--save") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: --save option requires a filename.\n");
+                return EXIT_FAILURE;
+            }
+            options.save_results = argv[++i];
+        }
+        else if (strcmp(arg, "--cache") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: --cache option requires a directory.\n");
+                return EXIT_FAILURE;
+            }
+            options.cache_dir = argv[++i];
+        }
+        else if (strcmp(arg, "--cache-verify") == 0)
+        {
+            options.cache_verify = true;
+        }
+        else if (strcmp(arg, "--dedup") == 0)
+        {
+            options.dedup = true;
+        }
+        else if (strcmp(arg, "--diff") == 0)
+        {
+            options.diff = true;
+        }
+        else if (strcmp(arg, "--relative") == 0)
+        {
+            options.diff_relative = true;
+        }
+        else if (strcmp(arg, "--save-vocab") == 0 || strcmp(arg, "--query-prefix") == 0 ||
+                 strcmp(arg, "--query-fuzzy") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                fprintf(stderr, "Error: %s option requires an argument.\n", arg);
+                return EXIT_FAILURE;
+            }
+            char *value = argv[++i];
+            if (arg[2] == 's')
+            {
+                options.save_vocab = value;
+                continue;
+            }
+            for (char *p = value; *p != '\0'; p++)
+            {
+                *p = (char)tolower((unsigned char)*p); // Frequency words are lower case.
+            }
+            if (arg[8] == 'p')
+            {
+                options.query_prefix = value;
+            }
+            else
+            {
+                options.query_fuzzy = value;
+            }
+        }
+        else if (strcmp(arg, "--distance") == 0)
+        {
+            // Unlike the counts, 0 is allowed: it looks a word up exactly.
+            char *end;
+            const char *text = (i + 1 < argc) ? argv[++i] : "";
+            long distance = strtol(text, &end, 10);
+            if (*text == '\0' || *end != '\0' || distance < 0 || distance >= MAX_WORD_LEN)
+            {
+                fprintf(stderr, "Error: --distance expects a number between 0 and %d.\n",
+                        MAX_WORD_LEN - 1);
+                return EXIT_FAILURE;
+            }
+            options.query_distance = (int)distance;
+        }
+        else if (strcmp(arg, "--follow") == 0)
+        {
+            options.follow = true;
+        }
+        else if (strcmp(arg, "--interval") == 0)
+        {
+            long long value;
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &value))
+            {
+                return EXIT_FAILURE;
+            }
+            options.follow_interval = (int)value;
+            i++; // Consume the option's value.
+        }
+        else if (strcmp(arg, "--window-lines") == 0 || strcmp(arg, "--window-secs") == 0 ||
+                 strcmp(arg, "--window-span") == 0 || strcmp(arg, "--window-top") == 0)
+        {
+            long long value;
+            if (!parse_count(arg, i + 1 < argc ? argv[i + 1] : NULL, &value))
+            {
+                return EXIT_FAILURE;
+            }
+            i++; // Consume the option's value.
+
+            if (strcmp(arg, "--window-lines") == 0 || strcmp(arg, "--window-secs") == 0)
+            {
+                options.window_mode = (arg[9] == 'l') ? WINDOW_BY_LINES : WINDOW_BY_SECONDS;
+                options.window_size = value;
+            }
+            else if (strcmp(arg, "--window-span") == 0)
+            {
+                options.window_span = (int)value;
+            }
+            else
+            {
+                options.window_top = (int)value;
+            }
+        }
+        else if (arg[0] == '-' && arg[1] != '\0')
         {
             fprintf(stderr, "Error: Unknown option '%s'\n", arg);
             print_usage(argv[0]);
@@ -86,22 +612,60 @@ int main(int argc, char *argv[])
         }
         else
         {
-            if (input_filename != NULL)
-            {
-                fprintf(stderr, "Error: Multiple input filenames provided. Please specify only one.\n");
-                return EXIT_FAILURE;
-            }
-            input_filename = arg;
+            input_files[options.input_count++] = arg;
         }
     }
 
-    if (input_filename == NULL)
+    if (options.input_count == 0)
     {
         fprintf(stderr, "Error: No input filename specified.\n");
         return EXIT_FAILURE;
     }
 
+    if (options.follow && (options.input_count > 1 || strcmp(input_files[0], "-") == 0))
+    {
+        fprintf(stderr, "Error: --follow needs a single file name, not standard input.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (options.query_prefix != NULL || options.query_fuzzy != NULL)
+    {
+        // Query mode: the input is a saved vocabulary, not text.
+        if (options.input_count != 1)
+        {
+            fprintf(stderr, "Error: Vocabulary queries take a single saved vocabulary file.\n");
+            return EXIT_FAILURE;
+        }
+        return query_vocabulary(&options) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (options.diff)
+    {
+        // Diff mode: the inputs are two saved results, not text.
+        if (options.input_count != 2)
+        {
+            fprintf(stderr, "Error: --diff takes two results files saved with --save.\n");
+            return EXIT_FAILURE;
+        }
+        return diff_results(&options) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (options.cache_dir != NULL && access(options.cache_dir, W_OK | X_OK) != 0)
+    {
+        perror("Error opening cache directory");
+        return EXIT_FAILURE;
+    }
+
+    if (options.follow && options.sample_fraction > 0.0)
+    {
+        fprintf(stderr, "Error: --sample cannot be combined with --follow.\n");
+        return EXIT_FAILURE;
+    }
+
     // If the user did not specify any display options, default to showing everything.
+    // In windowed mode the per-window summaries are the report unless a
+    // display option explicitly asks for the global one as well.
+    bool show_report = any_option_set || options.window_size == 0;
     if (!any_option_set)
     {
         options.show_overall_stats = true;
@@ -120,19 +684,14 @@ int main(int argc, char *argv[])
     int main_char_freq[256] = {0}; // Stack-allocated, no free needed.
 
     AppStats stats = {0};
-    stats.filename = input_filename;
+    stats.filename = input_files[0];
     stats.char_freq = main_char_freq;
     stats.word_counts = word_counts;
+    stats.binary_policy = options.binary_policy;
 
-    // --- 3. Delegate to Analysis Engine ---
-    if (analyze_file(&stats) != 0)
-    {
-        fprintf(stderr, "Analysis failed for file: %s\n", input_filename);
-        free_hash_table(stats.word_counts); // CRITICAL: Cleanup on error path.
-        return EXIT_FAILURE;
-    }
-
-    // --- 4. Prepare Output Stream and Generate Report ---
+    // --- 3. Prepare Output Stream ---
+    // The output is opened before the analysis because windowed mode writes
+    // its summaries while the input is still being read.
     FILE *output_stream = stdout;
     if (options.output_filename != NULL)
     {
@@ -145,78 +704,518 @@ int main(int argc, char *argv[])
         }
     }
 
-    print_report(&stats, &options, output_stream);
-
-    // --- 5. Final Cleanup ---
-    if (output_stream != stdout)
+    AnalysisModules modules;
+    if (!setup_modules(&modules, &options, &stats, output_stream))
     {
-        fclose(output_stream);
+        if (output_stream != stdout)
+        {
+            fclose(output_stream);
+        }
+        free_hash_table(stats.word_counts);
+        return EXIT_FAILURE;
     }
 
-    free_hash_table(stats.word_counts); // The primary cleanup for the success path.
-
-    return EXIT_SUCCESS;
-}
-
-/**
- * @brief Prints the final, formatted analysis report to the given stream.
+    // --- 4. Delegate to Analysis Engine and Generate Report ---
+    int status;
+    FollowContext follow_ctx = {&stats, &options, &modules, &output_stream, show_report, 0};
+    bool fast_totals = totals_only(&options, &stats, &modules);
+    if (fast_totals)
+    {
+        // Nothing but totals of bytes, words and lines: no scan loop is needed.
+        status = count_totals_fast(&stats, &options, output_stream);
+    }
+    else if (options.follow)
+    {
+        status = follow_file(&stats, options.follow_interval, on_follow_tick, &follow_ctx);
+    }
+    else
+    {
+        // Every file is scanned in turn into the same statistics; modules
+        // that care about file boundaries see each one through on_finish.
+        status = 0;
+        // The cache, dedup, parallel and distributed modes add up the results of separate
+        // pieces, so they only apply when no module needs to see the text in order.
+        bool mergeable = stats.hook_count == 0 && modules.sample == NULL;
+        bool use_cache = options.cache_dir != NULL && mergeable;
+        ChunkCache *chunks = NULL;
+        if (options.dedup && mergeable)
+        {
+            chunks = create_chunk_cache((size_t)options.mem_limit_mb << 20);
+        }
+        CacheStats cache_counts = {0, 0, 0};
+        bool distributed = options.procs > 0 && mergeable && !use_cache && chunks == NULL;
+        if (distributed)
+        {
+            status = distributed_analyze(&stats, input_files, options.input_count, options.procs);
+        }
+        for (int f = 0; f < options.input_count && status == 0 && !distributed; f++)
+        {
+            stats.filename = input_files[f];
+            status = modules.sample != NULL ? sample_file(&stats, modules.sample)
+                     : use_cache ? cached_analyze_file(&stats, options.cache_dir,
+                                                       options.cache_verify, chunks, &cache_counts)
+                     : chunks != NULL ? dedup_analyze_file(&stats, chunks)
+                     : mergeable      ? parallel_analyze_file(&stats, thread_count(&options))
+                                      : analyze_file(&stats);
+        }
+        if ((options.cache_dir != NULL || options.dedup || options.procs > 0) && !mergeable)
+        {
+            fprintf(stderr, "Note: --cache, --dedup and --procs only apply to the core statistics; "
+                            "every file was read in full.\n");
+        }
+        else if (options.procs > 0 && !distributed)
+        {
+            fprintf(stderr, "Note: --procs does not combine with --cache or --dedup; "
+                            "the files were read in this process.\n");
+        }
+        if (chunks != NULL && status == 0)
+        {
+            const DedupStats *dedup = chunk_cache_stats(chunks);
+            fprintf(stderr, "Dedup: %lld of %lld chunks (%lld of %lld bytes) reused.\n",
+                    dedup->reused, dedup->chunks, dedup->reused_bytes, dedup->bytes);
+        }
+        free_chunk_cache(chunks);
+        if (use_cache && status == 0)
+        {
+            fprintf(stderr, "Cache: %d hit%s, %d miss%s, %d not cacheable.\n", cache_counts.hits,
+                    cache_counts.hits == 1 ? "" : "s", cache_counts.misses,
+                    cache_counts.misses == 1 ? "" : "es", cache_counts.bypassed);
+        }
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Analysis failed for file: %s\n", stats.filename);
+    }
+    else if (!fast_totals)
+    {
+        if (modules.exact_words != NULL)
+        {
+            finish_ext_sort(modules.exact_words);
+        }
+        if (modules.exact_lines != NULL)
+        {
+            finish_ext_sort(modules.exact_lines);
+        }
+        if (modules.windows != NULL)
+        {
+            if (window_finish(modules.windows) != 0)
+            {
+                status = -1;
+            }
+        }
+        if (options.follow)
+        {
+            on_follow_tick(&follow_ctx, time(NULL), 1); // The final, complete report.
+            if (follow_ctx.status != 0)
+            {
+                status = -1;
+            }
+        }
+        else if (show_report && print_report(&stats, &options, &modules, output_stream) != 0)
+        {
+            status = -1;
+        }
+        if (options.save_vocab != NULL && save_vocabulary(&stats, options.save_vocab) != 0)
+        {
+            status = -1;
+        }
+        if (options.save_results != NULL && save_results(&stats, options.save_results) != 0)
+        {
+            status = -1;
+        }
+    }
+
+    if (status == 0 && options.binary_policy == BINARY_SKIP &&
+        stats.binary_files >= options.input_count)
+    {
+        // An empty report with a success status would hide that nothing was read.
+        fprintf(stderr, "Error: every input looked binary and was skipped (see --binary).\n");
+        status = -1;
+    }
+
+    // --- 5. Final Cleanup ---
+    if (output_stream != stdout)
+    {
+        fclose(output_stream);
+    }
+
+    free_modules(&modules);
+    free_keywords(options.keywords, options.keyword_count);
+    free_hash_table(stats.word_counts); // The primary cleanup for every path from here on.
+
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Prints the report heading: the file name, or the number of files.
+ */
+static void print_report_title(const char *filename, const AnalysisOptions *options,
+                               OutBuf *out)
+{
+    out_str(out, "--- Analysis Report for ");
+    if (options->input_count > 1)
+    {
+        out_int(out, options->input_count, 0);
+        out_str(out, " files");
+    }
+    else
+    {
+        out_str(out, filename);
+    }
+    out_str(out, " ---\n\n");
+}
+
+/**
+ * @brief Returns true if the request is only for -c/-w/-l totals, which
+ *        the parallel counter answers without the scan loop.
+ */
+static bool totals_only(const AnalysisOptions *options, const AppStats *stats,
+                        const AnalysisModules *modules)
+{
+    return (options->count_chars || options->count_words || options->count_lines) &&
+           !options->show_char_freq && !options->show_word_freq && stats->hook_count == 0 &&
+           modules->sample == NULL && !options->follow && options->save_vocab == NULL &&
+           options->save_results == NULL && options->cache_dir == NULL &&
+           !options->dedup;
+}
+
+/**
+ * @brief Returns the number of threads to use: --threads, or every online CPU.
+ */
+static int thread_count(const AnalysisOptions *options)
+{
+    if (options->threads > 0)
+    {
+        return options->threads;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (int)online : 1;
+}
+
+/**
+ * @brief Saves the vocabulary of the analysis as a trie.
+ * @return 0 on success, -1 on failure.
+ */
+static int save_vocabulary(const AppStats *stats, const char *path)
+{
+    VocabTrie *trie = build_vocab_trie(stats->word_counts);
+    if (trie == NULL)
+    {
+        fprintf(stderr, "Error: Could not build the vocabulary trie.\n");
+        return -1;
+    }
+    int status = save_vocab_trie(trie, path);
+    free_vocab_trie(trie);
+    return status;
+}
+
+/**
+ * @brief Runs the prefix and fuzzy queries against a saved vocabulary.
+ * @return 0 on success, -1 on failure.
+ */
+static int query_vocabulary(const AnalysisOptions *options)
+{
+    VocabTrie *trie = load_vocab_trie(options->input_files[0]);
+    if (trie == NULL)
+    {
+        return -1;
+    }
+    FILE *output_stream = stdout;
+    if (options->output_filename != NULL)
+    {
+        output_stream = fopen(options->output_filename, "w");
+        if (output_stream == NULL)
+        {
+            perror("Error opening output file");
+            free_vocab_trie(trie);
+            return -1;
+        }
+    }
+
+    fprintf(output_stream, "--- Vocabulary Query on %s (%u words) ---\n", options->input_files[0],
+            trie->word_count);
+    if (options->query_prefix != NULL)
+    {
+        fprintf(output_stream, "\nWords starting with \"%s\":\n", options->query_prefix);
+        fprintf(output_stream, "  %-20s %s\n", "Word", "Count");
+        fprintf(output_stream, "  %-20s %s\n", "--------------------", "-----");
+        long long found = query_vocab_prefix(trie, options->query_prefix, output_stream);
+        fprintf(output_stream, "%lld word%s\n", found, found == 1 ? "" : "s");
+    }
+    if (options->query_fuzzy != NULL)
+    {
+        fprintf(output_stream, "\nWords within distance %d of \"%s\":\n", options->query_distance,
+                options->query_fuzzy);
+        fprintf(output_stream, "  %-20s %-8s %s\n", "Word", "Count", "Distance");
+        fprintf(output_stream, "  %-20s %-8s %s\n", "--------------------", "-----", "--------");
+        long long found = query_vocab_fuzzy(trie, options->query_fuzzy, options->query_distance,
+                                            output_stream);
+        fprintf(output_stream, "%lld word%s\n", found, found == 1 ? "" : "s");
+    }
+
+    if (output_stream != stdout)
+    {
+        fclose(output_stream);
+    }
+    free_vocab_trie(trie);
+    return 0;
+}
+
+/**
+ * @brief Compares the two saved results named as inputs.
+ * @return 0 on success, -1 on failure.
+ */
+static int diff_results(const AnalysisOptions *options)
+{
+    Results *before = load_results(options->input_files[0]);
+    Results *after = before != NULL ? load_results(options->input_files[1]) : NULL;
+    if (after == NULL)
+    {
+        free_results(before);
+        return -1;
+    }
+    FILE *output_stream = stdout;
+    if (options->output_filename != NULL)
+    {
+        output_stream = fopen(options->output_filename, "w");
+        if (output_stream == NULL)
+        {
+            perror("Error opening output file");
+            free_results(before);
+            free_results(after);
+            return -1;
+        }
+    }
+
+    DiffOptions diff;
+    diff.top = options->word_filter.top > 0 ? options->word_filter.top : 20;
+    diff.relative = options->diff_relative;
+    diff.min_count = options->word_filter.min_count;
+    fprintf(output_stream, "--- Results Diff: %s -> %s ---\n\n", options->input_files[0],
+            options->input_files[1]);
+    print_results_diff(before, after, &diff, output_stream);
+
+    if (output_stream != stdout)
+    {
+        fclose(output_stream);
+    }
+    free_results(before);
+    free_results(after);
+    return 0;
+}
+
+/**
+ * @brief Counts every input with the parallel counter and prints the
+ *        selected totals.
+ * @return 0 on success, -1 if an input could not be read; stats->filename
+ *         then names it.
+ */
+static int count_totals_fast(AppStats *stats, const AnalysisOptions *options, FILE *output_stream)
+{
+    int threads = thread_count(options);
+    FastCounts counts = {0};
+    for (int f = 0; f < options->input_count; f++)
+    {
+        stats->filename = options->input_files[f];
+        if (fast_count_file(stats->filename, threads, stats->binary_policy, options->count_words,
+                            &counts) != 0)
+        {
+            return -1;
+        }
+    }
+    stats->binary_files = counts.binary_files;
+
+    OutBuf out;
+    fflush(output_stream);
+    outbuf_init(&out, fileno(output_stream));
+    print_report_title(options->input_files[0], options, &out);
+    out_str(&out, "Overall Statistics:\n");
+    if (options->count_chars)
+    {
+        out_str(&out, "Total Characters:\t");
+        out_int(&out, counts.bytes, 0);
+        out_str(&out, "\n");
+    }
+    if (options->count_words)
+    {
+        out_str(&out, "Total Words:\t\t");
+        out_int(&out, counts.words, 0);
+        out_str(&out, "\n");
+    }
+    if (options->count_lines)
+    {
+        out_str(&out, "Total Lines:\t\t");
+        out_int(&out, counts.lines, 0);
+        out_str(&out, "\n");
+    }
+    out_str(&out, "\n");
+    return outbuf_finish(&out);
+}
+
+/**
+ * @brief Prints the final, formatted analysis report to the given stream.
  * The function is controlled by the options struct to display only the
  * requested sections of the report.
  * @param stats A pointer to the populated AppStats struct containing all data.
  * @param options A pointer to the AnalysisOptions struct with user choices.
+ * @param modules A pointer to the optional modules whose results are included.
  * @param output_stream The stream (stdout or a file) to write the report to.
+ * @return 0 on success, -1 if the report could not be written.
+ *
+ * The core sections, which can run to one row per distinct word, are
+ * formatted into an OutBuf and written with writev(), the word table by
+ * several threads when it is large; the module sections that follow are
+ * short and still go through stdio. With --format csv only the word table
+ * is written.
  */
-void print_report(const AppStats *stats, const AnalysisOptions *options, FILE *output_stream)
+int print_report(const AppStats *stats, const AnalysisOptions *options,
+                 const AnalysisModules *modules, FILE *output_stream)
 {
-    fprintf(output_stream, "--- Analysis Report for %s ---\n\n", stats->filename);
+    OutBuf out;
+    fflush(output_stream); // Earlier stdio output (window summaries) goes first.
+    outbuf_init(&out, fileno(output_stream));
 
-    if (options->show_overall_stats)
+    if (options->format == TABLE_CSV)
     {
-        fprintf(output_stream, "Overall Statistics:\n");
-        fprintf(output_stream, "Total Characters:\t%lld\n", stats->char_count);
-        fprintf(output_stream, "Total Words:\t\t%d\n", stats->word_count);
-        fprintf(output_stream, "Total Lines:\t\t%d\n\n", stats->line_count);
+        // A CSV file holds one table: the word counts.
+        write_word_table(stats->word_counts, TABLE_CSV, &options->word_filter,
+                         thread_count(options), &out);
+        return outbuf_finish(&out);
+    }
+
+    print_report_title(stats->filename, options, &out);
+    bool all_counts = !options->count_chars && !options->count_words && !options->count_lines;
+
+    if (options->show_overall_stats && modules->sample != NULL)
+    {
+        print_sample_estimate(modules->sample, &out);
+    }
+    else if (options->show_overall_stats)
+    {
+        out_str(&out, "Overall Statistics:\n");
+        if (all_counts || options->count_chars)
+        {
+            out_str(&out, "Total Characters:\t");
+            out_int(&out, stats->char_count, 0);
+            out_str(&out, "\n");
+        }
+        if (all_counts || options->count_words)
+        {
+            out_str(&out, "Total Words:\t\t");
+            out_int(&out, stats->word_count, 0);
+            out_str(&out, "\n");
+        }
+        if (all_counts || options->count_lines)
+        {
+            out_str(&out, "Total Lines:\t\t");
+            out_int(&out, stats->line_count, 0);
+            out_str(&out, "\n");
+        }
+        out_str(&out, "\n");
     }
 
     if (options->show_char_freq)
     {
-        fprintf(output_stream, "Character Frequency:\n");
-        print_char_frequency(stats->char_freq, output_stream);
-        fprintf(output_stream, "\n");
+        out_str(&out, modules->sample != NULL ? "Character Frequency (in the sample):\n"
+                                              : "Character Frequency:\n");
+        print_char_frequency(stats->char_freq, &out);
+        out_str(&out, "\n");
     }
 
     if (options->show_word_freq)
     {
-        fprintf(output_stream, "Word Frequency:\n");
-        fprintf(output_stream, "  %-20s %s\n", "Word", "Count");
-        fprintf(output_stream, "  %-20s %s\n", "--------------------", "-----");
+        out_str(&out, modules->sample != NULL ? "Word Frequency (in the sample):\n"
+                                              : "Word Frequency:\n");
+        out_str(&out, "  Word                 Count\n");
+        out_str(&out, "  -------------------- -----\n");
+        write_word_table(stats->word_counts, TABLE_TEXT, &options->word_filter,
+                         thread_count(options), &out);
+    }
+    int status = outbuf_finish(&out);
 
-        for (int i = 0; i < stats->word_counts->size; i++)
-        {
-            Node *current = stats->word_counts->table[i];
-            while (current != NULL)
-            {
-                fprintf(output_stream, "  %-20s %d\n", current->word, current->count);
-                current = current->next;
-            }
-        }
+    if (modules->patterns != NULL)
+    {
+        fprintf(output_stream, "\nPattern Counts:\n");
+        print_pattern_counts(modules->patterns, output_stream);
+    }
+
+    if (modules->keywords != NULL)
+    {
+        fprintf(output_stream, "\nKeyword Counts:\n");
+        print_keyword_counts(modules->keywords, output_stream);
+    }
+
+    if (modules->columns != NULL)
+    {
+        fprintf(output_stream, "\nColumn Statistics:\n");
+        print_column_stats(modules->columns, output_stream);
+    }
+
+    if (modules->json != NULL)
+    {
+        fprintf(output_stream, "\nJSON Key Statistics:\n");
+        print_json_key_stats(modules->json, output_stream);
+    }
+
+    if (modules->lines != NULL)
+    {
+        fprintf(output_stream, "\nLine Statistics:\n");
+        print_line_hash_stats(modules->lines, options->input_files, options->input_count,
+                              output_stream);
+    }
+
+    if (modules->exact_words != NULL)
+    {
+        fprintf(output_stream, "\nExact Word Counts:\n");
+        print_ext_sort_stats(modules->exact_words, "Words", output_stream);
+    }
+
+    if (modules->exact_lines != NULL)
+    {
+        fprintf(output_stream, "\nExact Line Counts:\n");
+        print_ext_sort_stats(modules->exact_lines, "Lines", output_stream);
+    }
+
+    if (modules->cooccur != NULL)
+    {
+        fprintf(output_stream, "\nWord Co-occurrence:\n");
+        print_cooccur_stats(modules->cooccur, output_stream);
+    }
+
+    if (modules->tfidf != NULL)
+    {
+        fprintf(output_stream, "\nDocument Frequency and TF-IDF:\n");
+        print_tfidf_stats(modules->tfidf, options->input_files, options->input_count,
+                          output_stream);
+    }
+
+    if (modules->entropy != NULL)
+    {
+        fprintf(output_stream, "\nEntropy:\n");
+        print_entropy_stats(modules->entropy, output_stream);
     }
+    return ferror(output_stream) ? -1 : status;
 }
 
 /**
- * @brief Prints the character frequency table to the given stream.
+ * @brief Prints the character frequency table to the report.
  * @param counts The array of character frequency counts.
- * @param output_stream The stream to write to.
+ * @param out The report being written.
  */
-void print_char_frequency(int counts[], FILE *output_stream)
+void print_char_frequency(int counts[], OutBuf *out)
 {
-    fprintf(output_stream, "  %-10s %-10s\n", "Character", "Count");
-    fprintf(output_stream, "  %-10s %-10s\n", "---------", "-----");
+    out_str(out, "  Character  Count     \n");
+    out_str(out, "  ---------  -----     \n");
     for (int i = 0; i < 256; i++)
     {
         if (counts[i] > 0 && isprint(i))
         {
-            fprintf(output_stream, "  %-10c %-10d\n", i, counts[i]);
+            char c = (char)i;
+            out_str(out, "  ");
+            out_bytes(out, &c, 1);
+            out_str(out, "          "); // Pads the character to its 10-wide column.
+            out_int(out, counts[i], -10);
+            out_str(out, "\n");
         }
     }
 }
@@ -227,10 +1226,309 @@ void print_char_frequency(int counts[], FILE *output_stream)
  */
 static void print_usage(const char *prog_name)
 {
-    fprintf(stderr, "Usage: %s [options] <filename>\n", prog_name);
+    fprintf(stderr, "Usage: %s [options] <filename>...\n", prog_name);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -c, -w, -l    Show overall statistics (characters, words, lines).\n");
+    fprintf(stderr, "  --totals <cwl> Show only the chosen totals: c characters, w words, l lines.\n");
     fprintf(stderr, "  --freq          Show character and word frequency tables.\n");
     fprintf(stderr, "  -o <file>       Write the report to <file> instead of the console.\n");
+    fprintf(stderr, "  --pattern <re>  Count matches of a regular expression (repeatable).\n");
+    fprintf(stderr, "  --keyword <w>   Count occurrences of a fixed string (repeatable).\n");
+    fprintf(stderr, "  --keywords <f>  Count occurrences of every line of <f> as a keyword.\n");
+    fprintf(stderr, "  --delim <d>     Profile each column of 'tsv', 'csv' or <d>-separated input.\n");
+    fprintf(stderr, "  --header        The first row of delimited input names the columns.\n");
+    fprintf(stderr, "  --json-key <k>  Profile the values of top-level key <k> in JSON lines (repeatable).\n");
+    fprintf(stderr, "  --unique-lines  Count distinct lines and list the most repeated ones.\n");
+    fprintf(stderr, "  --exact <what>  Exact distinct counts of 'words', 'lines' or 'all' via external sort.\n");
+    fprintf(stderr, "  --mem-limit <mb>  Memory budget for --exact and the --dedup chunk cache (default %d).\n", DEFAULT_MEM_LIMIT_MB);
+    fprintf(stderr, "  --tmpdir <dir>  Directory for --exact run files (default $TMPDIR or /tmp).\n");
+    fprintf(stderr, "  --cooc <k>      Count word pairs that occur within <k> tokens of each other.\n");
+    fprintf(stderr, "  --cooc-min <n>  Prune pairs seen fewer than <n> times when memory runs high.\n");
+    fprintf(stderr, "  --tfidf         Document frequency and top TF-IDF terms, one document per file.\n");
+    fprintf(stderr, "  --entropy       Byte entropy, a per-1MB-block profile and a compressibility estimate.\n");
+    fprintf(stderr, "  --binary <p>    Inputs that look binary: 'skip', 'sample' the first 1 MB, or 'scan' (default).\n");
+    fprintf(stderr, "  --threads <n>   Threads for large files, -c/-w/-l totals and large word tables (default: all CPUs).\n");
+    fprintf(stderr, "  --format <f>    'text' (default) or 'csv': only the word counts, most frequent first.\n");
+    fprintf(stderr, "  --min-count <n>, --min-len <n>, --max-len <n>, --prefix <s>\n");
+    fprintf(stderr, "                  List only matching words in the word table.\n");
+    fprintf(stderr, "  --top <k>       List only the k most frequent (matching) words.\n");
+    fprintf(stderr, "  --save-vocab <f> Save the vocabulary and counts as a trie for later queries.\n");
+    fprintf(stderr, "  --query-prefix <p>, --query-fuzzy <w> [--distance <d>]\n");
+    fprintf(stderr, "                  Query a saved vocabulary (the input file) by prefix or edit distance.\n");
+    fprintf(stderr, "  --save <f>      Save the totals, character counts and vocabulary for --diff.\n");
+    fprintf(stderr, "  --diff          Compare two files saved with --save (the inputs), old first.\n");
+    fprintf(stderr, "  --relative      Rank the --diff changes by relative size (with --top, --min-count).\n");
+    fprintf(stderr, "  --cache <dir>   Reuse the results of files unchanged (inode, size, mtime) since the last run.\n");
+    fprintf(stderr, "  --cache-verify  With --cache, also require a matching hash of the file contents.\n");
+    fprintf(stderr, "  --dedup         Analyze content repeated within or across files only once (content-defined chunks).\n");
+    fprintf(stderr, "  --procs <n>     Split the inputs across n worker processes and merge their results.\n");
+    fprintf(stderr, "  --sample <P>    Read about P%% of each file in evenly spaced blocks and extrapolate the counts.\n");
+    fprintf(stderr, "  --follow        Keep reading the file as it grows, reporting periodically.\n");
+    fprintf(stderr, "  --interval <n>  Seconds between reports in follow mode (default 10).\n");
+    fprintf(stderr, "  --window-lines <n>  Emit statistics for every <n> lines of input.\n");
+    fprintf(stderr, "  --window-secs <n>   Emit statistics for every <n> seconds of input.\n");
+    fprintf(stderr, "  --window-span <k>   Windows in the sliding aggregate (default 10).\n");
+    fprintf(stderr, "  --window-top <t>    New/gone words listed per window (default 5).\n");
+    fprintf(stderr, "Use '-' as the filename to read from standard input.\n");
     fprintf(stderr, "If no options are specified, the full report is shown.\n");
+}
+
+/**
+ * @brief Creates the optional modules requested on the command line and
+ *        registers their scan hooks with the AppStats struct.
+ * @param modules The struct to fill in; every member starts out NULL.
+ * @param options A pointer to the parsed command-line options.
+ * @param stats A pointer to the AppStats struct the modules observe.
+ * @param output_stream The stream modules that report while scanning write to.
+ * @return true on success, false (after printing an error) otherwise.
+ */
+static bool setup_modules(AnalysisModules *modules, const AnalysisOptions *options,
+                          AppStats *stats, FILE *output_stream)
+{
+    memset(modules, 0, sizeof(*modules));
+    stats->hooks = modules->hooks;
+    stats->hook_count = 0;
+
+    if (options->window_size > 0)
+    {
+        modules->windows = create_window_stats(stats, options->window_mode, options->window_size,
+                                               options->window_span, options->window_top,
+                                               output_stream);
+        if (modules->windows == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up windowed statistics.\n");
+            free_modules(modules);
+            return false;
+        }
+        window_scan_hook(modules->windows, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->pattern_count > 0)
+    {
+        modules->patterns = compile_patterns(options->patterns, options->pattern_count);
+        if (modules->patterns == NULL)
+        {
+            free_modules(modules);
+            return false;
+        }
+        pattern_scan_hook(modules->patterns, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->keyword_count > 0)
+    {
+        modules->keywords = create_keyword_set((const char *const *)options->keywords,
+                                               options->keyword_count);
+        if (modules->keywords == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not build the keyword matcher.\n");
+            free_modules(modules);
+            return false;
+        }
+        keyword_scan_hook(modules->keywords, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->delimiter != '\0')
+    {
+        modules->columns = create_delim_stats(options->delimiter, options->csv_quoting,
+                                              options->has_header);
+        if (modules->columns == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up column statistics.\n");
+            free_modules(modules);
+            return false;
+        }
+        delim_scan_hook(modules->columns, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->json_key_count > 0)
+    {
+        modules->json = create_jsonl_stats(options->json_keys, options->json_key_count,
+                                           JSON_TOP_VALUES);
+        if (modules->json == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up JSON key statistics.\n");
+            free_modules(modules);
+            return false;
+        }
+        jsonl_scan_hook(modules->json, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->unique_lines)
+    {
+        modules->lines = create_line_hash_stats(REPEATED_LINES_TOP);
+        if (modules->lines == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up line statistics.\n");
+            free_modules(modules);
+            return false;
+        }
+        line_hash_scan_hook(modules->lines, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->exact_words || options->exact_lines)
+    {
+        // The budget is shared between the two sorters when both are on.
+        size_t budget = (size_t)options->mem_limit_mb << 20;
+        if (options->exact_words && options->exact_lines)
+        {
+            budget /= 2;
+        }
+        const char *tmpdir = options->tmpdir;
+        if (tmpdir == NULL)
+        {
+            tmpdir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+        }
+
+        if (options->exact_words)
+        {
+            modules->exact_words = create_ext_sort(budget, tmpdir);
+            if (modules->exact_words == NULL)
+            {
+                fprintf(stderr, "Fatal: Could not set up exact word counting.\n");
+                free_modules(modules);
+                return false;
+            }
+            ext_sort_word_hook(modules->exact_words, &modules->hooks[stats->hook_count++]);
+        }
+        if (options->exact_lines)
+        {
+            modules->exact_lines = create_ext_sort(budget, tmpdir);
+            if (modules->exact_lines == NULL)
+            {
+                fprintf(stderr, "Fatal: Could not set up exact line counting.\n");
+                free_modules(modules);
+                return false;
+            }
+            ext_sort_line_hook(modules->exact_lines, &modules->hooks[stats->hook_count++]);
+        }
+    }
+
+    if (options->cooc_window > 0)
+    {
+        modules->cooccur = create_cooccur_stats(options->cooc_window, (uint32_t)options->cooc_min,
+                                                COOC_TOP);
+        if (modules->cooccur == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up co-occurrence counting.\n");
+            free_modules(modules);
+            return false;
+        }
+        cooccur_scan_hook(modules->cooccur, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->tfidf)
+    {
+        modules->tfidf = create_tfidf_stats(TFIDF_TOP);
+        if (modules->tfidf == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up TF-IDF statistics.\n");
+            free_modules(modules);
+            return false;
+        }
+        tfidf_scan_hook(modules->tfidf, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->entropy)
+    {
+        modules->entropy = create_entropy_stats(stats);
+        if (modules->entropy == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up entropy statistics.\n");
+            free_modules(modules);
+            return false;
+        }
+        entropy_scan_hook(modules->entropy, &modules->hooks[stats->hook_count++]);
+    }
+
+    if (options->sample_fraction > 0.0)
+    {
+        modules->sample = calloc(1, sizeof(SampleEstimate));
+        if (modules->sample == NULL)
+        {
+            fprintf(stderr, "Fatal: Could not set up sampling.\n");
+            free_modules(modules);
+            return false;
+        }
+        modules->sample->fraction = options->sample_fraction;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Frees every optional module.
+ * @param modules A pointer to the modules to free.
+ */
+static void free_modules(AnalysisModules *modules)
+{
+    free_window_stats(modules->windows);
+    free_pattern_set(modules->patterns);
+    free_keyword_set(modules->keywords);
+    free_delim_stats(modules->columns);
+    free_jsonl_stats(modules->json);
+    free_line_hash_stats(modules->lines);
+    free_ext_sort(modules->exact_words);
+    free_ext_sort(modules->exact_lines);
+    free_cooccur_stats(modules->cooccur);
+    free_tfidf_stats(modules->tfidf);
+    free_entropy_stats(modules->entropy);
+    free(modules->sample);
+    memset(modules, 0, sizeof(*modules));
+}
+
+/**
+ * @brief Emits periodic output while a file is being followed.
+ * Windows are ticked on every call so that idle periods close on time; the
+ * full report is written once per interval. When the report goes to a file,
+ * the file is rewritten so that it always holds the latest report.
+ * @param ctx A pointer to the FollowContext.
+ * @param now The current wall time.
+ * @param report Non-zero if a report interval has elapsed.
+ */
+static void on_follow_tick(void *ctx, time_t now, int report)
+{
+    FollowContext *fc = ctx;
+    if (fc->modules->windows != NULL)
+    {
+        window_tick(fc->modules->windows, now); // window_finish() reports a failure.
+    }
+    if (!report || !fc->show_report)
+    {
+        return;
+    }
+
+    if (fc->options->output_filename != NULL && fc->modules->windows == NULL)
+    {
+        *fc->output_stream = freopen(fc->options->output_filename, "w", *fc->output_stream);
+        if (*fc->output_stream == NULL)
+        {
+            perror("Error reopening output file");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (print_report(fc->stats, fc->options, fc->modules, *fc->output_stream) != 0 ||
+        fflush(*fc->output_stream) != 0)
+    {
+        fc->status = -1;
+    }
+}
+
+/**
+ * @brief Parses the numeric value of a command-line option.
+ * @param option The option being parsed (for error messages).
+ * @param text The text to parse; must be a positive integer.
+ * @param value Receives the parsed value on success.
+ * @return true on success, false (after printing an error) otherwise.
+ */
+static bool parse_count(const char *option, const char *text, long long *value)
+{
+    char *end;
+    long long parsed = text != NULL ? strtoll(text, &end, 10) : 0;
+    if (text == NULL || *text == '\0' || *end != '\0' || parsed < 1 || parsed > 2147483647LL)
+    {
+        fprintf(stderr, "Error: %s option requires a positive number.\n", option);
+        return false;
+    }
+    *value = parsed;
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,102 @@
+/**
+ * @file numa.c
+ * @brief Implementation of NUMA node discovery and thread placement.
+ */
+
+#define _GNU_SOURCE // cpu_set_t and sched_setaffinity().
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "numa.h"
+
+// The most nodes told apart; CPUs of further nodes are not used for binding.
+#define MAX_NODES 64
+
+#define NODE_DIR "/sys/devices/system/node"
+
+static pthread_once_t topology_once = PTHREAD_ONCE_INIT;
+static int node_count = 1;
+static cpu_set_t node_cpus[MAX_NODES]; // Allowed CPUs of each node with any.
+
+/**
+ * @brief Reads a sysfs list such as "0-3,8-11" into a CPU set.
+ * @return 0 on success, -1 if the file cannot be read or parsed.
+ */
+static int read_list(const char *path, cpu_set_t *set)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+    CPU_ZERO(set);
+    int status = 0;
+    int first, last, c;
+    while (status == 0 && fscanf(file, "%d", &first) == 1)
+    {
+        last = first;
+        c = fgetc(file);
+        if (c == '-')
+        {
+            status = fscanf(file, "%d", &last) == 1 ? 0 : -1;
+            c = fgetc(file);
+        }
+        for (int i = first; status == 0 && i <= last && i < CPU_SETSIZE; i++)
+        {
+            CPU_SET(i, set);
+        }
+        if (c != ',')
+        {
+            break;
+        }
+    }
+    fclose(file);
+    return status;
+}
+
+static void load_topology(void)
+{
+    cpu_set_t allowed, online, cpus;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ||
+        read_list(NODE_DIR "/online", &online) != 0)
+    {
+        return; // One node: binding is a no-op.
+    }
+    int count = 0;
+    for (int node = 0; node < CPU_SETSIZE && count < MAX_NODES; node++)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), NODE_DIR "/node%d/cpulist", node);
+        if (!CPU_ISSET(node, &online) || read_list(path, &cpus) != 0)
+        {
+            continue;
+        }
+        CPU_AND(&node_cpus[count], &cpus, &allowed);
+        if (CPU_COUNT(&node_cpus[count]) > 0)
+        {
+            count++; // Nodes with memory only, or outside our affinity, are left out.
+        }
+    }
+    node_count = count > 1 ? count : 1;
+}
+
+int numa_node_count(void)
+{
+    pthread_once(&topology_once, load_topology);
+    return node_count;
+}
+
+int numa_bind_thread(int node)
+{
+    if (numa_node_count() < 2)
+    {
+        return 0;
+    }
+    if (node < 0 || node >= node_count)
+    {
+        return -1;
+    }
+    return sched_setaffinity(0, sizeof(node_cpus[node]), &node_cpus[node]) == 0 ? 0 : -1;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file numa.h
+ * @brief Public interface for NUMA node discovery and thread placement.
+ *
+ * On a machine with several NUMA nodes (sockets), memory is attached to one
+ * node and is slower to reach from the others. The nodes and their CPUs are
+ * read from sysfs (/sys/devices/system/node), restricted to the CPUs this
+ * process may run on. A thread bound to a node runs on that node's CPUs
+ * only, and since Linux places a page on the node of the thread that first
+ * touches it, the memory such a thread allocates and fills is local to it.
+ *
+ * Without sysfs, or on a machine with a single node, there is one node and
+ * binding does nothing.
+ */
+
+#ifndef NUMA_H
+#define NUMA_H
+
+/**
+ * @brief Returns the number of NUMA nodes this process can run threads on
+ *        (at least 1).
+ */
+int numa_node_count(void);
+
+/**
+ * @brief Binds the calling thread to the CPUs of a node.
+ * @param node The node, from 0 to numa_node_count() - 1.
+ * @return 0 on success (or if there is a single node), -1 on failure.
+ */
+int numa_bind_thread(int node);
+
+#endif // NUMA_H
@@ -0,0 +1,266 @@
+/**
+ * @file outbuf.c
+ * @brief Implementation of the buffered report writer.
+ *
+ * If a chunk cannot be allocated, what is buffered is flushed and the data
+ * is written straight through, so running out of memory makes the report
+ * slower but never truncates it.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "outbuf.h"
+
+// Iovecs handed to one writev() call.
+#define MAX_IOV 64
+
+// Spaces copied when padding a column.
+static const char SPACES[] = "                                ";
+
+struct OutChunk
+{
+    OutChunk *next;
+    size_t used;
+    char data[OUTBUF_CHUNK_SIZE];
+};
+
+void outbuf_init(OutBuf *out, int fd)
+{
+    memset(out, 0, sizeof(*out));
+    out->fd = fd;
+}
+
+/**
+ * @brief Writes all of `count` iovecs, resuming after partial writes.
+ */
+static int write_all(int fd, struct iovec *iov, int count)
+{
+    while (count > 0)
+    {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len)
+        {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+int outbuf_flush(OutBuf *out)
+{
+    struct iovec iov[MAX_IOV];
+    int count = 0;
+    for (OutChunk *chunk = out->head; chunk != NULL; chunk = chunk->next)
+    {
+        if (chunk->used > 0)
+        {
+            iov[count].iov_base = chunk->data;
+            iov[count].iov_len = chunk->used;
+            count++;
+        }
+        if (count == MAX_IOV || (chunk->next == NULL && count > 0))
+        {
+            if (!out->failed && write_all(out->fd, iov, count) != 0)
+            {
+                perror("Error writing report");
+                out->failed = 1;
+            }
+            count = 0;
+        }
+    }
+    for (OutChunk *chunk = out->head; chunk != NULL; chunk = chunk->next)
+    {
+        chunk->used = 0;
+    }
+    out->tail = out->head;
+    out->buffered = 0;
+    return out->failed ? -1 : 0;
+}
+
+int outbuf_write_to(OutBuf *out, int fd)
+{
+    int own = out->fd;
+    out->fd = fd;
+    int status = outbuf_flush(out);
+    out->fd = own;
+    return status;
+}
+
+void out_bytes(OutBuf *out, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        if (out->tail == NULL || out->tail->used == OUTBUF_CHUNK_SIZE)
+        {
+            OutChunk *next = out->tail != NULL ? out->tail->next : out->head;
+            if (next == NULL)
+            {
+                next = malloc(sizeof(OutChunk));
+                if (next == NULL && out->fd < 0)
+                {
+                    out->failed = 1; // Collecting only: nowhere to write through to.
+                    return;
+                }
+                if (next == NULL)
+                {
+                    // No memory for more buffering: write through.
+                    outbuf_flush(out);
+                    struct iovec iov = {(void *)data, len};
+                    if (!out->failed && write_all(out->fd, &iov, 1) != 0)
+                    {
+                        perror("Error writing report");
+                        out->failed = 1;
+                    }
+                    return;
+                }
+                next->next = NULL;
+                next->used = 0;
+                if (out->tail != NULL)
+                {
+                    out->tail->next = next;
+                }
+                else
+                {
+                    out->head = next;
+                }
+            }
+            out->tail = next;
+        }
+
+        size_t room = OUTBUF_CHUNK_SIZE - out->tail->used;
+        size_t n = len < room ? len : room;
+        memcpy(out->tail->data + out->tail->used, data, n);
+        out->tail->used += n;
+        out->buffered += n;
+        data += n;
+        len -= n;
+        if (out->buffered >= OUTBUF_STREAM_THRESHOLD && out->fd >= 0)
+        {
+            outbuf_flush(out);
+        }
+    }
+}
+
+void out_str(OutBuf *out, const char *s)
+{
+    out_bytes(out, s, strlen(s));
+}
+
+/**
+ * @brief Appends `count` spaces.
+ */
+static void out_spaces(OutBuf *out, int count)
+{
+    while (count > 0)
+    {
+        int n = count < (int)sizeof(SPACES) - 1 ? count : (int)sizeof(SPACES) - 1;
+        out_bytes(out, SPACES, (size_t)n);
+        count -= n;
+    }
+}
+
+void out_pad(OutBuf *out, const char *s, int width)
+{
+    size_t len = strlen(s);
+    out_bytes(out, s, len);
+    if (width > 0 && (size_t)width > len)
+    {
+        out_spaces(out, width - (int)len);
+    }
+}
+
+void out_int(OutBuf *out, long long value, int width)
+{
+    // Digits are produced from the right; unsigned arithmetic keeps
+    // LLONG_MIN right.
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value
+                                             : (unsigned long long)value;
+    do
+    {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0)
+    {
+        *--p = '-';
+    }
+
+    int len = (int)(digits + sizeof(digits) - p);
+    if (width > len)
+    {
+        out_spaces(out, width - len);
+    }
+    out_bytes(out, p, (size_t)len);
+    if (-width > len)
+    {
+        out_spaces(out, -width - len);
+    }
+}
+
+void out_printf(OutBuf *out, const char *format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return;
+    }
+    if ((size_t)len < sizeof(text))
+    {
+        out_bytes(out, text, (size_t)len);
+        return;
+    }
+
+    // Longer than the stack buffer: format again into the heap.
+    char *long_text = malloc((size_t)len + 1);
+    if (long_text == NULL)
+    {
+        return;
+    }
+    va_start(args, format);
+    vsnprintf(long_text, (size_t)len + 1, format, args);
+    va_end(args);
+    out_bytes(out, long_text, (size_t)len);
+    free(long_text);
+}
+
+int outbuf_finish(OutBuf *out)
+{
+    int status = outbuf_flush(out);
+    OutChunk *chunk = out->head;
+    while (chunk != NULL)
+    {
+        OutChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    out->head = out->tail = NULL;
+    return status;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file outbuf.h
+ * @brief Public interface for the buffered report writer.
+ *
+ * Reports can run to millions of rows (one per distinct word), and
+ * formatting each row with fprintf() costs more than producing it. An
+ * OutBuf collects the report in a chain of fixed-size chunks, formats
+ * integers and padded columns itself, and hands the whole chain to the
+ * kernel with a single writev(). Once more than OUTBUF_STREAM_THRESHOLD
+ * bytes are waiting they are written out, so memory use stays bounded
+ * however long the report is.
+ *
+ * An OutBuf created for descriptor -1 only collects: it is never written
+ * on its own, and outbuf_write_to() hands its contents to a descriptor.
+ * This lets threads format parts of a report side by side.
+ */
+
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+
+// Size of each buffer in the chain.
+#define OUTBUF_CHUNK_SIZE 65536
+
+// Buffered bytes that trigger a write before the report is finished.
+#define OUTBUF_STREAM_THRESHOLD (1 << 20)
+
+typedef struct OutChunk OutChunk;
+
+/**
+ * @struct OutBuf
+ * @brief Output waiting to be written to a file descriptor.
+ */
+typedef struct
+{
+    int fd;          // Where the output goes.
+    OutChunk *head;  // The chunk chain; chunks are reused after a flush.
+    OutChunk *tail;  // The chunk being filled.
+    size_t buffered; // Bytes waiting in the chain.
+    int failed;      // Non-zero once a write has failed.
+} OutBuf;
+
+/**
+ * @brief Prepares an empty OutBuf for a file descriptor.
+ * @param out The OutBuf to initialize.
+ * @param fd The descriptor to write to, or -1 to only collect. If it
+ *           belongs to a stdio stream, flush the stream first.
+ */
+void outbuf_init(OutBuf *out, int fd);
+
+/**
+ * @brief Appends bytes to the output.
+ */
+void out_bytes(OutBuf *out, const char *data, size_t len);
+
+/**
+ * @brief Appends a NUL-terminated string.
+ */
+void out_str(OutBuf *out, const char *s);
+
+/**
+ * @brief Appends a string left-aligned in a column, like "%-*s".
+ */
+void out_pad(OutBuf *out, const char *s, int width);
+
+/**
+ * @brief Appends an integer, like "%*lld".
+ * @param width The column width: positive right-aligns, negative
+ *              left-aligns, 0 uses no padding.
+ */
+void out_int(OutBuf *out, long long value, int width);
+
+/**
+ * @brief Appends printf-style output, for the rare values (floating point)
+ *        the functions above do not cover.
+ */
+void out_printf(OutBuf *out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Writes everything buffered with writev().
+ * @return 0 on success, -1 if a write failed (now or earlier).
+ */
+int outbuf_flush(OutBuf *out);
+
+/**
+ * @brief Writes everything buffered to `fd` and empties the buffer, which
+ *        keeps its chunks (and its own descriptor) for reuse.
+ * @return 0 on success, -1 if the write failed.
+ */
+int outbuf_write_to(OutBuf *out, int fd);
+
+/**
+ * @brief Flushes the output and frees the chunk chain.
+ * @return 0 on success, -1 if any write failed.
+ */
+int outbuf_finish(OutBuf *out);
+
+#endif // OUTBUF_H
@@ -0,0 +1,273 @@
+/**
+ * @file parallel.c
+ * @brief Implementation of the multi-threaded full analysis.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "numa.h"
+#include "parallel.h"
+#include "sniff.h"
+
+// Bytes requested per pread() call; the same block size analyze_file() reads.
+#define READ_SIZE 65536
+
+// The smallest range worth giving a thread of its own.
+#define MIN_RANGE_BYTES (8LL << 20)
+
+// The most threads used for one file.
+#define MAX_THREADS 64
+
+/**
+ * @struct ScanRange
+ * @brief The part of a file scanned by one thread, and its result.
+ *
+ * The ranges of a NUMA node are adjacent; the first one leads the node's
+ * group and merges the others into its own result.
+ */
+typedef struct ScanRange
+{
+    int fd;
+    long long start;          // First byte of the range.
+    long long end;            // One past the last byte.
+    int table_size;           // Buckets of the word table.
+    int node;                 // The NUMA node the range is scanned on.
+    PartialResult part;       // The statistics of the range.
+    int failed;               // Non-zero if a read or an allocation failed.
+    pthread_t thread;
+    int started;              // Non-zero if `thread` runs the range.
+    struct ScanRange *members; // For a group leader: the rest of its group.
+    int member_count;
+} ScanRange;
+
+/**
+ * @brief Scans a range. The table and the buffer are allocated (and first
+ *        touched) here, on the scanning thread, so they are on its node.
+ */
+static void scan_range(ScanRange *range)
+{
+    char *buffer = malloc(READ_SIZE);
+    if (buffer == NULL || partial_init(&range->part, range->table_size) != 0)
+    {
+        fprintf(stderr, "Fatal: Could not create hash table.\n");
+        free(buffer);
+        range->failed = 1;
+        return;
+    }
+    long long offset = range->start;
+    while (offset < range->end)
+    {
+        size_t want = range->end - offset < READ_SIZE ? (size_t)(range->end - offset) : READ_SIZE;
+        ssize_t n = pread(range->fd, buffer, want, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            range->failed = 1; // An error, or the file shrank under us.
+            break;
+        }
+        partial_scan(&range->part, buffer, (size_t)n);
+        offset += n;
+    }
+    free(buffer);
+}
+
+/**
+ * @brief Scans a group leader's range, then merges in the rest of the group
+ *        in file order, so that a node's pieces meet in its own memory and
+ *        only one piece per node crosses to the final merge.
+ */
+static void scan_group(ScanRange *leader)
+{
+    scan_range(leader);
+    for (int m = 0; m < leader->member_count; m++)
+    {
+        ScanRange *member = &leader->members[m];
+        if (member->started)
+        {
+            pthread_join(member->thread, NULL);
+        }
+        else
+        {
+            scan_range(member); // It could not be started: scan it here.
+        }
+        leader->failed |= member->failed;
+        if (!leader->failed)
+        {
+            partial_merge(&leader->part, &member->part);
+        }
+    }
+}
+
+static void *run_range(void *arg)
+{
+    ScanRange *range = arg;
+    numa_bind_thread(range->node); // Best effort: an unbound thread still scans correctly.
+    if (range->members != NULL)
+    {
+        scan_group(range);
+    }
+    else
+    {
+        scan_range(range);
+    }
+    return NULL;
+}
+
+long long binary_policy_size(AppStats *stats, int fd, long long size)
+{
+    if (stats->binary_policy == BINARY_SCAN)
+    {
+        return size;
+    }
+    char head[SNIFF_BYTES];
+    ssize_t got = pread(fd, head, SNIFF_BYTES, 0);
+    if (got < 0)
+    {
+        perror("Error reading file");
+        return -1;
+    }
+    SniffResult sniff;
+    sniff_content(head, (size_t)got, &sniff);
+    if (!sniff.is_binary)
+    {
+        return size;
+    }
+    stats->binary_files++;
+    fprintf(stderr, "Note: %s looks binary (%zu NUL, %zu control, %zu invalid UTF-8 "
+            "in the first %zu bytes); %s.\n", stats->filename, sniff.nul_bytes,
+            sniff.control, sniff.invalid_utf8, sniff.bytes,
+            stats->binary_policy == BINARY_SKIP ? "skipping it" : "sampling its start");
+    if (stats->binary_policy == BINARY_SKIP)
+    {
+        return 0;
+    }
+    return size < BINARY_SAMPLE_BYTES ? size : BINARY_SAMPLE_BYTES;
+}
+
+int parallel_analyze_file(AppStats *stats, int threads)
+{
+    if (threads < 2 || strcmp(stats->filename, "-") == 0)
+    {
+        return analyze_file(stats);
+    }
+    int fd = open(stats->filename, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Error opening file");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < 2 * MIN_RANGE_BYTES)
+    {
+        close(fd);
+        return analyze_file(stats);
+    }
+
+    long long size = binary_policy_size(stats, fd, (long long)st.st_size);
+    if (size < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // One range per thread, each at least MIN_RANGE_BYTES long.
+    long long wanted = (size + MIN_RANGE_BYTES - 1) / MIN_RANGE_BYTES;
+    int count = threads < wanted ? threads : (int)wanted;
+    count = count > MAX_THREADS ? MAX_THREADS : (count < 1 ? 1 : count);
+
+    ScanRange *ranges = calloc((size_t)count, sizeof(ScanRange));
+    if (ranges == NULL)
+    {
+        close(fd);
+        fprintf(stderr, "Fatal: Could not create hash table.\n");
+        return -1;
+    }
+    // Adjacent ranges share a node, so each node's group is one piece of the file.
+    int nodes = numa_node_count();
+    int groups = nodes < count ? nodes : count;
+    for (int t = 0; t < count; t++)
+    {
+        ranges[t].fd = fd;
+        ranges[t].start = size * t / count;
+        ranges[t].end = size * (t + 1) / count;
+        ranges[t].table_size = stats->word_counts->size;
+        ranges[t].node = (int)((long long)t * groups / count);
+    }
+    for (int t = 0, leader = 0; t < count; t++)
+    {
+        if (ranges[t].node != ranges[leader].node)
+        {
+            leader = t;
+        }
+        else if (t != leader)
+        {
+            ranges[leader].members = &ranges[leader + 1];
+            ranges[leader].member_count = t - leader;
+        }
+    }
+
+    // Members start first, so their thread ids are set before the leader
+    // that joins them exists. With a single node, the calling thread leads.
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int t = 0; t < count; t++)
+        {
+            bool leads = t == 0 || ranges[t].node != ranges[t - 1].node;
+            if (leads == (pass == 1) && !(leads && groups == 1))
+            {
+                ranges[t].started =
+                    pthread_create(&ranges[t].thread, NULL, run_range, &ranges[t]) == 0;
+            }
+        }
+    }
+
+    int status = 0;
+    for (int t = 0; t < count; t++)
+    {
+        if (t > 0 && ranges[t].node == ranges[t - 1].node)
+        {
+            continue; // A member, merged by its leader.
+        }
+        if (ranges[t].started)
+        {
+            pthread_join(ranges[t].thread, NULL);
+        }
+        else
+        {
+            scan_group(&ranges[t]);
+        }
+        status |= ranges[t].failed ? -1 : 0;
+        if (t > 0 && status == 0)
+        {
+            partial_merge(&ranges[0].part, &ranges[t].part); // In file order.
+        }
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Error reading file: %s\n", stats->filename);
+    }
+    else
+    {
+        partial_finish(&ranges[0].part, stats);
+    }
+
+    for (int t = 0; t < count; t++)
+    {
+        partial_free(&ranges[t].part);
+    }
+    free(ranges);
+    close(fd);
+    return status;
+}
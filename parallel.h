@@ -0,0 +1,43 @@
+/**
+ * @file parallel.h
+ * @brief Public interface for the multi-threaded full analysis.
+ *
+ * A large regular file is split into one byte range per thread, with no
+ * regard for word or line boundaries. Each thread scans its range into a
+ * PartialResult of its own, and the pieces are merged in file order, which
+ * closes the words cut by the range edges. The result, including the order
+ * of the word table, is the same as that of analyze_file().
+ *
+ * On a NUMA machine (see numa.h) the ranges are dealt out to the nodes in
+ * adjacent groups. Each thread is bound to its node and allocates its own
+ * buffer and table, so they are local to it; the first thread of a group
+ * merges the group, and only one piece per node is merged across nodes.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "analyzer.h"
+
+/**
+ * @brief Analyzes `stats->filename` into `stats` with up to `threads` threads.
+ *
+ * Standard input, other non-seekable inputs and files too small to be
+ * worth splitting are handed to analyze_file(). Scan hooks must not be
+ * installed, since the ranges are not scanned in order.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int parallel_analyze_file(AppStats *stats, int threads);
+
+/**
+ * @brief Applies the binary policy to a regular file as analyze_file()
+ *        does: sniffs its first block, counts and reports a binary input.
+ * @param stats The analysis; `filename` and `binary_policy` are used.
+ * @param fd The open file.
+ * @param size The size of the file.
+ * @return The number of leading bytes to analyze, or -1 if it cannot be read.
+ */
+long long binary_policy_size(AppStats *stats, int fd, long long size);
+
+#endif // PARALLEL_H
@@ -0,0 +1,1326 @@
+/**
+ * @file pattern.c
+ * @brief Implementation of multi-pattern regular-expression counting.
+ *
+ * Compilation happens in three steps:
+ *   1. Each pattern is parsed into a small syntax tree.
+ *   2. The trees are turned into one Thompson NFA whose start state can
+ *      reach every pattern, with a separate accepting state per pattern.
+ *   3. Subset construction turns the NFA into a DFA. A DFA state is the set
+ *      of NFA states reached after consuming at least one byte; the start
+ *      state is added back at every step, which makes the automaton search
+ *      for matches starting at any position instead of only at the beginning.
+ * The scan then needs one transition lookup per byte. The DFA tells, for
+ * each pattern, where a region with a match in progress begins and ends;
+ * the leftmost-longest matches in a region that contains one are found by
+ * running that pattern's part of the NFA over the region.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include "pattern.h"
+
+// Safety limits that keep a pathological pattern from exhausting memory.
+#define MAX_DFA_STATES 10000
+#define MAX_REPEAT 255
+
+// --- Bitset helpers for 256-bit byte sets ---
+
+typedef struct
+{
+    uint8_t bits[32];
+} ByteSet;
+
+static void set_add(ByteSet *set, int c)
+{
+    set->bits[c >> 3] |= (uint8_t)(1u << (c & 7));
+}
+
+static int set_has(const ByteSet *set, int c)
+{
+    return (set->bits[c >> 3] >> (c & 7)) & 1;
+}
+
+static void set_add_range(ByteSet *set, int lo, int hi)
+{
+    for (int c = lo; c <= hi; c++)
+    {
+        set_add(set, c);
+    }
+}
+
+static void set_invert(ByteSet *set)
+{
+    for (int i = 0; i < 32; i++)
+    {
+        set->bits[i] = (uint8_t)~set->bits[i];
+    }
+}
+
+static void set_union(ByteSet *set, const ByteSet *other)
+{
+    for (int i = 0; i < 32; i++)
+    {
+        set->bits[i] |= other->bits[i];
+    }
+}
+
+// --- Step 1: Parsing ---
+
+typedef enum
+{
+    RX_SET,    // Matches one byte from `set`.
+    RX_EMPTY,  // Matches the empty string.
+    RX_CONCAT, // Matches `left` followed by `right`.
+    RX_ALT,    // Matches `left` or `right`.
+    RX_REPEAT  // Matches `left` between `min` and `max` times (max -1 = unbounded).
+} RxKind;
+
+typedef struct
+{
+    RxKind kind;
+    ByteSet set;
+    int left, right; // Child node indices.
+    int min, max;
+} RxNode;
+
+typedef struct
+{
+    const char *src; // The full pattern (for error messages).
+    const char *p;   // Current parse position.
+    RxNode *nodes;
+    int node_count;
+    int node_cap;
+    int error;
+} RxParser;
+
+static int rx_error(RxParser *ps, const char *message)
+{
+    if (!ps->error)
+    {
+        fprintf(stderr, "Error: pattern '%s': %s at offset %d.\n", ps->src, message,
+                (int)(ps->p - ps->src));
+        ps->error = 1;
+    }
+    return -1;
+}
+
+static int rx_node(RxParser *ps, RxKind kind, int left, int right)
+{
+    if (ps->node_count == ps->node_cap)
+    {
+        int cap = ps->node_cap ? ps->node_cap * 2 : 64;
+        RxNode *grown = realloc(ps->nodes, cap * sizeof(RxNode));
+        if (grown == NULL)
+        {
+            return rx_error(ps, "out of memory");
+        }
+        ps->nodes = grown;
+        ps->node_cap = cap;
+    }
+    RxNode *n = &ps->nodes[ps->node_count];
+    memset(n, 0, sizeof(*n));
+    n->kind = kind;
+    n->left = left;
+    n->right = right;
+    return ps->node_count++;
+}
+
+/**
+ * @brief Expands a class escape (\d, \w, \s and their negations) into `set`.
+ * @return 1 if `c` was a class escape, 0 otherwise.
+ */
+static int class_escape(int c, ByteSet *set)
+{
+    ByteSet tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    switch (c)
+    {
+    case 'd':
+    case 'D':
+        set_add_range(&tmp, '0', '9');
+        break;
+    case 'w':
+    case 'W':
+        set_add_range(&tmp, '0', '9');
+        set_add_range(&tmp, 'a', 'z');
+        set_add_range(&tmp, 'A', 'Z');
+        set_add(&tmp, '_');
+        break;
+    case 's':
+    case 'S':
+        set_add(&tmp, ' ');
+        set_add_range(&tmp, '\t', '\r');
+        break;
+    default:
+        return 0;
+    }
+    if (c == 'D' || c == 'W' || c == 'S')
+    {
+        set_invert(&tmp);
+    }
+    set_union(set, &tmp);
+    return 1;
+}
+
+static int hex_value(int c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Parses a single escaped literal (after the backslash).
+ * @return The byte value, or -1 on error.
+ */
+static int parse_escape_literal(RxParser *ps)
+{
+    int c = (unsigned char)*ps->p;
+    if (c == '\0')
+    {
+        return rx_error(ps, "trailing backslash");
+    }
+    ps->p++;
+    switch (c)
+    {
+    case 't':
+        return '\t';
+    case 'n':
+        return '\n';
+    case 'r':
+        return '\r';
+    case 'x':
+    {
+        int hi = hex_value((unsigned char)ps->p[0]);
+        int lo = hi >= 0 ? hex_value((unsigned char)ps->p[1]) : -1;
+        if (lo < 0)
+        {
+            return rx_error(ps, "\\x needs two hex digits");
+        }
+        ps->p += 2;
+        return hi * 16 + lo;
+    }
+    default:
+        return c;
+    }
+}
+
+static int parse_class(RxParser *ps)
+{
+    int node = rx_node(ps, RX_SET, -1, -1);
+    if (node < 0)
+    {
+        return -1;
+    }
+    ByteSet set;
+    memset(&set, 0, sizeof(set));
+
+    int negate = 0;
+    if (*ps->p == '^')
+    {
+        negate = 1;
+        ps->p++;
+    }
+
+    int first = 1;
+    while (*ps->p != ']' || first)
+    {
+        first = 0;
+        if (*ps->p == '\0')
+        {
+            return rx_error(ps, "unterminated character class");
+        }
+
+        int lo = (unsigned char)*ps->p++;
+        if (lo == '\\')
+        {
+            if (class_escape((unsigned char)*ps->p, &set))
+            {
+                ps->p++;
+                continue;
+            }
+            lo = parse_escape_literal(ps);
+            if (lo < 0)
+            {
+                return -1;
+            }
+        }
+
+        int hi = lo;
+        if (ps->p[0] == '-' && ps->p[1] != ']' && ps->p[1] != '\0')
+        {
+            ps->p++;
+            hi = (unsigned char)*ps->p++;
+            if (hi == '\\')
+            {
+                hi = parse_escape_literal(ps);
+                if (hi < 0)
+                {
+                    return -1;
+                }
+            }
+            if (hi < lo)
+            {
+                return rx_error(ps, "invalid range in character class");
+            }
+        }
+        set_add_range(&set, lo, hi);
+    }
+    ps->p++; // Skip the closing ']'.
+
+    if (negate)
+    {
+        set_invert(&set);
+    }
+    ps->nodes[node].set = set;
+    return node;
+}
+
+static int parse_alt(RxParser *ps);
+
+static int parse_atom(RxParser *ps)
+{
+    int c = (unsigned char)*ps->p;
+    if (c == '(')
+    {
+        ps->p++;
+        int inner = parse_alt(ps);
+        if (inner < 0)
+        {
+            return -1;
+        }
+        if (*ps->p != ')')
+        {
+            return rx_error(ps, "missing ')'");
+        }
+        ps->p++;
+        return inner;
+    }
+    if (c == '[')
+    {
+        ps->p++;
+        return parse_class(ps);
+    }
+    if (c == '*' || c == '+' || c == '?' || c == '{')
+    {
+        return rx_error(ps, "quantifier without anything to repeat");
+    }
+    if (c == '^' || c == '$')
+    {
+        return rx_error(ps, "anchors are not supported");
+    }
+
+    int node = rx_node(ps, RX_SET, -1, -1);
+    if (node < 0)
+    {
+        return -1;
+    }
+    ByteSet set;
+    memset(&set, 0, sizeof(set));
+    ps->p++;
+    if (c == '.')
+    {
+        set_add_range(&set, 0, 255);
+        set.bits['\n' >> 3] &= (uint8_t)~(1u << ('\n' & 7)); // '.' never matches a newline.
+    }
+    else if (c == '\\')
+    {
+        if (!class_escape((unsigned char)*ps->p, &set))
+        {
+            int lit = parse_escape_literal(ps);
+            if (lit < 0)
+            {
+                return -1;
+            }
+            set_add(&set, lit);
+        }
+        else
+        {
+            ps->p++;
+        }
+    }
+    else
+    {
+        set_add(&set, c);
+    }
+    ps->nodes[node].set = set;
+    return node;
+}
+
+static int parse_number(RxParser *ps)
+{
+    int value = -1;
+    while (*ps->p >= '0' && *ps->p <= '9')
+    {
+        value = (value < 0 ? 0 : value) * 10 + (*ps->p++ - '0');
+        if (value > MAX_REPEAT)
+        {
+            return rx_error(ps, "repetition count too large");
+        }
+    }
+    return value;
+}
+
+static int parse_repeat(RxParser *ps)
+{
+    int node = parse_atom(ps);
+    while (node >= 0)
+    {
+        int min, max;
+        char q = *ps->p;
+        if (q == '*')
+        {
+            min = 0, max = -1;
+        }
+        else if (q == '+')
+        {
+            min = 1, max = -1;
+        }
+        else if (q == '?')
+        {
+            min = 0, max = 1;
+        }
+        else if (q == '{')
+        {
+            ps->p++;
+            min = parse_number(ps);
+            if (min < 0)
+            {
+                return rx_error(ps, "expected a number after '{'");
+            }
+            max = min;
+            if (*ps->p == ',')
+            {
+                ps->p++;
+                max = (*ps->p == '}') ? -1 : parse_number(ps);
+                if (ps->error || (max >= 0 && max < min) || (max < 0 && *ps->p != '}'))
+                {
+                    return rx_error(ps, "invalid repetition range");
+                }
+            }
+            if (*ps->p != '}')
+            {
+                return rx_error(ps, "missing '}'");
+            }
+        }
+        else
+        {
+            break;
+        }
+        ps->p++;
+
+        int rep = rx_node(ps, RX_REPEAT, node, -1);
+        if (rep < 0)
+        {
+            return -1;
+        }
+        ps->nodes[rep].min = min;
+        ps->nodes[rep].max = max;
+        node = rep;
+    }
+    return node;
+}
+
+static int parse_concat(RxParser *ps)
+{
+    int node = -1;
+    while (*ps->p != '\0' && *ps->p != '|' && *ps->p != ')')
+    {
+        int next = parse_repeat(ps);
+        if (next < 0)
+        {
+            return -1;
+        }
+        node = (node < 0) ? next : rx_node(ps, RX_CONCAT, node, next);
+        if (node < 0)
+        {
+            return -1;
+        }
+    }
+    return node < 0 ? rx_node(ps, RX_EMPTY, -1, -1) : node;
+}
+
+static int parse_alt(RxParser *ps)
+{
+    int node = parse_concat(ps);
+    while (node >= 0 && *ps->p == '|')
+    {
+        ps->p++;
+        int right = parse_concat(ps);
+        if (right < 0)
+        {
+            return -1;
+        }
+        node = rx_node(ps, RX_ALT, node, right);
+    }
+    return node;
+}
+
+// --- Step 2: Thompson NFA construction ---
+
+typedef struct
+{
+    int eps1, eps2; // Epsilon transitions (-1 if unused).
+    int next;       // Target of the byte transition (-1 if none).
+    int accept;     // Pattern index accepted here, or -1.
+    ByteSet set;    // Bytes that follow `next`.
+} NfaState;
+
+typedef struct Nfa
+{
+    NfaState *states;
+    int count;
+    int cap;
+} Nfa;
+
+/**
+ * @brief Checks whether `target` is reachable from `from` by epsilon
+ *        transitions alone, i.e. whether a fragment matches the empty string.
+ * @return 1 if it is, 0 if not, -1 on allocation failure.
+ */
+static int epsilon_reaches(const Nfa *nfa, int from, int target)
+{
+    char *seen = calloc((size_t)nfa->count, 1);
+    int *stack = malloc((size_t)nfa->count * sizeof(int));
+    int found = seen != NULL && stack != NULL ? 0 : -1;
+    int top = 0;
+    if (found == 0)
+    {
+        stack[top++] = from;
+        seen[from] = 1;
+    }
+    while (top > 0 && found == 0)
+    {
+        int s = stack[--top];
+        found = s == target;
+        int eps[2] = {nfa->states[s].eps1, nfa->states[s].eps2};
+        for (int e = 0; e < 2; e++)
+        {
+            if (eps[e] >= 0 && !seen[eps[e]])
+            {
+                seen[eps[e]] = 1;
+                stack[top++] = eps[e];
+            }
+        }
+    }
+    free(seen);
+    free(stack);
+    return found;
+}
+
+/**
+ * @struct Frag
+ * @brief A piece of NFA with one entry and one exit state. The exit state
+ *        has no outgoing transitions yet; its eps1 is filled in by the caller.
+ */
+typedef struct
+{
+    int start;
+    int end;
+} Frag;
+
+static int nfa_state(Nfa *nfa)
+{
+    if (nfa->count == nfa->cap)
+    {
+        int cap = nfa->cap ? nfa->cap * 2 : 256;
+        NfaState *grown = realloc(nfa->states, cap * sizeof(NfaState));
+        if (grown == NULL)
+        {
+            return -1;
+        }
+        nfa->states = grown;
+        nfa->cap = cap;
+    }
+    NfaState *s = &nfa->states[nfa->count];
+    memset(s, 0, sizeof(*s));
+    s->eps1 = s->eps2 = s->next = s->accept = -1;
+    return nfa->count++;
+}
+
+static Frag build_frag(Nfa *nfa, const RxParser *ps, int node);
+
+/**
+ * @brief Builds `frag` optionally (zero or one times).
+ */
+static Frag frag_optional(Nfa *nfa, Frag inner)
+{
+    Frag f = {nfa_state(nfa), nfa_state(nfa)};
+    if (f.start < 0 || f.end < 0 || inner.start < 0)
+    {
+        return (Frag){-1, -1};
+    }
+    nfa->states[f.start].eps1 = inner.start;
+    nfa->states[f.start].eps2 = f.end;
+    nfa->states[inner.end].eps1 = f.end;
+    return f;
+}
+
+static Frag frag_concat(Nfa *nfa, Frag a, Frag b)
+{
+    if (a.start < 0 || b.start < 0)
+    {
+        return (Frag){-1, -1};
+    }
+    nfa->states[a.end].eps1 = b.start;
+    return (Frag){a.start, b.end};
+}
+
+static Frag build_repeat(Nfa *nfa, const RxParser *ps, const RxNode *n)
+{
+    // Mandatory copies first: x{3,} is x x x x*, x{2,4} is x x (x (x)?)?.
+    Frag result = {-1, -1};
+    for (int i = 0; i < n->min; i++)
+    {
+        Frag copy = build_frag(nfa, ps, n->left);
+        result = (result.start < 0) ? copy : frag_concat(nfa, result, copy);
+        if (result.start < 0)
+        {
+            return result;
+        }
+    }
+
+    Frag tail = {-1, -1};
+    if (n->max < 0)
+    {
+        // Kleene star: loop from the copy's exit back to its entry.
+        Frag inner = build_frag(nfa, ps, n->left);
+        tail = frag_optional(nfa, inner);
+        if (tail.start < 0)
+        {
+            return tail;
+        }
+        nfa->states[inner.end].eps2 = inner.start;
+    }
+    else
+    {
+        // Optional copies, nested from the inside out.
+        for (int i = n->min; i < n->max; i++)
+        {
+            Frag inner = build_frag(nfa, ps, n->left);
+            if (tail.start >= 0)
+            {
+                inner = frag_concat(nfa, inner, tail);
+            }
+            tail = frag_optional(nfa, inner);
+            if (tail.start < 0)
+            {
+                return tail;
+            }
+        }
+    }
+
+    if (tail.start < 0)
+    {
+        if (result.start >= 0)
+        {
+            return result;
+        }
+        int empty = nfa_state(nfa); // x{0} matches the empty string.
+        return (Frag){empty, empty};
+    }
+    return (result.start < 0) ? tail : frag_concat(nfa, result, tail);
+}
+
+static Frag build_frag(Nfa *nfa, const RxParser *ps, int node)
+{
+    const RxNode *n = &ps->nodes[node];
+    Frag f = {-1, -1};
+    switch (n->kind)
+    {
+    case RX_SET:
+        f.start = nfa_state(nfa);
+        f.end = nfa_state(nfa);
+        if (f.start >= 0 && f.end >= 0)
+        {
+            nfa->states[f.start].next = f.end;
+            nfa->states[f.start].set = n->set;
+        }
+        break;
+    case RX_EMPTY:
+        f.start = f.end = nfa_state(nfa);
+        break;
+    case RX_CONCAT:
+    {
+        Frag a = build_frag(nfa, ps, n->left);
+        Frag b = build_frag(nfa, ps, n->right);
+        f = frag_concat(nfa, a, b);
+        break;
+    }
+    case RX_ALT:
+    {
+        Frag a = build_frag(nfa, ps, n->left);
+        Frag b = build_frag(nfa, ps, n->right);
+        f.start = nfa_state(nfa);
+        f.end = nfa_state(nfa);
+        if (a.start < 0 || b.start < 0 || f.start < 0 || f.end < 0)
+        {
+            return (Frag){-1, -1};
+        }
+        nfa->states[f.start].eps1 = a.start;
+        nfa->states[f.start].eps2 = b.start;
+        nfa->states[a.end].eps1 = f.end;
+        nfa->states[b.end].eps1 = f.end;
+        break;
+    }
+    case RX_REPEAT:
+        f = build_repeat(nfa, ps, n);
+        break;
+    }
+    if (f.start < 0 || f.end < 0)
+    {
+        return (Frag){-1, -1};
+    }
+    return f;
+}
+
+// --- Step 3: Subset construction ---
+
+typedef struct
+{
+    const Nfa *nfa;
+    int words;         // 64-bit words per NFA state set.
+    uint64_t *sets;    // DFA state -> NFA state set (words each).
+    int count;         // Number of DFA states.
+    int *slots;        // Open-addressing index over `sets` (-1 = empty).
+    int slot_mask;
+    int *stack;        // Scratch stack for epsilon closures.
+} Subsets;
+
+static uint64_t hash_set(const uint64_t *set, int words)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (int i = 0; i < words; i++)
+    {
+        h = (h ^ set[i]) * 1099511628211ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/**
+ * @brief Extends an NFA state set with everything reachable by epsilon moves.
+ * @param stack Scratch space for one entry per NFA state.
+ */
+static void closure(const Nfa *nfa, int *stack, uint64_t *set)
+{
+    int top = 0;
+    for (int i = 0; i < nfa->count; i++)
+    {
+        if ((set[i >> 6] >> (i & 63)) & 1)
+        {
+            stack[top++] = i;
+        }
+    }
+    while (top > 0)
+    {
+        const NfaState *s = &nfa->states[stack[--top]];
+        int targets[2] = {s->eps1, s->eps2};
+        for (int t = 0; t < 2; t++)
+        {
+            int j = targets[t];
+            if (j >= 0 && !((set[j >> 6] >> (j & 63)) & 1))
+            {
+                set[j >> 6] |= 1ULL << (j & 63);
+                stack[top++] = j;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Finds the DFA state for an NFA state set, adding it if it is new.
+ * @return The DFA state index, or -1 if the state limit is exceeded.
+ */
+static int intern_set(Subsets *ss, const uint64_t *set)
+{
+    size_t bytes = ss->words * sizeof(uint64_t);
+    int slot = (int)(hash_set(set, ss->words) & ss->slot_mask);
+    while (ss->slots[slot] >= 0)
+    {
+        if (memcmp(ss->sets + (size_t)ss->slots[slot] * ss->words, set, bytes) == 0)
+        {
+            return ss->slots[slot];
+        }
+        slot = (slot + 1) & ss->slot_mask;
+    }
+    if (ss->count == MAX_DFA_STATES)
+    {
+        return -1;
+    }
+    memcpy(ss->sets + (size_t)ss->count * ss->words, set, bytes);
+    ss->slots[slot] = ss->count;
+    return ss->count++;
+}
+
+/**
+ * @brief Groups bytes that every NFA transition treats identically, so that
+ *        subset construction only has to consider one byte per group.
+ * @return The number of classes; `classes` maps each byte to its class.
+ */
+static int byte_classes(const Nfa *nfa, int classes[256])
+{
+    int count = 1;
+    memset(classes, 0, 256 * sizeof(int));
+    for (int i = 0; i < nfa->count; i++)
+    {
+        if (nfa->states[i].next < 0)
+        {
+            continue;
+        }
+        // Split every class into the part inside and the part outside the set.
+        int remap[512];
+        for (int k = 0; k < 2 * count; k++)
+        {
+            remap[k] = -1;
+        }
+        int next_count = 0;
+        for (int c = 0; c < 256; c++)
+        {
+            int key = classes[c] * 2 + set_has(&nfa->states[i].set, c);
+            if (remap[key] < 0)
+            {
+                remap[key] = next_count++;
+            }
+            classes[c] = remap[key];
+        }
+        count = next_count;
+    }
+    return count;
+}
+
+/**
+ * @brief Builds the search DFA.
+ * @param owner The pattern each NFA state belongs to, or -1 for the states
+ *        that link the patterns to the start state.
+ */
+static int build_dfa(PatternSet *ps, const Nfa *nfa, int start, const int *owner)
+{
+    Subsets ss;
+    ss.nfa = nfa;
+    ss.words = (nfa->count + 63) / 64;
+    ss.count = 0;
+    int slot_count = 1;
+    while (slot_count < 2 * MAX_DFA_STATES)
+    {
+        slot_count <<= 1;
+    }
+    ss.slot_mask = slot_count - 1;
+    ss.sets = malloc((size_t)MAX_DFA_STATES * ss.words * sizeof(uint64_t));
+    ss.slots = malloc((ss.slot_mask + 1) * sizeof(int));
+    ss.stack = malloc(nfa->count * sizeof(int));
+    uint64_t *start_set = calloc(ss.words, sizeof(uint64_t));
+    uint64_t *cur = calloc(ss.words, sizeof(uint64_t));
+    uint64_t *next = calloc(ss.words, sizeof(uint64_t));
+    uint16_t *trans = malloc((size_t)MAX_DFA_STATES * 256 * sizeof(uint16_t));
+    int status = -1;
+
+    if (ss.sets == NULL || ss.slots == NULL || ss.stack == NULL || start_set == NULL ||
+        cur == NULL || next == NULL || trans == NULL)
+    {
+        fprintf(stderr, "Error: out of memory while compiling patterns.\n");
+        goto done;
+    }
+    memset(ss.slots, -1, (ss.slot_mask + 1) * sizeof(int));
+
+    int classes[256];
+    int class_count = byte_classes(nfa, classes);
+    int representative[256];
+    for (int c = 255; c >= 0; c--)
+    {
+        representative[classes[c]] = c;
+    }
+
+    start_set[start >> 6] |= 1ULL << (start & 63);
+    closure(nfa, ss.stack, start_set);
+    intern_set(&ss, next); // State 0: nothing consumed yet (`next` is still empty).
+
+    // States are processed in creation order; new ones are appended.
+    for (int d = 0; d < ss.count; d++)
+    {
+        for (int k = 0; k < class_count; k++)
+        {
+            int c = representative[k];
+            const uint64_t *set = ss.sets + (size_t)d * ss.words;
+            for (int w = 0; w < ss.words; w++)
+            {
+                cur[w] = set[w] | start_set[w]; // A new match may start at any byte.
+            }
+            memset(next, 0, ss.words * sizeof(uint64_t));
+            for (int i = 0; i < nfa->count; i++)
+            {
+                const NfaState *s = &nfa->states[i];
+                if (((cur[i >> 6] >> (i & 63)) & 1) && s->next >= 0 && set_has(&s->set, c))
+                {
+                    next[s->next >> 6] |= 1ULL << (s->next & 63);
+                }
+            }
+            closure(nfa, ss.stack, next);
+
+            int target = intern_set(&ss, next);
+            if (target < 0)
+            {
+                fprintf(stderr, "Error: patterns need more than %d automaton states; "
+                                "try fewer or simpler patterns.\n",
+                        MAX_DFA_STATES);
+                goto done;
+            }
+            for (int b = 0; b < 256; b++)
+            {
+                if (classes[b] == k)
+                {
+                    trans[(size_t)d * 256 + b] = (uint16_t)target;
+                }
+            }
+        }
+    }
+
+    ps->state_count = ss.count;
+    // Give back the unused part of the worst-case transition table.
+    uint16_t *shrunk = realloc(trans, (size_t)ss.count * 256 * sizeof(uint16_t));
+    if (shrunk != NULL)
+    {
+        trans = shrunk;
+    }
+    ps->transitions = trans;
+    trans = NULL;
+    ps->accepts = calloc(ss.count, sizeof(uint64_t));
+    ps->pending = calloc(ss.count, sizeof(uint64_t));
+    if (ps->accepts == NULL || ps->pending == NULL)
+    {
+        goto done;
+    }
+    for (int d = 0; d < ss.count; d++)
+    {
+        const uint64_t *set = ss.sets + (size_t)d * ss.words;
+        for (int i = 0; i < nfa->count; i++)
+        {
+            if (!((set[i >> 6] >> (i & 63)) & 1))
+            {
+                continue;
+            }
+            if (nfa->states[i].accept >= 0)
+            {
+                ps->accepts[d] |= 1ULL << nfa->states[i].accept;
+            }
+            if (nfa->states[i].next >= 0 && owner[i] >= 0)
+            {
+                ps->pending[d] |= 1ULL << owner[i]; // Could still consume another byte.
+            }
+        }
+    }
+    status = 0;
+
+done:
+    free(ss.sets);
+    free(ss.slots);
+    free(ss.stack);
+    free(start_set);
+    free(cur);
+    free(next);
+    free(trans);
+    return status;
+}
+
+// --- Public interface ---
+
+PatternSet *compile_patterns(const char *const *patterns, int count)
+{
+    if (patterns == NULL || count < 1 || count > MAX_PATTERNS)
+    {
+        return NULL;
+    }
+
+    PatternSet *ps = calloc(1, sizeof(PatternSet));
+    if (ps == NULL)
+    {
+        return NULL;
+    }
+
+    Nfa nfa = {NULL, 0, 0};
+    int start = nfa_state(&nfa);
+    int last_branch = start;
+    int ok = start >= 0;
+
+    int first_state[MAX_PATTERNS + 1]; // NFA states of pattern i: [first_state[i], branch).
+    for (int i = 0; i < count && ok; i++)
+    {
+        ps->sources[i] = strdup(patterns[i]);
+        ps->count++;
+        first_state[i] = nfa.count;
+
+        RxParser parser = {patterns[i], patterns[i], NULL, 0, 0, 0};
+        int root = parse_alt(&parser);
+        if (root >= 0 && *parser.p != '\0')
+        {
+            root = rx_error(&parser, "unmatched ')'");
+        }
+
+        Frag f = (root >= 0) ? build_frag(&nfa, &parser, root) : (Frag){-1, -1};
+        int accept = nfa_state(&nfa);
+        int branch = nfa_state(&nfa);
+        free(parser.nodes);
+        if (ps->sources[i] == NULL || f.start < 0 || accept < 0 || branch < 0)
+        {
+            ok = 0;
+            break;
+        }
+
+        // A pattern that matches the empty string would match at every byte.
+        nfa.states[f.end].eps1 = accept;
+        int empty = epsilon_reaches(&nfa, f.start, accept);
+        if (empty != 0)
+        {
+            if (empty > 0)
+            {
+                fprintf(stderr, "Error: pattern '%s' matches the empty string.\n", patterns[i]);
+            }
+            ok = 0;
+            break;
+        }
+
+        // Chain the patterns off the start state: start -> branch_1 -> ...
+        nfa.states[accept].accept = i;
+        nfa.states[last_branch].eps1 = f.start;
+        nfa.states[last_branch].eps2 = branch;
+        last_branch = branch;
+        ps->starts[i] = f.start;
+        ps->finals[i] = accept;
+    }
+
+    int *owner = ok ? malloc((size_t)nfa.count * sizeof(int)) : NULL;
+    if (owner != NULL)
+    {
+        first_state[count] = nfa.count;
+        for (int j = 0; j < nfa.count; j++)
+        {
+            owner[j] = -1;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            // The last state made for a pattern is the branch to the next one.
+            for (int j = first_state[i]; j < first_state[i + 1] - 1; j++)
+            {
+                owner[j] = i;
+            }
+        }
+    }
+
+    // The NFA is kept for finding the matches within a region.
+    int words = (nfa.count + 63) / 64;
+    ps->nfa = malloc(sizeof(Nfa));
+    ps->scratch = malloc(2 * (size_t)words * sizeof(uint64_t));
+    ps->stack = malloc((size_t)nfa.count * sizeof(int));
+    if (owner == NULL || ps->nfa == NULL || ps->scratch == NULL || ps->stack == NULL ||
+        build_dfa(ps, &nfa, start, owner) != 0)
+    {
+        free(ps->nfa);
+        ps->nfa = NULL;
+        free(owner);
+        free(nfa.states);
+        free_pattern_set(ps);
+        return NULL;
+    }
+    free(owner);
+    *ps->nfa = nfa;
+    return ps;
+}
+
+/**
+ * @brief Counts the leftmost-longest, non-overlapping matches of one pattern
+ *        in a region, by running the pattern's NFA from each candidate start.
+ */
+static long long count_in_region(PatternSet *ps, int p, const char *text, size_t len)
+{
+    const Nfa *nfa = ps->nfa;
+    int words = (nfa->count + 63) / 64;
+    uint64_t *cur = ps->scratch;
+    uint64_t *next = ps->scratch + words;
+    int final = ps->finals[p];
+    long long found = 0;
+
+    size_t from = 0;
+    while (from < len)
+    {
+        memset(cur, 0, (size_t)words * sizeof(uint64_t));
+        cur[ps->starts[p] >> 6] |= 1ULL << (ps->starts[p] & 63);
+        closure(nfa, ps->stack, cur);
+
+        // Run until no thread is left; the last accepting byte ends the match.
+        size_t end = 0;
+        for (size_t i = from; i < len; i++)
+        {
+            int c = (unsigned char)text[i];
+            int alive = 0;
+            memset(next, 0, (size_t)words * sizeof(uint64_t));
+            for (int w = 0; w < words; w++)
+            {
+                for (uint64_t bits = cur[w]; bits != 0; bits &= bits - 1)
+                {
+                    const NfaState *s = &nfa->states[w * 64 + __builtin_ctzll(bits)];
+                    if (s->next >= 0 && set_has(&s->set, c))
+                    {
+                        next[s->next >> 6] |= 1ULL << (s->next & 63);
+                        alive = 1;
+                    }
+                }
+            }
+            if (!alive)
+            {
+                break;
+            }
+            closure(nfa, ps->stack, next);
+            if ((next[final >> 6] >> (final & 63)) & 1)
+            {
+                end = i + 1;
+            }
+            uint64_t *swap = cur;
+            cur = next;
+            next = swap;
+        }
+
+        if (end > 0)
+        {
+            found++;
+            from = end; // The next match starts after this one.
+        }
+        else
+        {
+            from++;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Counts the matches in a region of pattern `p` that ends at offset
+ *        `last`, inclusive, of which `buf` (starting at offset `base`) holds
+ *        the tail and `held` the bytes before it.
+ */
+static void close_region(PatternSet *ps, int p, long long last, const char *buf, long long base)
+{
+    long long first = ps->region_start[p];
+    if (first >= base)
+    {
+        ps->matches[p] += count_in_region(ps, p, buf + (first - base), (size_t)(last - first + 1));
+        return;
+    }
+
+    // The region began in an earlier buffer: put its tail after the held bytes.
+    size_t tail = (size_t)(last + 1 - base);
+    if (ps->held_len + tail > ps->held_cap)
+    {
+        size_t cap = ps->held_cap ? ps->held_cap : 4096;
+        while (cap < ps->held_len + tail)
+        {
+            cap *= 2;
+        }
+        char *held = realloc(ps->held, cap);
+        if (held == NULL)
+        {
+            ps->matches[p]++; // Out of memory: the region holds at least one match.
+            return;
+        }
+        ps->held = held;
+        ps->held_cap = cap;
+    }
+    if (tail > 0)
+    {
+        memcpy(ps->held + ps->held_len, buf, tail);
+    }
+    ps->matches[p] += count_in_region(ps, p, ps->held + (first - ps->held_start),
+                                      (size_t)(last - first + 1));
+}
+
+/**
+ * @brief Closes the regions of the patterns in `which` at offset `last`.
+ */
+static void close_regions(PatternSet *ps, uint64_t which, long long last, const char *buf,
+                          long long base)
+{
+    for (uint64_t bits = which & ps->matched; bits != 0; bits &= bits - 1)
+    {
+        close_region(ps, __builtin_ctzll(bits), last, buf, base);
+    }
+    ps->open &= ~which;
+    ps->matched &= ~which;
+}
+
+/**
+ * @brief Keeps the bytes of the still open regions for the next buffer.
+ */
+static void hold_open_regions(PatternSet *ps, const char *buf, size_t len, long long base)
+{
+    long long keep = base + (long long)len;
+    for (uint64_t bits = ps->open; bits != 0; bits &= bits - 1)
+    {
+        long long start = ps->region_start[__builtin_ctzll(bits)];
+        keep = start < keep ? start : keep;
+    }
+
+    // Drop held bytes that no open region needs any more.
+    if (ps->held_len > 0 && keep > ps->held_start)
+    {
+        size_t drop = (size_t)(keep - ps->held_start);
+        drop = drop < ps->held_len ? drop : ps->held_len;
+        memmove(ps->held, ps->held + drop, ps->held_len - drop);
+        ps->held_len -= drop;
+        ps->held_start += (long long)drop;
+    }
+    if (ps->held_len == 0)
+    {
+        ps->held_start = keep;
+    }
+
+    size_t from = (size_t)((keep > base ? keep : base) - base);
+    size_t need = ps->held_len + (len - from);
+    if (need > PATTERN_MAX_REGION)
+    {
+        // A region this long is cut: its matches are counted as it stands.
+        close_regions(ps, ps->open, base + (long long)len - 1, buf, base);
+        ps->held_len = 0;
+        return;
+    }
+    if (need > ps->held_cap)
+    {
+        size_t cap = ps->held_cap ? ps->held_cap : 4096;
+        while (cap < need)
+        {
+            cap *= 2;
+        }
+        char *held = realloc(ps->held, cap);
+        if (held == NULL)
+        {
+            close_regions(ps, ps->open, base + (long long)len - 1, buf, base);
+            ps->held_len = 0;
+            return;
+        }
+        ps->held = held;
+        ps->held_cap = cap;
+    }
+    memcpy(ps->held + ps->held_len, buf + from, len - from);
+    ps->held_len = need;
+}
+
+void scan_patterns(PatternSet *ps, const char *buf, size_t len)
+{
+    // Local copies keep the hot loop in registers.
+    const uint16_t *trans = ps->transitions;
+    const uint64_t *accepts = ps->accepts;
+    const uint64_t *pending = ps->pending;
+    uint16_t state = ps->state;
+    long long base = ps->offset;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        state = trans[((size_t)state << 8) | (unsigned char)buf[i]];
+        uint64_t live = pending[state] | accepts[state];
+        if ((live | ps->open) == 0)
+        {
+            continue; // No match in progress: the common case.
+        }
+
+        // A region opens where a pattern's first match attempt begins and
+        // closes at the byte after which none of its attempts is left.
+        long long at = base + (long long)i;
+        for (uint64_t bits = live & ~ps->open; bits != 0; bits &= bits - 1)
+        {
+            ps->region_start[__builtin_ctzll(bits)] = at;
+        }
+        ps->open |= live;
+        ps->matched |= accepts[state];
+        uint64_t ended = ps->open & ~pending[state];
+        if (ended != 0)
+        {
+            close_regions(ps, ended, at, buf, base);
+        }
+    }
+
+    ps->state = state;
+    ps->offset = base + (long long)len;
+    if (ps->open != 0)
+    {
+        hold_open_regions(ps, buf, len, base);
+    }
+    else
+    {
+        ps->held_len = 0;
+    }
+}
+
+static void pattern_on_buffer(void *ctx, const char *buf, size_t len)
+{
+    scan_patterns(ctx, buf, len);
+}
+
+/**
+ * @brief Counts the regions still open at the end of the input and restarts
+ *        the automaton, so that no match spans two inputs.
+ */
+static void pattern_on_finish(void *ctx)
+{
+    PatternSet *ps = ctx;
+    if (ps->open != 0)
+    {
+        // Every byte of the open regions is held; none comes from a buffer.
+        close_regions(ps, ps->open, ps->offset - 1, NULL, ps->offset);
+    }
+    ps->state = 0;
+    ps->offset = 0;
+    ps->held_len = 0;
+}
+
+void pattern_scan_hook(PatternSet *ps, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = pattern_on_buffer;
+    hook->on_finish = pattern_on_finish;
+    hook->ctx = ps;
+}
+
+void print_pattern_counts(const PatternSet *ps, FILE *output_stream)
+{
+    fprintf(output_stream, "  %-30s %s\n", "Pattern", "Count");
+    fprintf(output_stream, "  %-30s %s\n", "------------------------------", "-----");
+    for (int i = 0; i < ps->count; i++)
+    {
+        fprintf(output_stream, "  %-30s %lld\n", ps->sources[i], ps->matches[i]);
+    }
+}
+
+void free_pattern_set(PatternSet *ps)
+{
+    if (ps == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < ps->count; i++)
+    {
+        free(ps->sources[i]);
+    }
+    free(ps->transitions);
+    free(ps->accepts);
+    free(ps->pending);
+    if (ps->nfa != NULL)
+    {
+        free(ps->nfa->states);
+        free(ps->nfa);
+    }
+    free(ps->scratch);
+    free(ps->stack);
+    free(ps->held);
+    free(ps);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file pattern.h
+ * @brief Public interface for counting regular-expression matches.
+ *
+ * All patterns are compiled together into a single deterministic automaton
+ * (DFA), so finding where any number of patterns may match costs one table
+ * lookup per input byte, performed on the same buffers the analyzer's scan
+ * loop reads.
+ *
+ * Supported syntax: literals, `.`, bracket classes (`[a-z]`, `[^0-9]`),
+ * the escapes `\d \w \s \D \W \S \t \n \r \xHH` (any other escaped character
+ * is literal), grouping `( )`, alternation `|`, and the quantifiers
+ * `* + ? {n} {n,} {n,m}`. Patterns match anywhere in the input.
+ *
+ * Each pattern counts its non-overlapping, leftmost-longest matches, as a
+ * search that takes the longest match at the leftmost position and resumes
+ * after it would: `\d+` counts 1 in "12345", `a` counts 3 in "aaa", and
+ * `aba` counts 1 in "ababa". The DFA marks the regions in which a pattern
+ * has a match in progress; when one of them ends with a match in it, the
+ * pattern's own NFA finds the matches within that region. Regions longer
+ * than PATTERN_MAX_REGION bytes are cut there. Patterns that match the
+ * empty string are rejected, and no match spans two inputs.
+ */
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "analyzer.h"
+
+// The maximum number of patterns in one set (one bit each in a 64-bit mask).
+#define MAX_PATTERNS 64
+
+// The longest region of input held back for finding the matches in it.
+#define PATTERN_MAX_REGION (1 << 20)
+
+/**
+ * @struct PatternSet
+ * @brief A compiled set of patterns and the running match state.
+ */
+typedef struct
+{
+    int count;                         // Number of patterns in the set.
+    char *sources[MAX_PATTERNS];       // The patterns as given (for the report).
+    long long matches[MAX_PATTERNS];   // Number of matches of each pattern.
+    int state_count;                   // Number of DFA states.
+    uint16_t *transitions;             // state_count x 256 transition table.
+    uint64_t *accepts;                 // Per state: bit i set if pattern i matches here.
+    uint64_t *pending;                 // Per state: bit i set if a match of i is in progress.
+    uint16_t state;                    // Current DFA state.
+
+    struct Nfa *nfa;                   // The patterns' NFA, for finding matches in a region.
+    int starts[MAX_PATTERNS];          // NFA entry state of each pattern.
+    int finals[MAX_PATTERNS];          // NFA accepting state of each pattern.
+    uint64_t *scratch;                 // Two NFA state sets for the region search.
+    int *stack;                        // Scratch stack for epsilon closures.
+
+    long long offset;                  // Bytes scanned in the current input.
+    uint64_t open;                     // Patterns with an open region.
+    uint64_t matched;                  // Open regions in which a match has ended.
+    long long region_start[MAX_PATTERNS]; // Offset at which each open region began.
+    char *held;                        // Bytes of open regions from earlier buffers.
+    size_t held_len;
+    size_t held_cap;
+    long long held_start;              // Offset of held[0].
+} PatternSet;
+
+/**
+ * @brief Compiles a set of patterns into a single DFA.
+ * @param patterns An array of pattern strings.
+ * @param count The number of patterns (1 to MAX_PATTERNS).
+ * @return A pointer to the new PatternSet, or NULL on failure. A syntax
+ *         error or an automaton that grows too large is reported on stderr.
+ */
+PatternSet *compile_patterns(const char *const *patterns, int count);
+
+/**
+ * @brief Fills in a ScanHook that runs the DFA over every scanned buffer.
+ * @param ps A pointer to the PatternSet.
+ * @param hook The hook to fill in.
+ */
+void pattern_scan_hook(PatternSet *ps, ScanHook *hook);
+
+/**
+ * @brief Runs the DFA over a buffer, updating the match counts.
+ * @param ps A pointer to the PatternSet.
+ * @param buf The bytes to scan.
+ * @param len The number of bytes in `buf`.
+ */
+void scan_patterns(PatternSet *ps, const char *buf, size_t len);
+
+/**
+ * @brief Prints the pattern count table to the given stream.
+ * @param ps A pointer to the PatternSet.
+ * @param output_stream The stream to write to.
+ */
+void print_pattern_counts(const PatternSet *ps, FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with a PatternSet.
+ * @param ps A pointer to the PatternSet to be freed.
+ */
+void free_pattern_set(PatternSet *ps);
+
+#endif // PATTERN_H
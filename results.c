@@ -0,0 +1,481 @@
+/**
+ * @file results.c
+ * @brief Implementation of saved analysis results and their comparison.
+ *
+ * A results file is plain text, one record per line:
+ *
+ *     analyzer-results 1
+ *     totals <characters> <words> <lines>
+ *     chars <256 counts, by byte value>
+ *     vocab <distinct words>
+ *     <word> <count>          (one line per word, sorted with strcmp)
+ *
+ * The per-file cache stores its results in table order instead: bucket by
+ * bucket, each chain oldest word first. Adding them back to a table of the
+ * same size in that order rebuilds the chains exactly, so a report built
+ * from cached results lists its words in the same order as a fresh scan.
+ *
+ * Frequency words are lower-case letters only, so no quoting is needed.
+ * The relative change of a word is (after - before) / before; words that
+ * are new or gone have no finite relative change and are listed on their
+ * own instead.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "results.h"
+
+static const char RESULTS_MAGIC[] = "analyzer-results 1";
+
+/**
+ * @struct TopList
+ * @brief The best `cap` rows seen so far, kept sorted by descending score.
+ */
+typedef struct
+{
+    const char **word;
+    long long *before;
+    long long *after;
+    double *score;
+    int len;
+    int cap;
+} TopList;
+
+static int compare_nodes(const void *a, const void *b)
+{
+    return strcmp((*(Node *const *)a)->word, (*(Node *const *)b)->word);
+}
+
+int write_results(const AppStats *stats, FILE *file, bool sorted)
+{
+    const HashTable *ht = stats->word_counts;
+    size_t n = 0;
+    for (int b = 0; b < ht->size; b++)
+    {
+        for (Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            n++;
+        }
+    }
+    Node **words = malloc((n > 0 ? n : 1) * sizeof(Node *));
+    if (words == NULL)
+    {
+        return -1;
+    }
+    n = 0;
+    for (int b = 0; b < ht->size; b++)
+    {
+        size_t start = n;
+        for (Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            words[n++] = node;
+        }
+        for (size_t i = start, j = n; i + 1 < j; i++, j--)
+        {
+            Node *t = words[i]; // New words are pushed at the head: reverse the chain.
+            words[i] = words[j - 1];
+            words[j - 1] = t;
+        }
+    }
+    if (sorted)
+    {
+        qsort(words, n, sizeof(Node *), compare_nodes);
+    }
+
+    fprintf(file, "%s\n", RESULTS_MAGIC);
+    fprintf(file, "totals %lld %d %d\n", stats->char_count, stats->word_count, stats->line_count);
+    fprintf(file, "chars");
+    for (int c = 0; c < 256; c++)
+    {
+        fprintf(file, " %d", stats->char_freq[c]);
+    }
+    fprintf(file, "\nvocab %zu\n", n);
+    for (size_t i = 0; i < n; i++)
+    {
+        fprintf(file, "%s %d\n", words[i]->word, words[i]->count);
+    }
+    free(words);
+    return ferror(file) ? -1 : 0;
+}
+
+int save_results(const AppStats *stats, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+    {
+        perror("Error opening results file");
+        return -1;
+    }
+    int status = write_results(stats, file, true);
+    if ((fclose(file) != 0) | (status != 0))
+    {
+        perror("Error writing results file");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses a non-negative integer at *p and advances past it and any
+ *        following blanks.
+ * @return 0 on success, -1 if there is no number.
+ */
+static int parse_number(char **p, long long *value)
+{
+    char *end;
+    errno = 0;
+    *value = strtoll(*p, &end, 10);
+    if (end == *p || errno != 0 || *value < 0)
+    {
+        return -1;
+    }
+    while (*end == ' ')
+    {
+        end++;
+    }
+    *p = end;
+    return 0;
+}
+
+/**
+ * @brief Checks that *p starts with `word` followed by a space, and skips both.
+ */
+static int expect(char **p, const char *word)
+{
+    size_t len = strlen(word);
+    if (strncmp(*p, word, len) != 0 || (*p)[len] != ' ')
+    {
+        return -1;
+    }
+    *p += len + 1;
+    return 0;
+}
+
+/**
+ * @brief Parses the text of a results file into `r`.
+ * @return 0 on success, -1 if it is malformed.
+ */
+static int parse_results(Results *r, bool sorted)
+{
+    char *p = r->text;
+    size_t magic_len = strlen(RESULTS_MAGIC);
+    if (strncmp(p, RESULTS_MAGIC, magic_len) != 0 || p[magic_len] != '\n')
+    {
+        return -1;
+    }
+    p += magic_len + 1;
+
+    if (expect(&p, "totals") != 0 || parse_number(&p, &r->chars) != 0 ||
+        parse_number(&p, &r->words) != 0 || parse_number(&p, &r->lines) != 0 || *p++ != '\n')
+    {
+        return -1;
+    }
+    if (expect(&p, "chars") != 0)
+    {
+        return -1;
+    }
+    for (int c = 0; c < 256; c++)
+    {
+        if (parse_number(&p, &r->char_freq[c]) != 0)
+        {
+            return -1;
+        }
+    }
+    long long count;
+    if (*p++ != '\n' || expect(&p, "vocab") != 0 || parse_number(&p, &count) != 0 ||
+        *p++ != '\n')
+    {
+        return -1;
+    }
+
+    r->vocab = malloc((count > 0 ? (size_t)count : 1) * sizeof(ResultWord));
+    if (r->vocab == NULL)
+    {
+        return -1;
+    }
+    for (long long i = 0; i < count; i++)
+    {
+        char *word = p;
+        while (islower((unsigned char)*p))
+        {
+            p++;
+        }
+        if (p == word || *p != ' ')
+        {
+            return -1;
+        }
+        *p++ = '\0';
+        long long n;
+        if (parse_number(&p, &n) != 0 || *p++ != '\n')
+        {
+            return -1;
+        }
+        if (sorted && i > 0 && strcmp(r->vocab[i - 1].word, word) >= 0)
+        {
+            return -1; // The merge relies on the order.
+        }
+        r->vocab[i].word = word;
+        r->vocab[i].count = n;
+    }
+    r->vocab_count = (size_t)count;
+    return 0;
+}
+
+Results *read_results(FILE *file, bool sorted)
+{
+    Results *r = calloc(1, sizeof(Results));
+    size_t size = 0, cap = 1 << 16;
+    char *text = malloc(cap);
+    while (r != NULL && text != NULL)
+    {
+        size += fread(text + size, 1, cap - size - 1, file);
+        if (size < cap - 1)
+        {
+            break;
+        }
+        char *bigger = realloc(text, cap * 2);
+        if (bigger == NULL)
+        {
+            free(text);
+            text = NULL;
+            break;
+        }
+        text = bigger;
+        cap *= 2;
+    }
+    if (r == NULL || text == NULL || ferror(file))
+    {
+        free(text);
+        free(r);
+        return NULL;
+    }
+    text[size] = '\0';
+    r->text = text;
+
+    if (parse_results(r, sorted) != 0)
+    {
+        free_results(r);
+        return NULL;
+    }
+    return r;
+}
+
+Results *load_results(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        perror("Error opening results file");
+        return NULL;
+    }
+    Results *r = read_results(file, true);
+    fclose(file);
+    if (r == NULL)
+    {
+        fprintf(stderr, "Error: %s is not a results file saved with --save.\n", path);
+    }
+    return r;
+}
+
+void add_results(AppStats *stats, const Results *results)
+{
+    stats->char_count += results->chars;
+    stats->word_count += (int)results->words;
+    stats->line_count += (int)results->lines;
+    for (int c = 0; c < 256; c++)
+    {
+        stats->char_freq[c] += (int)results->char_freq[c];
+    }
+    for (size_t i = 0; i < results->vocab_count; i++)
+    {
+        add_word_count(stats->word_counts, results->vocab[i].word, (int)results->vocab[i].count);
+    }
+}
+
+static int init_top(TopList *list, int cap)
+{
+    list->len = 0;
+    list->cap = cap;
+    list->word = malloc((size_t)cap * sizeof(const char *));
+    list->before = malloc((size_t)cap * sizeof(long long));
+    list->after = malloc((size_t)cap * sizeof(long long));
+    list->score = malloc((size_t)cap * sizeof(double));
+    return list->word != NULL && list->before != NULL && list->after != NULL &&
+                   list->score != NULL
+               ? 0
+               : -1;
+}
+
+static void free_top(TopList *list)
+{
+    free(list->word);
+    free(list->before);
+    free(list->after);
+    free(list->score);
+}
+
+/**
+ * @brief Offers a row to the list; it is kept if it is among the best.
+ */
+static void offer(TopList *list, const char *word, long long before, long long after, double score)
+{
+    if (list->len == list->cap && list->score[list->len - 1] >= score)
+    {
+        return;
+    }
+    int i = (list->len < list->cap) ? list->len++ : list->cap - 1;
+    while (i > 0 && list->score[i - 1] < score)
+    {
+        list->word[i] = list->word[i - 1];
+        list->before[i] = list->before[i - 1];
+        list->after[i] = list->after[i - 1];
+        list->score[i] = list->score[i - 1];
+        i--;
+    }
+    list->word[i] = word;
+    list->before[i] = before;
+    list->after[i] = after;
+    list->score[i] = score;
+}
+
+/**
+ * @brief Prints "before -> after (+delta, +x.x%)" for a total.
+ */
+static void print_total(const char *label, long long before, long long after, FILE *output_stream)
+{
+    fprintf(output_stream, "%-12s%lld -> %lld (%+lld", label, before, after, after - before);
+    if (before > 0)
+    {
+        fprintf(output_stream, ", %+.1f%%", 100.0 * (double)(after - before) / (double)before);
+    }
+    fprintf(output_stream, ")\n");
+}
+
+void print_results_diff(const Results *before, const Results *after, const DiffOptions *options,
+                        FILE *output_stream)
+{
+    int top = options->top > 0 ? options->top : 1;
+    TopList changed, appeared, vanished, chars;
+    int failed = init_top(&changed, top); // Initialize all four, so all four can be freed.
+    failed |= init_top(&appeared, top);
+    failed |= init_top(&vanished, top);
+    failed |= init_top(&chars, top);
+    if (failed)
+    {
+        fprintf(stderr, "Error: Not enough memory to compare the results.\n");
+        free_top(&changed);
+        free_top(&appeared);
+        free_top(&vanished);
+        free_top(&chars);
+        return;
+    }
+
+    // One merge of the two sorted vocabularies classifies every word.
+    size_t i = 0, j = 0;
+    long long new_words = 0, gone_words = 0, changed_words = 0;
+    while (i < before->vocab_count || j < after->vocab_count)
+    {
+        int cmp = i == before->vocab_count  ? 1
+                  : j == after->vocab_count ? -1
+                                            : strcmp(before->vocab[i].word, after->vocab[j].word);
+        const char *word = cmp <= 0 ? before->vocab[i].word : after->vocab[j].word;
+        long long a = cmp <= 0 ? before->vocab[i++].count : 0;
+        long long b = cmp >= 0 ? after->vocab[j++].count : 0;
+        if (a < options->min_count && b < options->min_count)
+        {
+            continue;
+        }
+        if (a == 0)
+        {
+            new_words++;
+            offer(&appeared, word, a, b, (double)b);
+        }
+        else if (b == 0)
+        {
+            gone_words++;
+            offer(&vanished, word, a, b, (double)a);
+        }
+        else if (a != b)
+        {
+            changed_words++;
+            double delta = (double)(b - a);
+            offer(&changed, word, a, b, fabs(options->relative ? delta / (double)a : delta));
+        }
+    }
+
+    char names[256][2];
+    for (int c = 0; c < 256; c++)
+    {
+        long long a = before->char_freq[c], b = after->char_freq[c];
+        names[c][0] = (char)c;
+        names[c][1] = '\0';
+        if (a != b && isprint(c))
+        {
+            offer(&chars, names[c], a, b, fabs((double)(b - a)));
+        }
+    }
+
+    fprintf(output_stream, "Totals:\n");
+    print_total("Characters:", before->chars, after->chars, output_stream);
+    print_total("Words:", before->words, after->words, output_stream);
+    print_total("Lines:", before->lines, after->lines, output_stream);
+    print_total("Vocabulary:", (long long)before->vocab_count, (long long)after->vocab_count,
+                output_stream);
+    fprintf(output_stream, "%-12s%lld new, %lld gone, %lld changed\n", "", new_words, gone_words,
+            changed_words);
+
+    fprintf(output_stream, "\nLargest Changes (%s):\n", options->relative ? "relative" : "absolute");
+    fprintf(output_stream, "  %-20s %-10s %-10s %s\n", "Word", "Before", "After", "Change");
+    fprintf(output_stream, "  %-20s %-10s %-10s %s\n", "--------------------", "------", "-----",
+            "------");
+    for (int k = 0; k < changed.len; k++)
+    {
+        long long a = changed.before[k], b = changed.after[k];
+        fprintf(output_stream, "  %-20s %-10lld %-10lld %+lld (%+.1f%%)\n", changed.word[k], a, b,
+                b - a, 100.0 * (double)(b - a) / (double)a);
+    }
+
+    fprintf(output_stream, "\nNew Words:\n");
+    fprintf(output_stream, "  %-20s %s\n", "Word", "Count");
+    fprintf(output_stream, "  %-20s %s\n", "--------------------", "-----");
+    for (int k = 0; k < appeared.len; k++)
+    {
+        fprintf(output_stream, "  %-20s %lld\n", appeared.word[k], appeared.after[k]);
+    }
+
+    fprintf(output_stream, "\nGone Words:\n");
+    fprintf(output_stream, "  %-20s %s\n", "Word", "Count");
+    fprintf(output_stream, "  %-20s %s\n", "--------------------", "-----");
+    for (int k = 0; k < vanished.len; k++)
+    {
+        fprintf(output_stream, "  %-20s %lld\n", vanished.word[k], vanished.before[k]);
+    }
+
+    fprintf(output_stream, "\nCharacter Frequency Changes:\n");
+    fprintf(output_stream, "  %-20s %-10s %-10s %s\n", "Character", "Before", "After", "Change");
+    fprintf(output_stream, "  %-20s %-10s %-10s %s\n", "---------", "------", "-----", "------");
+    for (int k = 0; k < chars.len; k++)
+    {
+        long long a = chars.before[k], b = chars.after[k];
+        fprintf(output_stream, "  '%s'%-17s %-10lld %-10lld %+lld\n", chars.word[k], "", a, b, b - a);
+    }
+
+    free_top(&changed);
+    free_top(&appeared);
+    free_top(&vanished);
+    free_top(&chars);
+}
+
+void free_results(Results *results)
+{
+    if (results == NULL)
+    {
+        return;
+    }
+    free(results->vocab);
+    free(results->text);
+    free(results);
+}
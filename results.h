@@ -0,0 +1,106 @@
+/**
+ * @file results.h
+ * @brief Public interface for saved analysis results and their comparison.
+ *
+ * `--save` writes the totals, the character histogram and the vocabulary,
+ * sorted by word, to a small text file. `--diff a.res b.res` loads two such
+ * files and compares them with a single merge of the sorted vocabularies:
+ * per-word deltas, words that appeared or disappeared, the largest changes
+ * by absolute or relative size, and the character histogram differences.
+ */
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "analyzer.h"
+
+/**
+ * @struct ResultWord
+ * @brief One vocabulary entry of a loaded results file.
+ */
+typedef struct
+{
+    const char *word;
+    long long count;
+} ResultWord;
+
+/**
+ * @struct Results
+ * @brief A loaded results file.
+ */
+typedef struct
+{
+    long long chars, words, lines;
+    long long char_freq[256];
+    ResultWord *vocab;  // Sorted by word, or in table order.
+    size_t vocab_count;
+    char *text;         // The file contents; the words point into it.
+} Results;
+
+/**
+ * @struct DiffOptions
+ * @brief What a comparison lists.
+ */
+typedef struct
+{
+    int top;             // Rows per list.
+    int relative;        // Rank changes by relative rather than absolute size.
+    long long min_count; // Ignore words below this count in both results.
+} DiffOptions;
+
+/**
+ * @brief Writes the results of an analysis to an open stream.
+ * @param sorted Whether to write the vocabulary sorted by word (as --diff
+ *        needs) or in table order (see add_results()).
+ * @return 0 on success, -1 on failure (nothing is reported).
+ */
+int write_results(const AppStats *stats, FILE *file, bool sorted);
+
+/**
+ * @brief Writes the results of an analysis to a file.
+ * @return 0 on success, -1 on failure.
+ */
+int save_results(const AppStats *stats, const char *path);
+
+/**
+ * @brief Reads results written by write_results() from the current
+ *        position of a stream to its end.
+ * @param sorted Whether the vocabulary must be sorted by word.
+ * @return The results, or NULL if they cannot be read or parsed (nothing
+ *         is reported).
+ */
+Results *read_results(FILE *file, bool sorted);
+
+/**
+ * @brief Loads a results file written by save_results().
+ * @return The results, or NULL if the file cannot be read or parsed.
+ */
+Results *load_results(const char *path);
+
+/**
+ * @brief Adds loaded results to the statistics of an analysis, as if the
+ *        input they were saved from had been analyzed again.
+ *
+ * Results in table order, added to a table of the size they were written
+ * from, leave its chains exactly as a fresh analysis would.
+ */
+void add_results(AppStats *stats, const Results *results);
+
+/**
+ * @brief Prints the differences between two results.
+ * @param before The older results.
+ * @param after The newer results.
+ * @param options What to list.
+ * @param output_stream The stream to write to.
+ */
+void print_results_diff(const Results *before, const Results *after, const DiffOptions *options,
+                        FILE *output_stream);
+
+/**
+ * @brief Frees loaded results.
+ */
+void free_results(Results *results);
+
+#endif // RESULTS_H
@@ -0,0 +1,58 @@
+/**
+ * @file sample.h
+ * @brief Public interface for sampled analysis of very large files.
+ *
+ * Instead of reading a whole file, the file is divided into equal strata
+ * and one block at a random position inside each stratum is read with
+ * pread(). The blocks go through the normal scan loop, so the frequency
+ * tables and modules see a representative slice of the file, and the
+ * per-block word and line counts are extrapolated to the whole file with a
+ * ratio estimator and a 95% confidence interval.
+ */
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include "analyzer.h"
+#include "outbuf.h"
+
+// The size of each sampled block.
+#define SAMPLE_BLOCK_SIZE 65536
+
+/**
+ * @struct SampleEstimate
+ * @brief Extrapolated counts, accumulated over every sampled file.
+ */
+typedef struct
+{
+    double fraction;        // Requested share of each file to read.
+    long long total_bytes;  // Size of all files (exact).
+    long long sampled_bytes; // Bytes actually scanned.
+    long long blocks;       // Blocks read.
+    int full_files;         // Files small enough to be read completely.
+    double words;           // Estimated total words.
+    double words_var;       // Variance of that estimate.
+    double lines;           // Estimated total lines.
+    double lines_var;       // Variance of that estimate.
+} SampleEstimate;
+
+/**
+ * @brief Analyzes a sample of a file and adds its extrapolated counts.
+ *
+ * Files whose sample would cover most of the file are simply analyzed in
+ * full, and then contribute exact counts with zero variance.
+ *
+ * @param stats The AppStats to feed; `filename` names the file to sample.
+ * @param estimate The estimate to add this file's contribution to.
+ * @return 0 on success, -1 on failure (including non-regular files).
+ */
+int sample_file(AppStats *stats, SampleEstimate *estimate);
+
+/**
+ * @brief Prints the extrapolated counts with their confidence intervals.
+ * @param estimate A pointer to the SampleEstimate.
+ * @param out The report being written.
+ */
+void print_sample_estimate(const SampleEstimate *estimate, OutBuf *out);
+
+#endif // SAMPLE_H
@@ -0,0 +1,164 @@
+/**
+ * @file sniff.c
+ * @brief Implementation of text/binary content sniffing.
+ *
+ * Most text is plain ASCII, so the block is first scanned 16 bytes at a
+ * time (SSE2 where available): a chunk with no high bit set and no byte
+ * below 0x20 needs no further checks. Only the chunks that contain such
+ * bytes are walked one byte at a time, decoding UTF-8 and counting NULs
+ * and control characters.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "sniff.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// A block is binary if more than 1/CONTROL_RATIO of it is control characters
+// or more than 1/INVALID_RATIO of it is malformed UTF-8.
+#define CONTROL_RATIO 10
+#define INVALID_RATIO 10
+
+/**
+ * @brief Returns the length of the well-formed UTF-8 sequence at p, or 0 if
+ *        it is malformed. A sequence cut off by the end of the block counts
+ *        as well-formed.
+ */
+static size_t utf8_sequence(const unsigned char *p, size_t avail)
+{
+    unsigned char c = p[0];
+    size_t len;
+    unsigned char lo = 0x80, hi = 0xBF; // Allowed range of the second byte.
+    if (c >= 0xC2 && c <= 0xDF)
+    {
+        len = 2;
+    }
+    else if (c >= 0xE0 && c <= 0xEF)
+    {
+        len = 3;
+        lo = (c == 0xE0) ? 0xA0 : 0x80; // No overlong forms.
+        hi = (c == 0xED) ? 0x9F : 0xBF; // No surrogates.
+    }
+    else if (c >= 0xF0 && c <= 0xF4)
+    {
+        len = 4;
+        lo = (c == 0xF0) ? 0x90 : 0x80;
+        hi = (c == 0xF4) ? 0x8F : 0xBF; // Nothing above U+10FFFF.
+    }
+    else
+    {
+        return 0;
+    }
+
+    for (size_t i = 1; i < len; i++)
+    {
+        if (i >= avail)
+        {
+            return avail; // Truncated by the block boundary.
+        }
+        unsigned char min = (i == 1) ? lo : 0x80, max = (i == 1) ? hi : 0xBF;
+        if (p[i] < min || p[i] > max)
+        {
+            return 0;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Returns the offset of the first byte at or after `i` that is not
+ *        printable ASCII (below 0x20 or above 0x7E), or `len`.
+ */
+static size_t skip_plain_ascii(const unsigned char *p, size_t i, size_t len)
+{
+#if defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i low = _mm_set1_epi8((char)(0x20 ^ 0x80));
+    const __m128i high = _mm_set1_epi8((char)(0x7E ^ 0x80));
+    for (; i + 16 <= len; i += 16)
+    {
+        // Flip the sign bit so the signed compares order bytes as unsigned.
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p + i)), bias);
+        __m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, low), _mm_cmpgt_epi8(v, high));
+        int mask = _mm_movemask_epi8(bad);
+        if (mask != 0)
+        {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+#endif
+    while (i < len && p[i] >= 0x20 && p[i] <= 0x7E)
+    {
+        i++;
+    }
+    return i;
+}
+
+void sniff_content(const char *buf, size_t len, SniffResult *result)
+{
+    const unsigned char *p = (const unsigned char *)buf;
+    memset(result, 0, sizeof(*result));
+    result->bytes = len;
+
+    size_t i = 0;
+    while ((i = skip_plain_ascii(p, i, len)) < len)
+    {
+        unsigned char c = p[i];
+        if (c >= 0x80)
+        {
+            size_t n = utf8_sequence(p + i, len - i);
+            if (n == 0)
+            {
+                result->invalid_utf8++;
+                n = 1;
+            }
+            i += n;
+            continue;
+        }
+        if (c == 0)
+        {
+            result->nul_bytes++;
+        }
+        else if (c < 0x20 && c != '\n' && c != '\r' && c != '\t' && c != '\f' && c != '\v' &&
+                 c != '\b' && c != 0x1B)
+        {
+            result->control++;
+        }
+        else if (c == 0x7F)
+        {
+            result->control++;
+        }
+        i++;
+    }
+
+    result->is_binary = result->nul_bytes > 0 || result->control * CONTROL_RATIO > len ||
+                        result->invalid_utf8 * INVALID_RATIO > len;
+}
+
+ssize_t read_sniff_block(int fd, char *buf, size_t have, size_t want)
+{
+    while (have < want)
+    {
+        ssize_t n = read(fd, buf + have, want - have);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            return -1;
+        }
+        if (n == 0)
+        {
+            break; // The input is shorter than a block.
+        }
+        have += (size_t)n;
+    }
+    return (ssize_t)have;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file sniff.h
+ * @brief Public interface for text/binary content sniffing.
+ *
+ * The first block of every input is checked before it is analyzed. Text
+ * (ASCII, UTF-8 or a legacy 8-bit encoding) contains no NUL bytes, few
+ * control characters and, if it is UTF-8, well-formed multi-byte sequences.
+ * Executables, archives, images and compressed data fail these tests almost
+ * immediately, so a multi-gigabyte blob can be recognized from its first
+ * few kilobytes.
+ */
+
+#ifndef SNIFF_H
+#define SNIFF_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Bytes of an input examined before it is classified.
+#define SNIFF_BYTES 65536
+
+/**
+ * @struct SniffResult
+ * @brief What was found in the sniffed block.
+ */
+typedef struct
+{
+    size_t bytes;        // Bytes examined.
+    size_t nul_bytes;    // NUL (0x00) bytes.
+    size_t control;      // Control characters other than common whitespace and ESC.
+    size_t invalid_utf8; // Bytes that are not part of a well-formed UTF-8 sequence.
+    int is_binary;       // Non-zero if the block does not look like text.
+} SniffResult;
+
+/**
+ * @brief Classifies a block of input as text or binary.
+ * @param buf The first bytes of the input.
+ * @param len The number of bytes in `buf`.
+ * @param result Receives the counts and the verdict.
+ */
+void sniff_content(const char *buf, size_t len, SniffResult *result);
+
+/**
+ * @brief Reads until a buffer holds `want` bytes or the input ends.
+ *
+ * A pipe may deliver a few bytes per read(), too few to classify, so the
+ * first block of a stream is collected with this before it is sniffed.
+ *
+ * @param fd The input.
+ * @param buf The buffer, which already holds `have` bytes.
+ * @param have The bytes already in `buf`.
+ * @param want The bytes wanted in `buf` in all.
+ * @return The bytes now in `buf`, or -1 on a read error (with errno set).
+ */
+ssize_t read_sniff_block(int fd, char *buf, size_t have, size_t want);
+
+#endif // SNIFF_H
@@ -0,0 +1,30 @@
+# Follow a log while it is truncated, appended to and rotated; each step
+# waits long enough for the analyzer to catch up.
+printf 'one two\nthree four\nfive\n' > app.log
+"$A" --follow --interval 1 --window-lines 2 app.log > windows.out 2> windows.err &
+pid=$!
+sleep 1
+: > app.log
+sleep 1
+printf 'six seven\neight\nnine ten\n' >> app.log
+sleep 1
+kill -TERM $pid
+wait $pid
+echo "[exit $?]"
+cat windows.out windows.err
+
+# The final report covers the truncated file's new contents and, after a
+# rotation, carries on with the new file.
+printf 'alpha beta\ngamma\n' > app.log
+"$A" --follow --interval 1 -c --tfidf -o report.out app.log 2> report.err &
+pid=$!
+sleep 1
+printf 'delta\n' > app.log
+sleep 1
+mv app.log app.log.1
+printf 'epsilon zeta\n' > app.log
+sleep 1
+kill -TERM $pid
+wait $pid
+echo "[exit $?]"
+cat report.out report.err
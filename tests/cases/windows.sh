@@ -0,0 +1,6 @@
+# Every 3 lines, a sliding aggregate over the last 2 windows.
+$A --window-lines 3 --window-span 2 --window-top 2 edge_cases.txt
+# One window holding more distinct words than the tables start with.
+awk 'BEGIN { for (i = 0; i < 5000; i++) print "w" i, (i % 3 == 0) ? "x" i : "" }' |
+    tr '0-9' 'a-j' > many.txt
+$A --window-lines 4000 --window-span 2 --window-top 3 many.txt
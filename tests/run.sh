@@ -0,0 +1,53 @@
+#!/bin/sh
+# Runs the golden-output tests: `sh tests/run.sh <analyzer>` (or `make check`).
+#
+# Every tests/cases/<name>.sh is run by sh in a scratch directory holding a
+# copy of tests/data and the sample texts, with $A naming the analyzer. Its
+# standard output, standard error and the exit status of each command are
+# compared with tests/expected/<name>.out. Set UPDATE=1 to rewrite the
+# expected files from the current output instead.
+
+if [ $# -ne 1 ]; then
+    echo "Usage: $0 <analyzer>" >&2
+    exit 2
+fi
+
+tests=$(cd "$(dirname "$0")" && pwd)
+A=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+export A
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/analyzer-check.XXXXXX") || exit 2
+trap 'rm -rf "$work"' EXIT INT TERM
+
+passed=0
+failed=0
+for case in "$tests"/cases/*.sh; do
+    name=$(basename "$case" .sh)
+    dir="$work/$name"
+    mkdir "$dir"
+    cp "$tests"/../edge_cases.txt "$tests"/../test.txt "$dir"/
+    if [ -d "$tests/data" ]; then
+        cp "$tests"/data/* "$dir"/
+    fi
+
+    # Each command's exit status follows its output, and errors go to the
+    # same stream so that they are checked in place.
+    (cd "$dir" && sed -e '/^\$A /s/$/; echo "[exit $?]"/' "$case" | sh 2>&1) > "$work/$name.out"
+
+    expected="$tests/expected/$name.out"
+    if [ -n "$UPDATE" ]; then
+        cp "$work/$name.out" "$expected"
+        echo "updated $name"
+    elif diff -u "$expected" "$work/$name.out" > "$work/$name.diff"; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL $name"
+        cat "$work/$name.diff"
+        failed=$((failed + 1))
+    fi
+done
+
+if [ -z "$UPDATE" ]; then
+    echo "$passed passed, $failed failed"
+fi
+[ "$failed" -eq 0 ]
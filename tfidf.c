@@ -0,0 +1,282 @@
+/**
+ * @file tfidf.c
+ * @brief Implementation of document frequency and TF-IDF across files.
+ *
+ * The per-document state (tf counts and seen bits) is indexed by word ID and
+ * only the entries in the `touched` list are cleared at the end of a
+ * document, so closing a document costs time proportional to its own
+ * vocabulary rather than to the corpus vocabulary.
+ *
+ * Scores use the smoothed inverse document frequency
+ *   idf = ln((1 + N) / (1 + df)) + 1
+ * so a word found in every document still gets a small positive weight and
+ * a single-file run ranks terms by frequency instead of printing zeros.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tfidf.h"
+
+TfidfStats *create_tfidf_stats(int top)
+{
+    TfidfStats *ts = calloc(1, sizeof(TfidfStats));
+    if (ts == NULL)
+    {
+        return NULL;
+    }
+    ts->words = create_interner();
+    if (ts->words == NULL)
+    {
+        free(ts);
+        return NULL;
+    }
+    ts->top = top;
+    return ts;
+}
+
+/**
+ * @brief Grows the ID-indexed arrays so that `id` is a valid index.
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int ensure_id(TfidfStats *ts, uint32_t id)
+{
+    if (id < ts->id_cap)
+    {
+        return 0;
+    }
+    uint32_t cap = ts->id_cap ? ts->id_cap : 1024;
+    while (cap <= id)
+    {
+        cap *= 2;
+    }
+
+    uint32_t *df = realloc(ts->df, cap * sizeof(uint32_t));
+    if (df == NULL)
+    {
+        return -1;
+    }
+    ts->df = df;
+    uint32_t *tf = realloc(ts->tf, cap * sizeof(uint32_t));
+    if (tf == NULL)
+    {
+        return -1;
+    }
+    ts->tf = tf;
+    uint64_t *seen = realloc(ts->seen, cap / 64 * sizeof(uint64_t));
+    if (seen == NULL)
+    {
+        return -1;
+    }
+    ts->seen = seen;
+
+    memset(ts->df + ts->id_cap, 0, (cap - ts->id_cap) * sizeof(uint32_t));
+    memset(ts->tf + ts->id_cap, 0, (cap - ts->id_cap) * sizeof(uint32_t));
+    memset(ts->seen + ts->id_cap / 64, 0, (cap - ts->id_cap) / 64 * sizeof(uint64_t));
+    ts->id_cap = cap;
+    return 0;
+}
+
+void add_tfidf_word(TfidfStats *ts, const char *word)
+{
+    uint32_t id = intern_word(ts->words, word);
+    if (id == INTERN_FAILED || ensure_id(ts, id) != 0)
+    {
+        ts->failed = 1;
+        return;
+    }
+    ts->tokens++;
+
+    uint64_t bit = 1ULL << (id & 63);
+    if (!(ts->seen[id >> 6] & bit))
+    {
+        // First occurrence in this document.
+        if (ts->touched_count == ts->touched_cap)
+        {
+            uint32_t cap = ts->touched_cap ? ts->touched_cap * 2 : 1024;
+            uint32_t *touched = realloc(ts->touched, cap * sizeof(uint32_t));
+            if (touched == NULL)
+            {
+                ts->failed = 1;
+                return;
+            }
+            ts->touched = touched;
+            ts->touched_cap = cap;
+        }
+        ts->seen[id >> 6] |= bit;
+        ts->touched[ts->touched_count++] = id;
+        ts->df[id]++;
+    }
+    ts->tf[id]++;
+}
+
+void end_tfidf_document(TfidfStats *ts)
+{
+    if (ts->doc_count == ts->doc_cap)
+    {
+        int cap = ts->doc_cap ? ts->doc_cap * 2 : 16;
+        DocTerms *docs = realloc(ts->docs, (size_t)cap * sizeof(DocTerms));
+        if (docs == NULL)
+        {
+            ts->failed = 1;
+            return;
+        }
+        ts->docs = docs;
+        ts->doc_cap = cap;
+    }
+
+    DocTerms *doc = &ts->docs[ts->doc_count++];
+    doc->tokens = ts->tokens;
+    doc->term_count = 0;
+    doc->terms = malloc((ts->touched_count > 0 ? ts->touched_count : 1) * sizeof(TermCount));
+    if (doc->terms == NULL)
+    {
+        ts->failed = 1;
+    }
+
+    for (uint32_t i = 0; i < ts->touched_count; i++)
+    {
+        uint32_t id = ts->touched[i];
+        if (doc->terms != NULL)
+        {
+            doc->terms[doc->term_count].id = id;
+            doc->terms[doc->term_count].count = ts->tf[id];
+            doc->term_count++;
+        }
+        ts->tf[id] = 0;
+        ts->seen[id >> 6] &= ~(1ULL << (id & 63));
+    }
+    ts->touched_count = 0;
+    ts->tokens = 0;
+}
+
+static void tfidf_on_word(void *ctx, const char *word)
+{
+    add_tfidf_word(ctx, word);
+}
+
+static void tfidf_on_finish(void *ctx)
+{
+    end_tfidf_document(ctx);
+}
+
+void tfidf_scan_hook(TfidfStats *ts, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_word = tfidf_on_word;
+    hook->on_finish = tfidf_on_finish;
+    hook->ctx = ts;
+}
+
+void print_tfidf_stats(const TfidfStats *ts, const char *const *filenames, int file_count,
+                       FILE *output_stream)
+{
+    int top_n = ts->top > 0 ? ts->top : 1;
+    uint32_t *best = malloc((size_t)top_n * sizeof(uint32_t));
+    double *score = malloc((size_t)top_n * sizeof(double));
+    if (best == NULL || score == NULL)
+    {
+        free(best);
+        free(score);
+        return;
+    }
+
+    fprintf(output_stream, "Documents:\t\t%d\n", ts->doc_count);
+    fprintf(output_stream, "Vocabulary:\t\t%u\n", ts->words->count);
+    if (ts->failed)
+    {
+        fprintf(output_stream, "Warning: Ran out of memory; the figures below are incomplete.\n");
+    }
+
+    // Words found in the most documents.
+    int len = 0;
+    for (uint32_t id = 0; id < ts->words->count && id < ts->id_cap; id++)
+    {
+        if (len == top_n && score[len - 1] >= ts->df[id])
+        {
+            continue;
+        }
+        int i = (len < top_n) ? len++ : top_n - 1;
+        while (i > 0 && score[i - 1] < ts->df[id])
+        {
+            best[i] = best[i - 1];
+            score[i] = score[i - 1];
+            i--;
+        }
+        best[i] = id;
+        score[i] = ts->df[id];
+    }
+    fprintf(output_stream, "\nHighest Document Frequency:\n");
+    fprintf(output_stream, "  %-20s %-10s %s\n", "Word", "Documents", "Share");
+    fprintf(output_stream, "  %-20s %-10s %s\n", "--------------------", "---------", "-----");
+    for (int i = 0; i < len; i++)
+    {
+        fprintf(output_stream, "  %-20s %-10u %.1f%%\n", interned_word(ts->words, best[i]),
+                ts->df[best[i]], 100.0 * ts->df[best[i]] / (ts->doc_count > 0 ? ts->doc_count : 1));
+    }
+
+    // Top TF-IDF terms of each document.
+    double n = ts->doc_count;
+    for (int d = 0; d < ts->doc_count; d++)
+    {
+        const DocTerms *doc = &ts->docs[d];
+        len = 0;
+        for (uint32_t t = 0; t < doc->term_count; t++)
+        {
+            const TermCount *term = &doc->terms[t];
+            double idf = log((1.0 + n) / (1.0 + ts->df[term->id])) + 1.0;
+            double s = ((double)term->count / (double)doc->tokens) * idf;
+            if (len == top_n && score[len - 1] >= s)
+            {
+                continue;
+            }
+            int i = (len < top_n) ? len++ : top_n - 1;
+            while (i > 0 && score[i - 1] < s)
+            {
+                best[i] = best[i - 1];
+                score[i] = score[i - 1];
+                i--;
+            }
+            best[i] = t;
+            score[i] = s;
+        }
+
+        fprintf(output_stream, "\n%s (%lld words, %u distinct):\n",
+                d < file_count ? filenames[d] : "?", doc->tokens, doc->term_count);
+        if (len == 0)
+        {
+            continue;
+        }
+        fprintf(output_stream, "  %-20s %-8s %-8s %s\n", "Term", "Count", "Docs", "TF-IDF");
+        fprintf(output_stream, "  %-20s %-8s %-8s %s\n", "--------------------", "-----", "----",
+                "------");
+        for (int i = 0; i < len; i++)
+        {
+            const TermCount *term = &doc->terms[best[i]];
+            fprintf(output_stream, "  %-20s %-8u %-8u %.4f\n", interned_word(ts->words, term->id),
+                    term->count, ts->df[term->id], score[i]);
+        }
+    }
+
+    free(best);
+    free(score);
+}
+
+void free_tfidf_stats(TfidfStats *ts)
+{
+    if (ts == NULL)
+    {
+        return;
+    }
+    for (int d = 0; d < ts->doc_count; d++)
+    {
+        free(ts->docs[d].terms);
+    }
+    free(ts->docs);
+    free(ts->df);
+    free(ts->tf);
+    free(ts->seen);
+    free(ts->touched);
+    free_interner(ts->words);
+    free(ts);
+}
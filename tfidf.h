@@ -0,0 +1,112 @@
+/**
+ * @file tfidf.h
+ * @brief Public interface for document frequency and TF-IDF across files.
+ *
+ * When several files are analyzed, each file is one document. Words are
+ * interned to dense IDs; while a document is scanned, a bitset indexed by
+ * word ID records which words it has already contained, so the document
+ * frequency of a word is updated with one bit test per token and a single
+ * increment the first time the word appears in that document. At the end of
+ * each document its (word, count) list is kept, so TF-IDF scores can be
+ * computed once the document frequencies of the whole corpus are known.
+ */
+
+#ifndef TFIDF_H
+#define TFIDF_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "analyzer.h"
+#include "intern.h"
+
+/**
+ * @struct TermCount
+ * @brief A word and how often it occurred in one document.
+ */
+typedef struct
+{
+    uint32_t id;
+    uint32_t count;
+} TermCount;
+
+/**
+ * @struct DocTerms
+ * @brief The distinct words of one finished document.
+ */
+typedef struct
+{
+    TermCount *terms;
+    uint32_t term_count;
+    long long tokens; // Total words in the document.
+} DocTerms;
+
+/**
+ * @struct TfidfStats
+ * @brief Document frequencies, finished documents and the current document.
+ */
+typedef struct
+{
+    Interner *words;     // Word <-> ID mapping shared by all documents.
+    uint32_t *df;        // df[id]: number of documents containing the word.
+    uint32_t *tf;        // tf[id]: count of the word in the current document.
+    uint64_t *seen;      // Bit id is set if the current document contains the word.
+    uint32_t id_cap;     // Capacity of df/tf, and of seen in bits.
+
+    uint32_t *touched;   // IDs seen in the current document, in order of appearance.
+    uint32_t touched_count;
+    uint32_t touched_cap;
+    long long tokens;    // Words in the current document.
+
+    DocTerms *docs;      // Finished documents, in input order.
+    int doc_count;
+    int doc_cap;
+    int top;             // Number of terms listed per document and by frequency.
+    int failed;          // Non-zero if memory ran out; results are incomplete.
+} TfidfStats;
+
+/**
+ * @brief Creates empty corpus statistics.
+ * @param top The number of top terms to list per document and overall.
+ * @return A pointer to the new TfidfStats, or NULL on failure.
+ */
+TfidfStats *create_tfidf_stats(int top);
+
+/**
+ * @brief Fills in a ScanHook that counts words per document. Each input
+ *        file's end (on_finish) closes the current document.
+ * @param ts A pointer to the TfidfStats.
+ * @param hook The hook to fill in.
+ */
+void tfidf_scan_hook(TfidfStats *ts, ScanHook *hook);
+
+/**
+ * @brief Counts one word in the current document.
+ * @param ts A pointer to the TfidfStats.
+ * @param word The NUL-terminated word.
+ */
+void add_tfidf_word(TfidfStats *ts, const char *word);
+
+/**
+ * @brief Closes the current document and starts the next one.
+ * @param ts A pointer to the TfidfStats.
+ */
+void end_tfidf_document(TfidfStats *ts);
+
+/**
+ * @brief Prints the words with the highest document frequency and the top
+ *        TF-IDF terms of every document.
+ * @param ts A pointer to the TfidfStats.
+ * @param filenames The document names, in input order.
+ * @param file_count The number of entries in `filenames`.
+ * @param output_stream The stream to write to.
+ */
+void print_tfidf_stats(const TfidfStats *ts, const char *const *filenames, int file_count,
+                       FILE *output_stream);
+
+/**
+ * @brief Frees all memory associated with a TfidfStats object.
+ * @param ts A pointer to the TfidfStats to be freed.
+ */
+void free_tfidf_stats(TfidfStats *ts);
+
+#endif // TFIDF_H
@@ -0,0 +1,492 @@
+/**
+ * @file vocab.c
+ * @brief Implementation of the saved vocabulary trie and its queries.
+ *
+ * The trie is built breadth-first straight from the sorted word list: each
+ * node stands for the range of words sharing its prefix, and its children
+ * are the runs of that range with the same next letter. A child's edge
+ * takes every further letter the whole run shares, which is the common
+ * prefix of the run's first and last word. Nodes are appended as they are
+ * discovered, which is exactly the breadth-first layout, so no
+ * pointer-based trie is ever built.
+ *
+ * A saved trie is a 20-byte header (magic, node count, word count, pool
+ * size), the node records (plus the closing first_child) and the letter
+ * pool, in the byte order of the machine that wrote it. Queries check
+ * child ranges and labels against the sizes, so a damaged file gives wrong
+ * answers rather than a crash.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "analyzer.h"
+#include "vocab.h"
+
+static const char TRIE_MAGIC[8] = {'W', 'A', 'T', 'R', 'I', 'E', '0', '2'};
+
+/**
+ * @struct TrieHeader
+ * @brief The start of a saved trie.
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t node_count;
+    uint32_t word_count;
+    uint32_t letter_count;
+} TrieHeader;
+
+/**
+ * @struct LetterPool
+ * @brief The edge letters being collected, with an index of the runs
+ *        stored so far so that equal runs are stored once.
+ */
+typedef struct
+{
+    char *letters;
+    uint32_t used;
+    uint32_t *slots; // Labels (offset << 8 | length) of the stored runs, 0 = empty.
+    uint32_t mask;
+} LetterPool;
+
+static int compare_words(const void *a, const void *b)
+{
+    return strcmp((*(Node *const *)a)->word, (*(Node *const *)b)->word);
+}
+
+/**
+ * @brief Returns the label of a run of letters, storing it if it is new.
+ * @return The label, or 0 if the pool is full.
+ */
+static uint32_t intern_label(LetterPool *pool, const char *run, int len)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (int i = 0; i < len; i++)
+    {
+        h = (h ^ (unsigned char)run[i]) * 16777619u;
+    }
+    uint32_t i = h & pool->mask;
+    for (; pool->slots[i] != 0; i = (i + 1) & pool->mask)
+    {
+        uint32_t label = pool->slots[i];
+        if ((int)(label & 0xFF) == len && memcmp(pool->letters + (label >> 8), run, (size_t)len) == 0)
+        {
+            return label;
+        }
+    }
+    if (pool->used + (uint32_t)len > TRIE_MAX_POOL)
+    {
+        return 0;
+    }
+    uint32_t label = pool->used << 8 | (uint32_t)len;
+    memcpy(pool->letters + pool->used, run, (size_t)len);
+    pool->used += (uint32_t)len;
+    pool->slots[i] = label;
+    return label;
+}
+
+VocabTrie *build_vocab_trie(const HashTable *ht)
+{
+    size_t n = 0, letters = 0;
+    for (int b = 0; b < ht->size; b++)
+    {
+        for (Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            n++;
+            letters += strlen(node->word);
+        }
+    }
+
+    // Every node but the root ends a word or has two or more children, so
+    // there are at most 2n of them; the index holds at most one run per node.
+    size_t capacity = 2 * n + 2;
+    size_t slots = 4;
+    while (slots < 2 * capacity)
+    {
+        slots *= 2;
+    }
+    VocabTrie *trie = calloc(1, sizeof(VocabTrie));
+    Node **words = malloc((n > 0 ? n : 1) * sizeof(Node *));
+    TrieNode *nodes = calloc(capacity, sizeof(TrieNode));
+    uint32_t *lo = malloc(capacity * sizeof(uint32_t));
+    uint32_t *hi = malloc(capacity * sizeof(uint32_t));
+    uint8_t *depth = malloc(capacity);
+    LetterPool pool = {malloc(letters + 1), 0, calloc(slots, sizeof(uint32_t)), (uint32_t)slots - 1};
+    int ok = trie != NULL && words != NULL && nodes != NULL && lo != NULL && hi != NULL &&
+             depth != NULL && pool.letters != NULL && pool.slots != NULL && capacity <= UINT32_MAX;
+
+    if (ok)
+    {
+        n = 0;
+        for (int b = 0; b < ht->size; b++)
+        {
+            for (Node *node = ht->table[b]; node != NULL; node = node->next)
+            {
+                words[n++] = node;
+            }
+        }
+        qsort(words, n, sizeof(Node *), compare_words);
+    }
+
+    uint32_t count = 1;
+    if (ok)
+    {
+        lo[0] = 0;
+        hi[0] = (uint32_t)n;
+        depth[0] = 0;
+    }
+    for (uint32_t k = 0; ok && k < count; k++)
+    {
+        uint32_t i = lo[k], d = depth[k];
+        if (i < hi[k] && words[i]->word[d] == '\0')
+        {
+            nodes[k].count = (uint32_t)words[i]->count; // The word equal to the prefix sorts first.
+            trie->word_count++;
+            i++;
+        }
+        nodes[k].first_child = count;
+        while (ok && i < hi[k])
+        {
+            const char *first = words[i]->word;
+            uint32_t j = i;
+            while (j < hi[k] && words[j]->word[d] == first[d])
+            {
+                j++;
+            }
+            const char *last = words[j - 1]->word;
+            uint32_t e = d + 1;
+            while (first[e] != '\0' && first[e] == last[e])
+            {
+                e++;
+            }
+            nodes[count].label = intern_label(&pool, first + d, (int)(e - d));
+            ok = nodes[count].label != 0;
+            lo[count] = i;
+            hi[count] = j;
+            depth[count] = (uint8_t)e;
+            count++;
+            i = j;
+        }
+    }
+
+    free(words);
+    free(lo);
+    free(hi);
+    free(depth);
+    free(pool.slots);
+    if (!ok)
+    {
+        free(trie);
+        free(nodes);
+        free(pool.letters);
+        return NULL;
+    }
+    nodes[count].first_child = count; // Closes the children of the last node.
+    trie->nodes = nodes;
+    trie->node_count = count;
+    trie->letters = pool.letters;
+    trie->letter_count = pool.used;
+    return trie;
+}
+
+int save_vocab_trie(const VocabTrie *trie, const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        perror("Error opening vocabulary file");
+        return -1;
+    }
+    TrieHeader header;
+    memcpy(header.magic, TRIE_MAGIC, sizeof(header.magic));
+    header.node_count = trie->node_count;
+    header.word_count = trie->word_count;
+    header.letter_count = trie->letter_count;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(trie->nodes, sizeof(TrieNode), trie->node_count + 1, file) ==
+                 trie->node_count + 1 &&
+             fwrite(trie->letters, 1, trie->letter_count, file) == trie->letter_count;
+    if (fclose(file) != 0 || !ok)
+    {
+        perror("Error writing vocabulary file");
+        return -1;
+    }
+    return 0;
+}
+
+VocabTrie *load_vocab_trie(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Error opening vocabulary file");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TrieHeader) + 2 * sizeof(TrieNode))
+    {
+        fprintf(stderr, "Error: %s is not a saved vocabulary.\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        perror("Error mapping vocabulary file");
+        return NULL;
+    }
+
+    const TrieHeader *header = mapping;
+    size_t nodes_size = ((size_t)header->node_count + 1) * sizeof(TrieNode);
+    if (memcmp(header->magic, TRIE_MAGIC, sizeof(TRIE_MAGIC)) != 0 || header->node_count == 0 ||
+        (size_t)st.st_size != sizeof(TrieHeader) + nodes_size + header->letter_count)
+    {
+        fprintf(stderr, "Error: %s is not a saved vocabulary.\n", path);
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+
+    VocabTrie *trie = calloc(1, sizeof(VocabTrie));
+    if (trie == NULL)
+    {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+    trie->nodes = (const TrieNode *)((const char *)mapping + sizeof(TrieHeader));
+    trie->node_count = header->node_count;
+    trie->word_count = header->word_count;
+    trie->letters = (const char *)trie->nodes + nodes_size;
+    trie->letter_count = header->letter_count;
+    trie->mapping = mapping;
+    trie->mapping_size = (size_t)st.st_size;
+    return trie;
+}
+
+/**
+ * @brief Returns non-zero if a node's children lie inside the trie, after
+ *        the node itself (which also keeps a damaged file from looping).
+ */
+static int children_valid(const VocabTrie *trie, uint32_t index)
+{
+    uint32_t first = trie->nodes[index].first_child, end = trie->nodes[index + 1].first_child;
+    return first == end || (first > index && first < end && end <= trie->node_count);
+}
+
+/**
+ * @brief Returns the letters on the edge into a node, or NULL if the label
+ *        lies outside the pool.
+ */
+static const char *edge_letters(const VocabTrie *trie, uint32_t index, int *len)
+{
+    uint32_t label = trie->nodes[index].label;
+    *len = (int)(label & 0xFF);
+    if (*len == 0 || (uint64_t)(label >> 8) + (uint32_t)*len > trie->letter_count)
+    {
+        return NULL;
+    }
+    return trie->letters + (label >> 8);
+}
+
+/**
+ * @brief Lists the words in the subtree of `index`; `word` holds the
+ *        `len`-letter prefix leading to it.
+ */
+static long long list_subtree(const VocabTrie *trie, uint32_t index, char *word, int len,
+                              FILE *output_stream)
+{
+    const TrieNode *node = &trie->nodes[index];
+    long long listed = 0;
+    if (node->count > 0)
+    {
+        word[len] = '\0';
+        fprintf(output_stream, "  %-20s %u\n", word, node->count);
+        listed++;
+    }
+    if (!children_valid(trie, index))
+    {
+        return listed;
+    }
+    for (uint32_t child = node->first_child; child < trie->nodes[index + 1].first_child; child++)
+    {
+        int n;
+        const char *letters = edge_letters(trie, child, &n);
+        if (letters != NULL && len + n < MAX_WORD_LEN)
+        {
+            memcpy(word + len, letters, (size_t)n);
+            listed += list_subtree(trie, child, word, len + n, output_stream);
+        }
+    }
+    return listed;
+}
+
+long long query_vocab_prefix(const VocabTrie *trie, const char *prefix, FILE *output_stream)
+{
+    char word[MAX_WORD_LEN];
+    int len = 0;
+    uint32_t index = 0;
+    const char *p = prefix;
+    while (*p != '\0')
+    {
+        if (!children_valid(trie, index))
+        {
+            return 0;
+        }
+        uint32_t found = 0;
+        const char *letters = NULL;
+        int n = 0;
+        for (uint32_t child = trie->nodes[index].first_child;
+             child < trie->nodes[index + 1].first_child && found == 0; child++)
+        {
+            letters = edge_letters(trie, child, &n);
+            if (letters != NULL && letters[0] == *p)
+            {
+                found = child;
+            }
+        }
+        if (found == 0 || len + n >= MAX_WORD_LEN)
+        {
+            return 0; // Node 0 is the root, so it is never a child.
+        }
+        // The prefix may end inside the edge; every word below then matches.
+        int k = 0;
+        while (k < n && p[k] != '\0' && letters[k] == p[k])
+        {
+            k++;
+        }
+        if (k < n && p[k] != '\0')
+        {
+            return 0;
+        }
+        memcpy(word + len, letters, (size_t)n);
+        len += n;
+        p += k;
+        index = found;
+    }
+    return list_subtree(trie, index, word, len, output_stream);
+}
+
+/**
+ * @struct FuzzyQuery
+ * @brief The fixed parameters of a fuzzy search.
+ */
+typedef struct
+{
+    const VocabTrie *trie;
+    const char *target;
+    int target_len;
+    int distance;
+    char word[MAX_WORD_LEN];
+    FILE *output_stream;
+} FuzzyQuery;
+
+/**
+ * @brief Computes the edit-distance row after one more letter.
+ * @return The smallest entry of the new row.
+ */
+static int next_row(const FuzzyQuery *q, const int *row, int letter, int *next)
+{
+    next[0] = row[0] + 1;
+    int best = next[0];
+    for (int j = 1; j <= q->target_len; j++)
+    {
+        int substitute = row[j - 1] + ((unsigned char)q->target[j - 1] != letter);
+        int remove = row[j] + 1, insert = next[j - 1] + 1;
+        int v = substitute < remove ? substitute : remove;
+        next[j] = v < insert ? v : insert;
+        best = next[j] < best ? next[j] : best;
+    }
+    return best;
+}
+
+/**
+ * @brief Visits the children of a node whose edit-distance row is `row`.
+ */
+static long long fuzzy_children(FuzzyQuery *q, uint32_t index, const int *row, int len)
+{
+    long long listed = 0;
+    if (!children_valid(q->trie, index))
+    {
+        return 0;
+    }
+    int m = q->target_len;
+    for (uint32_t child = q->trie->nodes[index].first_child;
+         child < q->trie->nodes[index + 1].first_child; child++)
+    {
+        int n;
+        const char *letters = edge_letters(q->trie, child, &n);
+        if (letters == NULL || len + n >= MAX_WORD_LEN)
+        {
+            continue;
+        }
+        int rows[2][MAX_WORD_LEN + 1];
+        const int *cur = row;
+        int pruned = 0;
+        for (int t = 0; t < n && !pruned; t++)
+        {
+            // Every continuation is at least as far away as the best entry.
+            pruned = next_row(q, cur, (unsigned char)letters[t], rows[t & 1]) > q->distance;
+            cur = rows[t & 1];
+        }
+        if (pruned)
+        {
+            continue;
+        }
+        memcpy(q->word + len, letters, (size_t)n);
+        const TrieNode *node = &q->trie->nodes[child];
+        if (node->count > 0 && cur[m] <= q->distance)
+        {
+            q->word[len + n] = '\0';
+            fprintf(q->output_stream, "  %-20s %-8u %d\n", q->word, node->count, cur[m]);
+            listed++;
+        }
+        listed += fuzzy_children(q, child, cur, len + n);
+    }
+    return listed;
+}
+
+long long query_vocab_fuzzy(const VocabTrie *trie, const char *word, int distance,
+                            FILE *output_stream)
+{
+    FuzzyQuery q;
+    q.trie = trie;
+    q.target = word;
+    q.target_len = (int)strlen(word);
+    q.distance = distance;
+    q.output_stream = output_stream;
+    if (q.target_len >= MAX_WORD_LEN)
+    {
+        return 0;
+    }
+
+    int row[MAX_WORD_LEN + 1];
+    for (int j = 0; j <= q.target_len; j++)
+    {
+        row[j] = j; // Distance from the empty word.
+    }
+    return fuzzy_children(&q, 0, row, 0); // The root (empty word) is never a word.
+}
+
+void free_vocab_trie(VocabTrie *trie)
+{
+    if (trie == NULL)
+    {
+        return;
+    }
+    if (trie->mapping != NULL)
+    {
+        munmap(trie->mapping, trie->mapping_size);
+    }
+    else
+    {
+        free((void *)trie->nodes);
+        free((void *)trie->letters);
+    }
+    free(trie);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file vocab.h
+ * @brief Public interface for the saved vocabulary trie and its queries.
+ *
+ * After an analysis, the vocabulary can be saved as a radix trie with the
+ * word counts stored at the nodes where words end. Chains of single-child
+ * nodes are merged, so an edge carries a run of letters; the runs are kept
+ * in a letter pool in which equal runs (common endings such as "ing" or
+ * "tion") are stored once. The nodes are laid out breadth-first, so the
+ * children of a node are contiguous and sorted by letter, and every node is
+ * a fixed-size record: the file is loaded with a single mmap() and queried
+ * in place. Prefix queries walk down the prefix and list the subtree; fuzzy
+ * queries walk the trie with one row of the edit-distance table per letter
+ * and abandon a branch as soon as every entry of its row exceeds the
+ * allowed distance.
+ */
+
+#ifndef VOCAB_H
+#define VOCAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "hashtable.h"
+
+/**
+ * @struct TrieNode
+ * @brief One node of the trie, as stored in the file (native byte order).
+ */
+typedef struct
+{
+    uint32_t first_child; // Index of the first child; the children run up to the
+                          // next node's first child.
+    uint32_t count;       // Occurrences of the word ending here, 0 if none does.
+    uint32_t label;       // The letters on the edge into this node: pool offset << 8 | length.
+} TrieNode;
+
+// The largest letter pool a label can point into.
+#define TRIE_MAX_POOL (1u << 24)
+
+/**
+ * @struct VocabTrie
+ * @brief A trie built in memory or mapped from a file. Node 0 is the root.
+ */
+typedef struct
+{
+    const TrieNode *nodes; // node_count nodes and a last one holding only first_child.
+    uint32_t node_count;
+    uint32_t word_count;   // Distinct words in the trie.
+    const char *letters;   // The pool of edge letters.
+    uint32_t letter_count;
+    void *mapping;       // The mapped file, or NULL if the nodes were built.
+    size_t mapping_size;
+} VocabTrie;
+
+/**
+ * @brief Builds a trie of every word in the table and its count.
+ * @return The trie, or NULL on failure.
+ */
+VocabTrie *build_vocab_trie(const HashTable *ht);
+
+/**
+ * @brief Writes a trie to a file.
+ * @return 0 on success, -1 on failure.
+ */
+int save_vocab_trie(const VocabTrie *trie, const char *path);
+
+/**
+ * @brief Maps a trie saved by save_vocab_trie().
+ * @return The trie, or NULL if the file cannot be read or is not a trie.
+ */
+VocabTrie *load_vocab_trie(const char *path);
+
+/**
+ * @brief Lists every word starting with `prefix`, alphabetically.
+ * @return The number of words listed.
+ */
+long long query_vocab_prefix(const VocabTrie *trie, const char *prefix, FILE *output_stream);
+
+/**
+ * @brief Lists every word within `distance` edits (insertions, deletions,
+ *        substitutions) of `word`, alphabetically.
+ * @return The number of words listed.
+ */
+long long query_vocab_fuzzy(const VocabTrie *trie, const char *word, int distance,
+                            FILE *output_stream);
+
+/**
+ * @brief Frees a trie, unmapping it if it was loaded from a file.
+ */
+void free_vocab_trie(VocabTrie *trie);
+
+#endif // VOCAB_H
@@ -0,0 +1,373 @@
+/**
+ * @file window.c
+ * @brief Implementation of windowed (per time / per line-count) statistics.
+ *
+ * Per-window character, word and line counts are never accumulated directly.
+ * Instead the global counters in AppStats are snapshotted when a window opens
+ * and the window's totals are the difference when it closes. Only the word
+ * table needs per-window storage.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "window.h"
+
+// The initial number of buckets in each per-window word table; the tables
+// grow with the number of distinct words.
+#define WINDOW_TABLE_SIZE 64
+
+/**
+ * @struct RankedWord
+ * @brief A word and its count, used to list the top words of a window.
+ */
+typedef struct
+{
+    const char *word;
+    int count;
+} RankedWord;
+
+/**
+ * @brief Whether a word ranks before a listed one: higher counts first, and
+ *        equal counts alphabetically, whatever the order of the table.
+ */
+static int ranks_before(const char *word, int count, const RankedWord *other)
+{
+    return count > other->count || (count == other->count && strcmp(word, other->word) < 0);
+}
+
+/**
+ * @brief Offers a word to a small "top N" list kept sorted by count.
+ * @param ranked The list, with room for `top` entries.
+ * @param len A pointer to the number of entries currently in the list.
+ * @param top The maximum number of entries.
+ */
+static void rank_word(RankedWord *ranked, int *len, int top, const char *word, int count)
+{
+    if (top <= 0 || (*len == top && !ranks_before(word, count, &ranked[top - 1])))
+    {
+        return;
+    }
+
+    // Shift smaller entries down to make room, dropping the last if full.
+    int i = (*len < top) ? (*len)++ : top - 1;
+    while (i > 0 && ranks_before(word, count, &ranked[i - 1]))
+    {
+        ranked[i] = ranked[i - 1];
+        i--;
+    }
+    ranked[i].word = word;
+    ranked[i].count = count;
+}
+
+static void print_ranked(FILE *out, const char *label, const RankedWord *ranked, int len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    fprintf(out, "  %s:", label);
+    for (int i = 0; i < len; i++)
+    {
+        fprintf(out, "%s %s (%d)", i == 0 ? "" : ",", ranked[i].word, ranked[i].count);
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * @brief Takes the current global counters as the start of the open window.
+ */
+static void restart_window(WindowStats *ws)
+{
+    ws->first_line = ws->stats->line_count + 1;
+    ws->start.chars = ws->stats->char_count;
+    ws->start.words = ws->stats->word_count;
+    ws->start.lines = ws->stats->line_count;
+}
+
+/**
+ * @brief Captures the global counters at the start of a new window.
+ */
+static void open_window(WindowStats *ws, time_t start_time)
+{
+    ws->index++;
+    restart_window(ws);
+    ws->start_time = start_time;
+}
+
+/**
+ * @brief Closes the current window, prints its summary and rotates the ring.
+ * @return 0 on success, -1 if a new word table could not be allocated.
+ */
+static int close_window(WindowStats *ws)
+{
+    HashTable *fresh = create_growing_hash_table(WINDOW_TABLE_SIZE);
+    if (fresh == NULL)
+    {
+        return -1;
+    }
+
+    WindowTotals totals;
+    totals.chars = ws->stats->char_count - ws->start.chars;
+    totals.words = ws->stats->word_count - ws->start.words;
+    totals.lines = ws->stats->line_count - ws->start.lines;
+
+    // Words that appear in this window but nowhere in the sliding aggregate.
+    RankedWord *new_words = calloc(ws->top > 0 ? ws->top : 1, sizeof(RankedWord));
+    RankedWord *gone_words = calloc(ws->top > 0 ? ws->top : 1, sizeof(RankedWord));
+    int new_len = 0, gone_len = 0, distinct = 0;
+    for (int i = 0; i < ws->current->size; i++)
+    {
+        for (Node *n = ws->current->table[i]; n != NULL; n = n->next)
+        {
+            distinct++;
+            if (new_words != NULL && find_word(ws->sliding, n->word) == NULL)
+            {
+                rank_word(new_words, &new_len, ws->top, n->word, n->count);
+            }
+        }
+    }
+
+    // Expire the oldest window if the ring is full. Its words are subtracted
+    // from the aggregate after the summary is printed, since the ranked list
+    // points into its table.
+    HashTable *expired = NULL;
+    if (ws->ring_len == ws->span)
+    {
+        expired = ws->ring[ws->ring_head];
+        WindowTotals *old = &ws->ring_totals[ws->ring_head];
+        ws->sliding_totals.chars -= old->chars;
+        ws->sliding_totals.words -= old->words;
+        ws->sliding_totals.lines -= old->lines;
+        ws->ring_head = (ws->ring_head + 1) % ws->span;
+        ws->ring_len--;
+
+        for (int i = 0; i < expired->size; i++)
+        {
+            for (Node *n = expired->table[i]; n != NULL; n = n->next)
+            {
+                Node *agg = find_word(ws->sliding, n->word);
+                if (gone_words != NULL && agg != NULL && agg->count == n->count &&
+                    find_word(ws->current, n->word) == NULL)
+                {
+                    rank_word(gone_words, &gone_len, ws->top, n->word, n->count);
+                }
+            }
+        }
+    }
+
+    // Add the closed window to the ring and the aggregate.
+    int slot = (ws->ring_head + ws->ring_len) % ws->span;
+    ws->ring[slot] = ws->current;
+    ws->ring_totals[slot] = totals;
+    ws->ring_len++;
+    ws->sliding_totals.chars += totals.chars;
+    ws->sliding_totals.words += totals.words;
+    ws->sliding_totals.lines += totals.lines;
+    for (int i = 0; i < ws->current->size; i++)
+    {
+        for (Node *n = ws->current->table[i]; n != NULL; n = n->next)
+        {
+            add_word_count(ws->sliding, n->word, n->count);
+        }
+    }
+    if (expired != NULL)
+    {
+        for (int i = 0; i < expired->size; i++)
+        {
+            for (Node *n = expired->table[i]; n != NULL; n = n->next)
+            {
+                add_word_count(ws->sliding, n->word, -n->count);
+            }
+        }
+    }
+
+    int sliding_distinct = 0;
+    for (int i = 0; i < ws->sliding->size; i++)
+    {
+        for (Node *n = ws->sliding->table[i]; n != NULL; n = n->next)
+        {
+            sliding_distinct++;
+        }
+    }
+
+    // --- Emit the per-window summary ---
+    if (ws->mode == WINDOW_BY_LINES)
+    {
+        fprintf(ws->out, "Window %lld (lines %lld-%lld):", ws->index, ws->first_line,
+                ws->first_line + totals.lines - 1);
+    }
+    else
+    {
+        char stamp[32];
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime(&ws->start_time));
+        fprintf(ws->out, "Window %lld (%s, %llds):", ws->index, stamp, ws->size);
+    }
+    fprintf(ws->out, " %d lines, %d words, %lld chars, %d distinct words\n",
+            totals.lines, totals.words, totals.chars, distinct);
+    fprintf(ws->out, "  Sliding (last %d): %d lines, %d words, %lld chars, %d distinct words\n",
+            ws->ring_len, ws->sliding_totals.lines, ws->sliding_totals.words,
+            ws->sliding_totals.chars, sliding_distinct);
+    print_ranked(ws->out, "New words", new_words, new_len);
+    print_ranked(ws->out, "Gone words", gone_words, gone_len);
+    fflush(ws->out); // Live consumers want each window as soon as it closes.
+
+    free(new_words);
+    free(gone_words);
+    free_hash_table(expired);
+    ws->current = fresh;
+    return 0;
+}
+
+static void window_on_word(void *ctx, const char *word)
+{
+    WindowStats *ws = ctx;
+    insert_word(ws->current, word);
+}
+
+static void window_on_buffer(void *ctx, const char *buf, size_t len)
+{
+    (void)buf;
+    (void)len;
+    WindowStats *ws = ctx;
+
+    if (ws->stats->char_count < ws->start.chars)
+    {
+        // The statistics were reset (a followed file was truncated): the
+        // open window starts over from the new contents.
+        clear_hash_table(ws->current);
+        restart_window(ws);
+    }
+
+    // Data that arrives after a time boundary belongs to the next window, so
+    // the clock is checked before the buffer is counted.
+    window_tick(ws, time(NULL)); // A failure is kept in ws->failed.
+}
+
+static void window_on_line(void *ctx)
+{
+    WindowStats *ws = ctx;
+    if (ws->mode == WINDOW_BY_LINES && ws->stats->line_count - ws->start.lines >= ws->size)
+    {
+        if (close_window(ws) != 0)
+        {
+            ws->failed = 1; // The window stays open; the next line tries again.
+            return;
+        }
+        open_window(ws, ws->start_time);
+    }
+}
+
+WindowStats *create_window_stats(const AppStats *stats, WindowMode mode, long long size,
+                                 int span, int top, FILE *out)
+{
+    if (stats == NULL || size < 1 || span < 1)
+    {
+        return NULL;
+    }
+
+    WindowStats *ws = calloc(1, sizeof(WindowStats));
+    if (ws == NULL)
+    {
+        return NULL;
+    }
+
+    ws->mode = mode;
+    ws->size = size;
+    ws->span = span;
+    ws->top = top;
+    ws->stats = stats;
+    ws->out = out;
+    ws->current = create_growing_hash_table(WINDOW_TABLE_SIZE);
+    ws->sliding = create_growing_hash_table(WINDOW_TABLE_SIZE);
+    ws->ring = calloc(span, sizeof(HashTable *));
+    ws->ring_totals = calloc(span, sizeof(WindowTotals));
+    if (ws->current == NULL || ws->sliding == NULL || ws->ring == NULL || ws->ring_totals == NULL)
+    {
+        free_window_stats(ws);
+        return NULL;
+    }
+
+    open_window(ws, time(NULL));
+    return ws;
+}
+
+void window_scan_hook(WindowStats *ws, ScanHook *hook)
+{
+    memset(hook, 0, sizeof(*hook));
+    hook->on_buffer = window_on_buffer;
+    hook->on_word = window_on_word;
+    hook->on_line = window_on_line;
+    hook->ctx = ws;
+}
+
+int window_tick(WindowStats *ws, time_t now)
+{
+    if (ws->mode != WINDOW_BY_SECONDS)
+    {
+        return 0;
+    }
+
+    // Close every window whose interval has passed. Long idle gaps produce
+    // empty windows so that the sliding aggregate still expires on time, but
+    // no more than `span` of them are needed to empty it completely.
+    int emitted = 0;
+    while (now >= ws->start_time + ws->size)
+    {
+        time_t next = ws->start_time + ws->size;
+        if (emitted > ws->span)
+        {
+            next = now - (now - ws->start_time) % ws->size;
+        }
+        if (close_window(ws) != 0)
+        {
+            ws->failed = 1;
+            return -1;
+        }
+        open_window(ws, next);
+        emitted++;
+    }
+    return 0;
+}
+
+int window_finish(WindowStats *ws)
+{
+    // Only emit the trailing window if something happened in it.
+    if (ws->stats->char_count > ws->start.chars)
+    {
+        if (close_window(ws) != 0)
+        {
+            ws->failed = 1;
+        }
+        else
+        {
+            open_window(ws, time(NULL));
+        }
+    }
+    if (ws->failed)
+    {
+        fprintf(stderr, "Error: Out of memory closing a window.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void free_window_stats(WindowStats *ws)
+{
+    if (ws == NULL)
+    {
+        return;
+    }
+
+    if (ws->ring != NULL)
+    {
+        for (int i = 0; i < ws->ring_len; i++)
+        {
+            free_hash_table(ws->ring[(ws->ring_head + i) % ws->span]);
+        }
+    }
+    free(ws->ring);
+    free(ws->ring_totals);
+    free_hash_table(ws->current);
+    free_hash_table(ws->sliding);
+    free(ws);
+}
@@ -0,0 +1,113 @@
+/**
+ * @file window.h
+ * @brief Public interface for windowed (per time / per line-count) statistics.
+ *
+ * A WindowStats object observes the scan loop through a ScanHook and splits
+ * the input into consecutive windows. For every window it keeps only compact
+ * counters and a word table; a sliding aggregate over the last few windows is
+ * maintained by adding each closed window and subtracting the one that
+ * expires, so the raw text never has to be kept.
+ */
+
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#include <stdio.h>
+#include <time.h>
+#include "analyzer.h"
+
+/**
+ * @enum WindowMode
+ * @brief How the input is divided into windows.
+ */
+typedef enum
+{
+    WINDOW_BY_LINES,  // A new window starts every `size` lines.
+    WINDOW_BY_SECONDS // A new window starts every `size` seconds of wall time.
+} WindowMode;
+
+/**
+ * @struct WindowTotals
+ * @brief The compact counters kept for a single window.
+ */
+typedef struct
+{
+    long long chars; // Characters read during the window.
+    int words;       // Whitespace-separated words started during the window.
+    int lines;       // Lines completed during the window.
+} WindowTotals;
+
+/**
+ * @struct WindowStats
+ * @brief The state of a windowed aggregation.
+ */
+typedef struct
+{
+    WindowMode mode;
+    long long size;        // Lines or seconds per window.
+    int span;              // Number of closed windows in the sliding aggregate.
+    int top;               // Number of new/gone words listed per window.
+    const AppStats *stats; // The global statistics the windows are cut from.
+    FILE *out;             // Where per-window summaries are written.
+
+    long long index;       // Number of the current window (starting at 1).
+    long long first_line;  // Global line number the current window starts at.
+    time_t start_time;     // Wall time the current window started at.
+    WindowTotals start;    // Global counters when the current window started.
+    HashTable *current;    // Word counts of the current window.
+
+    HashTable **ring;           // Word tables of the last `span` closed windows.
+    WindowTotals *ring_totals;  // Counters of the same windows.
+    int ring_head;              // Index of the oldest entry in the ring.
+    int ring_len;               // Number of occupied ring entries.
+    HashTable *sliding;         // Sum of every word table in the ring.
+    WindowTotals sliding_totals; // Sum of every counter in the ring.
+    int failed;                 // Non-zero once a window could not be closed for lack of memory.
+} WindowStats;
+
+/**
+ * @brief Creates a windowed aggregation bound to an AppStats struct.
+ * @param stats The AppStats struct the scan loop updates.
+ * @param mode Whether windows are measured in lines or seconds.
+ * @param size The number of lines or seconds per window (must be > 0).
+ * @param span The number of windows kept in the sliding aggregate (> 0).
+ * @param top The number of new/gone words to list for each window.
+ * @param out The stream per-window summaries are written to.
+ * @return A pointer to the new WindowStats, or NULL on failure.
+ */
+WindowStats *create_window_stats(const AppStats *stats, WindowMode mode, long long size,
+                                 int span, int top, FILE *out);
+
+/**
+ * @brief Fills in a ScanHook that feeds the scan loop into the windows.
+ * @param ws A pointer to the WindowStats.
+ * @param hook The hook to fill in.
+ */
+void window_scan_hook(WindowStats *ws, ScanHook *hook);
+
+/**
+ * @brief Closes the current window if its time is up.
+ * Time-based windows are otherwise only checked when new input arrives;
+ * calling this periodically lets idle periods close their windows on time.
+ * @param ws A pointer to the WindowStats.
+ * @param now The current wall time.
+ * @return 0 on success, -1 if a window could not be closed for lack of memory.
+ */
+int window_tick(WindowStats *ws, time_t now);
+
+/**
+ * @brief Closes the final (possibly partial) window at the end of the input.
+ * @param ws A pointer to the WindowStats.
+ * @return 0 on success, -1 if this or any earlier window could not be
+ *         closed for lack of memory (its input then counted towards the
+ *         next window).
+ */
+int window_finish(WindowStats *ws);
+
+/**
+ * @brief Frees all memory associated with a WindowStats object.
+ * @param ws A pointer to the WindowStats to be freed.
+ */
+void free_window_stats(WindowStats *ws);
+
+#endif // WINDOW_H
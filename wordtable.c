@@ -0,0 +1,292 @@
+/**
+ * @file wordtable.c
+ * @brief Implementation of the parallel word table writer.
+ *
+ * Rows are formatted in rounds: each of up to `threads` workers formats one
+ * slice of SLICE_ROWS rows into its own memory-only OutBuf, and once all of
+ * them are done the buffers are written in slice order. Memory therefore
+ * stays at roughly threads * SLICE_ROWS rows, however large the table.
+ *
+ * Words are lower-case letters only, so CSV rows never need quoting.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wordtable.h"
+
+// Rows formatted by one worker per round.
+#define SLICE_ROWS 65536
+
+// Tables with fewer rows are formatted on the calling thread.
+#define PARALLEL_MIN_ROWS (4 * SLICE_ROWS)
+
+// The most workers used.
+#define MAX_WORKERS 64
+
+/**
+ * @struct Slice
+ * @brief A contiguous run of rows and the buffer they are formatted into.
+ */
+typedef struct
+{
+    Node *const *rows;
+    size_t count;
+    TableFormat format;
+    OutBuf buffer;
+} Slice;
+
+static void format_row(OutBuf *out, const Node *node, TableFormat format)
+{
+    if (format == TABLE_CSV)
+    {
+        out_str(out, node->word);
+        out_str(out, ",");
+        out_int(out, node->count, 0);
+        out_str(out, "\n");
+    }
+    else
+    {
+        out_str(out, "  ");
+        out_pad(out, node->word, 20);
+        out_str(out, " ");
+        out_int(out, node->count, 0);
+        out_str(out, "\n");
+    }
+}
+
+static void *format_slice(void *arg)
+{
+    Slice *slice = arg;
+    for (size_t i = 0; i < slice->count; i++)
+    {
+        format_row(&slice->buffer, slice->rows[i], slice->format);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Orders nodes by descending count, then alphabetically.
+ */
+static int compare_rows(const void *a, const void *b)
+{
+    const Node *x = *(Node *const *)a;
+    const Node *y = *(Node *const *)b;
+    if (x->count != y->count)
+    {
+        return x->count > y->count ? -1 : 1;
+    }
+    return strcmp(x->word, y->word);
+}
+
+/**
+ * @brief Returns non-zero if a word passes the filter.
+ */
+static int passes(const Node *node, const WordFilter *filter, size_t prefix_len)
+{
+    if (node->count < filter->min_count)
+    {
+        return 0;
+    }
+    if (prefix_len > 0 && strncmp(node->word, filter->prefix, prefix_len) != 0)
+    {
+        return 0;
+    }
+    if (filter->min_len > 0 || filter->max_len > 0)
+    {
+        size_t len = strlen(node->word);
+        if (len < (size_t)filter->min_len || (filter->max_len > 0 && len > (size_t)filter->max_len))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Restores the heap below `i`. The root of the heap is the row that
+ *        ranks last, so it is the one a better candidate replaces.
+ */
+static void sift_down(Node **heap, size_t n, size_t i)
+{
+    for (;;)
+    {
+        size_t worst = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < n && compare_rows(&heap[l], &heap[worst]) > 0)
+        {
+            worst = l;
+        }
+        if (r < n && compare_rows(&heap[r], &heap[worst]) > 0)
+        {
+            worst = r;
+        }
+        if (worst == i)
+        {
+            return;
+        }
+        Node *tmp = heap[i];
+        heap[i] = heap[worst];
+        heap[worst] = tmp;
+        i = worst;
+    }
+}
+
+static void sift_up(Node **heap, size_t i)
+{
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+        if (compare_rows(&heap[i], &heap[parent]) <= 0)
+        {
+            return;
+        }
+        Node *tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+int write_word_table(const HashTable *ht, TableFormat format, const WordFilter *filter,
+                     int threads, OutBuf *out)
+{
+    if (format == TABLE_CSV)
+    {
+        out_str(out, "word,count\n");
+    }
+
+    size_t prefix_len = filter->prefix != NULL ? strlen(filter->prefix) : 0;
+    size_t matches = 0;
+    for (int b = 0; b < ht->size; b++)
+    {
+        for (Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            matches += passes(node, filter, prefix_len);
+        }
+    }
+    size_t top = filter->top > 0 ? (size_t)filter->top : 0;
+    size_t capacity = top > 0 && top < matches ? top : matches;
+    int sorted = format == TABLE_CSV || top > 0;
+
+    Node **rows = malloc((capacity > 0 ? capacity : 1) * sizeof(Node *));
+    if (rows == NULL)
+    {
+        if (sorted)
+        {
+            fprintf(stderr, "Error: Not enough memory to sort the word table.\n");
+            return -1;
+        }
+        for (int b = 0; b < ht->size; b++)
+        {
+            for (Node *node = ht->table[b]; node != NULL; node = node->next)
+            {
+                if (passes(node, filter, prefix_len))
+                {
+                    format_row(out, node, format);
+                }
+            }
+        }
+        return outbuf_flush(out);
+    }
+
+    // With a top-K limit only the best K rows seen so far are kept, in a heap.
+    size_t total = 0;
+    for (int b = 0; b < ht->size; b++)
+    {
+        for (Node *node = ht->table[b]; node != NULL; node = node->next)
+        {
+            if (!passes(node, filter, prefix_len))
+            {
+                continue;
+            }
+            if (top == 0)
+            {
+                rows[total++] = node;
+            }
+            else if (total < top)
+            {
+                rows[total] = node;
+                sift_up(rows, total++);
+            }
+            else if (compare_rows(&node, &rows[0]) < 0)
+            {
+                rows[0] = node;
+                sift_down(rows, total, 0);
+            }
+        }
+    }
+    if (sorted)
+    {
+        qsort(rows, total, sizeof(Node *), compare_rows);
+    }
+
+    if (threads > MAX_WORKERS)
+    {
+        threads = MAX_WORKERS;
+    }
+    if (threads <= 1 || total < PARALLEL_MIN_ROWS)
+    {
+        for (size_t i = 0; i < total; i++)
+        {
+            format_row(out, rows[i], format);
+        }
+        free(rows);
+        return outbuf_flush(out);
+    }
+
+    // What is already buffered precedes the slices.
+    outbuf_flush(out);
+    Slice slices[MAX_WORKERS];
+    pthread_t workers[MAX_WORKERS];
+    for (int t = 0; t < threads; t++)
+    {
+        outbuf_init(&slices[t].buffer, -1);
+        slices[t].format = format;
+    }
+
+    for (size_t next = 0; next < total;)
+    {
+        int used = 0;
+        for (; used < threads && next < total; used++)
+        {
+            slices[used].rows = rows + next;
+            slices[used].count = total - next < SLICE_ROWS ? total - next : SLICE_ROWS;
+            next += slices[used].count;
+        }
+
+        // The calling thread formats the last slice of the round itself.
+        int started = 0;
+        for (int t = 0; t < used - 1; t++)
+        {
+            if (pthread_create(&workers[t], NULL, format_slice, &slices[t]) != 0)
+            {
+                break;
+            }
+            started++;
+        }
+        for (int t = started; t < used; t++)
+        {
+            format_slice(&slices[t]);
+        }
+        for (int t = 0; t < started; t++)
+        {
+            pthread_join(workers[t], NULL);
+        }
+
+        for (int t = 0; t < used; t++)
+        {
+            if (outbuf_write_to(&slices[t].buffer, out->fd) != 0)
+            {
+                out->failed = 1;
+            }
+        }
+    }
+
+    for (int t = 0; t < threads; t++)
+    {
+        outbuf_finish(&slices[t].buffer);
+    }
+    free(rows);
+    return out->failed ? -1 : 0;
+}
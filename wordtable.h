@@ -0,0 +1,61 @@
+/**
+ * @file wordtable.h
+ * @brief Public interface for writing the word frequency table.
+ *
+ * The word table is the one part of the report that grows with the input:
+ * a large corpus has millions of distinct words. The rows are split into
+ * contiguous slices that worker threads format into buffers of their own,
+ * and the buffers are written out in order, so the output is the same as a
+ * single-threaded pass but formatting scales with the number of cores.
+ *
+ * Filters are applied while the rows are collected, and a top-K limit is
+ * met with a bounded heap, so discarded words are never sorted or
+ * formatted.
+ */
+
+#ifndef WORDTABLE_H
+#define WORDTABLE_H
+
+#include "hashtable.h"
+#include "outbuf.h"
+
+/**
+ * @enum TableFormat
+ * @brief How the word table is written.
+ */
+typedef enum
+{
+    TABLE_TEXT, // Aligned "word count" rows in table order (by count with a top-K limit).
+    TABLE_CSV   // A "word,count" header, then rows by descending count, ties by word.
+} TableFormat;
+
+/**
+ * @struct WordFilter
+ * @brief Which words the table includes. Zero (or NULL) disables a test.
+ */
+typedef struct
+{
+    int min_count;      // Only words seen at least this often.
+    int min_len;        // Only words at least this long.
+    int max_len;        // Only words at most this long.
+    const char *prefix; // Only words starting with this (lower-case) prefix.
+    int top;            // Only the `top` most frequent of those, most frequent first.
+} WordFilter;
+
+/**
+ * @brief Writes the words that pass a filter, with their counts, to the report.
+ *
+ * Small tables are formatted on the calling thread. The column headings of
+ * the text format are the caller's; the CSV header is written here.
+ *
+ * @param ht The word table.
+ * @param format The row format and order.
+ * @param filter The words to include.
+ * @param threads The most threads to format with (at least 1).
+ * @param out The report being written.
+ * @return 0 on success, -1 if the output could not be written.
+ */
+int write_word_table(const HashTable *ht, TableFormat format, const WordFilter *filter,
+                     int threads, OutBuf *out);
+
+#endif // WORDTABLE_H